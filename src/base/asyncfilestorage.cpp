@@ -31,6 +31,7 @@
 #include <QDebug>
 #include <QMetaObject>
 #include <QSaveFile>
+#include <QThread>
 
 AsyncFileStorage::AsyncFileStorage(const QString &storageFolderPath, QObject *parent)
     : QObject(parent)
@@ -58,6 +59,25 @@ void AsyncFileStorage::store(const QString &fileName, const QByteArray &data)
                               , Q_ARG(QString, fileName), Q_ARG(QByteArray, data));
 }
 
+// Operations are performed in the order they were requested
+void AsyncFileStorage::append(const QString &fileName, const QByteArray &data)
+{
+    QMetaObject::invokeMethod(this, "append_impl", Qt::QueuedConnection
+                              , Q_ARG(QString, fileName), Q_ARG(QByteArray, data));
+}
+
+QByteArray AsyncFileStorage::read(const QString &fileName)
+{
+    // nothing is pending if the storage thread isn't running (any more)
+    if ((thread() == QThread::currentThread()) || !thread()->isRunning())
+        return read_impl(fileName);
+
+    QByteArray data;
+    QMetaObject::invokeMethod(this, "read_impl", Qt::BlockingQueuedConnection
+                              , Q_RETURN_ARG(QByteArray, data), Q_ARG(QString, fileName));
+    return data;
+}
+
 QDir AsyncFileStorage::storageDir() const
 {
     return m_storageDir;
@@ -77,6 +97,31 @@ void AsyncFileStorage::store_impl(const QString &fileName, const QByteArray &dat
     }
 }
 
+void AsyncFileStorage::append_impl(const QString &fileName, const QByteArray &data)
+{
+    const QString filePath = m_storageDir.absoluteFilePath(fileName);
+    QFile file(filePath);
+    qDebug() << "AsyncFileStorage: Appending data to" << filePath;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append) || (file.write(data) != data.size())) {
+        qDebug() << "AsyncFileStorage: Failed to append data";
+        emit failed(filePath, file.errorString());
+    }
+}
+
+QByteArray AsyncFileStorage::read_impl(const QString &fileName)
+{
+    const QString filePath = m_storageDir.absoluteFilePath(fileName);
+    QFile file(filePath);
+    qDebug() << "AsyncFileStorage: Reading data from" << filePath;
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (file.exists())
+            qDebug() << "AsyncFileStorage: Failed to read data:" << file.errorString();
+        return QByteArray();
+    }
+
+    return file.readAll();
+}
+
 AsyncFileStorageError::AsyncFileStorageError(const QString &message)
     : std::runtime_error(message.toUtf8().data())
 {
@@ -50,6 +50,9 @@ public:
     ~AsyncFileStorage() override;
 
     void store(const QString &fileName, const QByteArray &data);
+    void append(const QString &fileName, const QByteArray &data);
+    // Blocks until the pending operations are done, so the result includes their changes
+    QByteArray read(const QString &fileName);
 
     QDir storageDir() const;
 
@@ -58,6 +61,8 @@ signals:
 
 private:
     Q_INVOKABLE void store_impl(const QString &fileName, const QByteArray &data);
+    Q_INVOKABLE void append_impl(const QString &fileName, const QByteArray &data);
+    Q_INVOKABLE QByteArray read_impl(const QString &fileName);
 
     QDir m_storageDir;
     QFile m_lockFile;
@@ -2,12 +2,16 @@ HEADERS += \
     $$PWD/algorithm.h \
     $$PWD/asyncfilestorage.h \
     $$PWD/bittorrent/addtorrentparams.h  \
+    $$PWD/bittorrent/bitfield.h \
     $$PWD/bittorrent/cachestatus.h \
+    $$PWD/bittorrent/filetree.h \
     $$PWD/bittorrent/infohash.h \
     $$PWD/bittorrent/magneturi.h \
     $$PWD/bittorrent/peerinfo.h \
     $$PWD/bittorrent/private/bandwidthscheduler.h \
     $$PWD/bittorrent/private/filterparserthread.h \
+    $$PWD/bittorrent/private/resumedatabase.h \
+    $$PWD/bittorrent/private/resumedataloader.h \
     $$PWD/bittorrent/private/resumedatasavingmanager.h \
     $$PWD/bittorrent/private/speedmonitor.h \
     $$PWD/bittorrent/private/statistics.h \
@@ -28,6 +32,7 @@ HEADERS += \
     $$PWD/http/responsebuilder.h \
     $$PWD/http/responsegenerator.h \
     $$PWD/http/server.h \
+    $$PWD/http/serverworker.h \
     $$PWD/http/types.h \
     $$PWD/iconprovider.h \
     $$PWD/indexrange.h \
@@ -45,6 +50,7 @@ HEADERS += \
     $$PWD/private/profile_p.h \
     $$PWD/profile.h \
     $$PWD/rss/private/rss_parser.h \
+    $$PWD/rss/private/rss_ruleindex.h \
     $$PWD/rss/rss_article.h \
     $$PWD/rss/rss_autodownloader.h \
     $$PWD/rss/rss_autodownloadrule.h \
@@ -74,11 +80,15 @@ HEADERS += \
 
 SOURCES += \
     $$PWD/asyncfilestorage.cpp \
+    $$PWD/bittorrent/bitfield.cpp \
+    $$PWD/bittorrent/filetree.cpp \
     $$PWD/bittorrent/infohash.cpp \
     $$PWD/bittorrent/magneturi.cpp \
     $$PWD/bittorrent/peerinfo.cpp \
     $$PWD/bittorrent/private/bandwidthscheduler.cpp \
     $$PWD/bittorrent/private/filterparserthread.cpp \
+    $$PWD/bittorrent/private/resumedatabase.cpp \
+    $$PWD/bittorrent/private/resumedataloader.cpp \
     $$PWD/bittorrent/private/resumedatasavingmanager.cpp \
     $$PWD/bittorrent/private/speedmonitor.cpp \
     $$PWD/bittorrent/private/statistics.cpp \
@@ -96,6 +106,7 @@ SOURCES += \
     $$PWD/http/responsebuilder.cpp \
     $$PWD/http/responsegenerator.cpp \
     $$PWD/http/server.cpp \
+    $$PWD/http/serverworker.cpp \
     $$PWD/iconprovider.cpp \
     $$PWD/logger.cpp \
     $$PWD/net/dnsupdater.cpp \
@@ -111,6 +122,7 @@ SOURCES += \
     $$PWD/private/profile_p.cpp \
     $$PWD/profile.cpp \
     $$PWD/rss/private/rss_parser.cpp \
+    $$PWD/rss/private/rss_ruleindex.cpp \
     $$PWD/rss/rss_article.cpp \
     $$PWD/rss/rss_autodownloader.cpp \
     $$PWD/rss/rss_autodownloadrule.cpp \
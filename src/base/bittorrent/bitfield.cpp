@@ -0,0 +1,225 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#include "bitfield.h"
+
+#include <cstring>
+
+#include <QBitArray>
+#include <QtAlgorithms>
+
+#include <libtorrent/version.hpp>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define QBT_BITFIELD_AVX2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+#if defined(QBT_BITFIELD_AVX2) && !defined(_MSC_VER)
+#define QBT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define QBT_TARGET_AVX2
+#endif
+
+using namespace BitTorrent;
+
+namespace
+{
+    const char *nativeBitfieldData(const libtorrent::bitfield &nativeBitfield)
+    {
+#if LIBTORRENT_VERSION_NUM < 10100
+        return nativeBitfield.bytes();
+#else
+        return nativeBitfield.data();
+#endif
+    }
+
+#ifdef QBT_BITFIELD_AVX2
+    bool isAVX2Supported()
+    {
+#ifdef _MSC_VER
+        int cpuInfo[4];
+        __cpuid(cpuInfo, 0);
+        if (cpuInfo[0] < 7)
+            return false;
+
+        // AVX registers must also be enabled by the OS
+        __cpuid(cpuInfo, 1);
+        const int osxsaveAndAVX = (1 << 27) | (1 << 28);
+        if (((cpuInfo[2] & osxsaveAndAVX) != osxsaveAndAVX) || ((_xgetbv(0) & 6) != 6))
+            return false;
+
+        __cpuidex(cpuInfo, 7, 0);
+        return ((cpuInfo[1] & (1 << 5)) != 0);
+#else
+        __builtin_cpu_init();
+        return (__builtin_cpu_supports("avx2") != 0);
+#endif
+    }
+
+    // Counts bits in 32 byte blocks using nibble lookup table, returns the number of processed bytes.
+    // "b" can be null, then all bits of "a" are counted.
+    QBT_TARGET_AVX2 int countAndNotAVX2(const uchar *a, const uchar *b, const int size, int &result)
+    {
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+                                                , 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i lowMask = _mm256_set1_epi8(0x0f);
+        const __m256i zero = _mm256_setzero_si256();
+
+        __m256i total = zero;
+        int i = 0;
+        for (; (i + 32) <= size; i += 32) {
+            __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            if (b)
+                bits = _mm256_andnot_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)), bits);
+
+            const __m256i lowNibbles = _mm256_and_si256(bits, lowMask);
+            const __m256i highNibbles = _mm256_and_si256(_mm256_srli_epi16(bits, 4), lowMask);
+            const __m256i byteCounts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lowNibbles)
+                                                       , _mm256_shuffle_epi8(lookup, highNibbles));
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(byteCounts, zero));
+        }
+
+        alignas(32) quint64 lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), total);
+        result = static_cast<int>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+        return i;
+    }
+#endif
+
+    // Returns the number of bits set in "a" and not set in "b" (if "b" isn't null)
+    int countAndNot(const uchar *a, const uchar *b, const int size)
+    {
+        int result = 0;
+        int i = 0;
+
+#ifdef QBT_BITFIELD_AVX2
+        static const bool useAVX2 = isAVX2Supported();
+        if (useAVX2)
+            i = countAndNotAVX2(a, b, size, result);
+#endif
+
+        for (; (i + 8) <= size; i += 8) {
+            quint64 word;
+            std::memcpy(&word, (a + i), sizeof(word));
+            if (b) {
+                quint64 mask;
+                std::memcpy(&mask, (b + i), sizeof(mask));
+                word &= ~mask;
+            }
+            result += qPopulationCount(word);
+        }
+
+        for (; i < size; ++i)
+            result += qPopulationCount(static_cast<quint8>(b ? (a[i] & ~b[i]) : a[i]));
+
+        return result;
+    }
+}
+
+Bitfield::Bitfield(const libtorrent::bitfield &nativeBitfield)
+    : m_size(nativeBitfield.size())
+{
+    if (m_size <= 0) {
+        m_size = 0;
+        return;
+    }
+
+    m_data = QByteArray(nativeBitfieldData(nativeBitfield), ((m_size + 7) / 8));
+    // clear the unused bits so they don't affect counting
+    if ((m_size % 8) != 0)
+        m_data[m_data.size() - 1] = m_data[m_data.size() - 1] & static_cast<char>(0xFF << (8 - (m_size % 8)));
+
+    m_count = countAndNot(reinterpret_cast<const uchar *>(m_data.constData()), nullptr, m_data.size());
+}
+
+int Bitfield::size() const
+{
+    return m_size;
+}
+
+bool Bitfield::isEmpty() const
+{
+    return (m_size == 0);
+}
+
+bool Bitfield::testBit(const int i) const
+{
+    Q_ASSERT((i >= 0) && (i < m_size));
+    return ((static_cast<uchar>(m_data.at(i / 8)) & (0x80 >> (i % 8))) != 0);
+}
+
+bool Bitfield::operator[](const int i) const
+{
+    return testBit(i);
+}
+
+int Bitfield::count() const
+{
+    return m_count;
+}
+
+int Bitfield::countMissing(const libtorrent::bitfield &other) const
+{
+    const int bitCount = qMin(m_size, other.size());
+    if (bitCount <= 0)
+        return 0;
+
+    const auto otherData = reinterpret_cast<const uchar *>(nativeBitfieldData(other));
+    const auto data = reinterpret_cast<const uchar *>(m_data.constData());
+    const int fullBytes = bitCount / 8;
+    int result = countAndNot(otherData, data, fullBytes);
+
+    // the last byte may contain bits outside of the compared range
+    if ((bitCount % 8) != 0) {
+        const uchar mask = static_cast<uchar>(0xFF << (8 - (bitCount % 8)));
+        result += qPopulationCount(static_cast<quint8>(otherData[fullBytes] & ~data[fullBytes] & mask));
+    }
+
+    return result;
+}
+
+QBitArray Bitfield::toBitArray() const
+{
+    QBitArray result(m_size);
+    for (int byteIndex = 0; byteIndex < m_data.size(); ++byteIndex) {
+        const uchar byte = static_cast<uchar>(m_data.at(byteIndex));
+        if (byte == 0) continue;
+
+        for (int bit = 0; bit < 8; ++bit) {
+            if (byte & (0x80 >> bit))
+                result.setBit((byteIndex * 8) + bit);
+        }
+    }
+
+    return result;
+}
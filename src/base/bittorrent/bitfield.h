@@ -0,0 +1,67 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#ifndef BITTORRENT_BITFIELD_H
+#define BITTORRENT_BITFIELD_H
+
+#include <QByteArray>
+#include <libtorrent/bitfield.hpp>
+
+class QBitArray;
+
+namespace BitTorrent
+{
+    // Immutable bitfield of pieces. It is implicitly shared so it is cheap to copy.
+    // Bits are kept in the BitTorrent wire order (the first piece is the most
+    // significant bit of the first byte) and the unused bits are always zero.
+    class Bitfield
+    {
+    public:
+        Bitfield() = default;
+        explicit Bitfield(const libtorrent::bitfield &nativeBitfield);
+
+        int size() const;
+        bool isEmpty() const;
+        bool testBit(int i) const;
+        bool operator[](int i) const;
+
+        int count() const;
+        // Returns the number of pieces set in "other" which are not set in this bitfield
+        int countMissing(const libtorrent::bitfield &other) const;
+
+        QBitArray toBitArray() const;
+
+    private:
+        QByteArray m_data;
+        int m_size = 0;
+        int m_count = 0;
+    };
+}
+
+#endif // BITTORRENT_BITFIELD_H
@@ -0,0 +1,177 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#include "filetree.h"
+
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+
+#include "base/global.h"
+#include "bitfield.h"
+
+using namespace BitTorrent;
+
+FileTree::FileTree(const TorrentInfo &info)
+{
+    if (!info.isValid()) return;
+
+    auto data = std::make_shared<Data>();
+    data->pieceLength = info.pieceLength();
+    data->piecesCount = info.piecesCount();
+
+    const int filesCount = info.filesCount();
+    data->files.reserve(filesCount);
+    data->folders.append({QString(), -1}); // root folder
+
+    // (parent folder, name) -> folder
+    QHash<QPair<int, QString>, int> folderIndexes;
+    for (int i = 0; i < filesCount; ++i) {
+        File file;
+        file.path = info.filePath(i);
+        file.size = info.fileSize(i);
+        file.offset = info.fileOffset(i);
+        file.firstPiece = static_cast<int>(file.offset / data->pieceLength);
+        file.lastPiece = static_cast<int>((file.offset + file.size - 1) / data->pieceLength);
+
+        QStringList pathParts = file.path.split('/', QString::SkipEmptyParts);
+        file.name = (pathParts.isEmpty() ? QString() : pathParts.takeLast());
+        file.folder = 0;
+        for (const QString &part : qAsConst(pathParts)) {
+            const QPair<int, QString> key {file.folder, part};
+            auto it = folderIndexes.constFind(key);
+            if (it == folderIndexes.constEnd()) {
+                data->folders.append({part, file.folder});
+                it = folderIndexes.insert(key, (data->folders.size() - 1));
+            }
+            file.folder = it.value();
+        }
+
+        data->files.append(file);
+    }
+
+    m_data = data;
+}
+
+bool FileTree::isEmpty() const
+{
+    return (filesCount() == 0);
+}
+
+int FileTree::pieceLength() const
+{
+    return (m_data ? m_data->pieceLength : 0);
+}
+
+int FileTree::piecesCount() const
+{
+    return (m_data ? m_data->piecesCount : 0);
+}
+
+int FileTree::filesCount() const
+{
+    return (m_data ? m_data->files.size() : 0);
+}
+
+QString FileTree::filePath(const int index) const
+{
+    return m_data->files[index].path;
+}
+
+QString FileTree::fileName(const int index) const
+{
+    return m_data->files[index].name;
+}
+
+qlonglong FileTree::fileSize(const int index) const
+{
+    return m_data->files[index].size;
+}
+
+qlonglong FileTree::fileOffset(const int index) const
+{
+    return m_data->files[index].offset;
+}
+
+TorrentInfo::PieceRange FileTree::filePieces(const int index) const
+{
+    const File &file = m_data->files[index];
+    return makeInterval(file.firstPiece, file.lastPiece);
+}
+
+int FileTree::fileFolder(const int index) const
+{
+    return m_data->files[index].folder;
+}
+
+int FileTree::foldersCount() const
+{
+    return (m_data ? m_data->folders.size() : 0);
+}
+
+QString FileTree::folderName(const int index) const
+{
+    return m_data->folders[index].name;
+}
+
+int FileTree::folderParent(const int index) const
+{
+    return m_data->folders[index].parent;
+}
+
+QVector<qreal> FileTree::filesProgress(const Bitfield &pieces) const
+{
+    const int filesCount = this->filesCount();
+    QVector<qreal> result;
+    result.reserve(filesCount);
+
+    const bool hasPieces = (pieces.size() == piecesCount());
+    for (int i = 0; i < filesCount; ++i) {
+        const File &file = m_data->files[i];
+        if (file.size <= 0) {
+            result << 1;
+            continue;
+        }
+
+        qlonglong done = 0;
+        if (hasPieces) {
+            const qlonglong fileEnd = file.offset + file.size;
+            for (int piece = file.firstPiece; piece <= file.lastPiece; ++piece) {
+                if (!pieces[piece]) continue;
+
+                const qlonglong pieceStart = static_cast<qlonglong>(piece) * m_data->pieceLength;
+                done += qMin(fileEnd, (pieceStart + m_data->pieceLength)) - qMax(file.offset, pieceStart);
+            }
+        }
+
+        result << ((done == file.size) ? 1 : (done / static_cast<qreal>(file.size)));
+    }
+
+    return result;
+}
@@ -0,0 +1,106 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#ifndef BITTORRENT_FILETREE_H
+#define BITTORRENT_FILETREE_H
+
+#include <memory>
+
+#include <QString>
+#include <QVector>
+
+#include "torrentinfo.h"
+
+namespace BitTorrent
+{
+    class Bitfield;
+
+    // Immutable layout of torrent files. File paths are split only once, folders
+    // are shared by all their files and piece ranges of the files are precomputed.
+    // It is implicitly shared so it is cheap to copy.
+    class FileTree
+    {
+    public:
+        FileTree() = default;
+        explicit FileTree(const TorrentInfo &info);
+
+        bool isEmpty() const;
+        int pieceLength() const;
+        int piecesCount() const;
+
+        int filesCount() const;
+        // relative path with '/' as separator
+        QString filePath(int index) const;
+        QString fileName(int index) const;
+        qlonglong fileSize(int index) const;
+        qlonglong fileOffset(int index) const;
+        TorrentInfo::PieceRange filePieces(int index) const;
+        // index of the folder which directly contains the file
+        int fileFolder(int index) const;
+
+        // the root folder is always the first one
+        int foldersCount() const;
+        QString folderName(int index) const;
+        // parent folders precede their subfolders, root folder has no parent (-1)
+        int folderParent(int index) const;
+
+        // Returns the progress of each file counting the downloaded pieces only
+        QVector<qreal> filesProgress(const Bitfield &pieces) const;
+
+    private:
+        struct File
+        {
+            QString path;
+            QString name;
+            int folder;
+            qlonglong size;
+            qlonglong offset;
+            int firstPiece;
+            int lastPiece;
+        };
+
+        struct Folder
+        {
+            QString name;
+            int parent;
+        };
+
+        struct Data
+        {
+            QVector<File> files;
+            QVector<Folder> folders;
+            int pieceLength = 0;
+            int piecesCount = 0;
+        };
+
+        std::shared_ptr<const Data> m_data;
+    };
+}
+
+#endif // BITTORRENT_FILETREE_H
@@ -246,24 +246,14 @@ QString PeerInfo::connectionType() const
 
 void PeerInfo::calcRelevance(const TorrentHandle *torrent)
 {
-    const QBitArray &allPieces = torrent->pieces();
-    const QBitArray &peerPieces = pieces();
-
-    int localMissing = 0;
-    int remoteHaves = 0;
-
-    for (int i = 0; i < allPieces.size(); ++i) {
-        if (!allPieces[i]) {
-            ++localMissing;
-            if (peerPieces[i])
-                ++remoteHaves;
-        }
-    }
+    // the torrent bitfield is shared by all its peers
+    const Bitfield allPieces = torrent->pieces();
+    const int localMissing = allPieces.size() - allPieces.count();
 
     if (localMissing == 0)
         m_relevance = 0.0;
     else
-        m_relevance = static_cast<qreal>(remoteHaves) / localMissing;
+        m_relevance = static_cast<qreal>(allPieces.countMissing(m_nativeInfo.pieces)) / localMissing;
 }
 
 qreal PeerInfo::relevance() const
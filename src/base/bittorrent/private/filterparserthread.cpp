@@ -28,374 +28,412 @@
 
 #include "filterparserthread.h"
 
+#include <algorithm>
 #include <cctype>
+#include <vector>
 
+#include <QCryptographicHash>
 #include <QDataStream>
+#include <QDateTime>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
 
 #include "base/logger.h"
+#include "base/profile.h"
+#include "base/utils/net.h"
 
 namespace libt = libtorrent;
 
+struct FilterParserThread::IPv4Range
+{
+    quint32 first;
+    quint32 last;
+};
+
+struct FilterParserThread::IPv6Range
+{
+    libt::address_v6::bytes_type first;
+    libt::address_v6::bytes_type last;
+};
+
+struct FilterParserThread::IPRanges
+{
+    std::vector<IPv4Range> v4;
+    std::vector<IPv6Range> v6;
+};
+
 namespace
 {
-    class IPv4Parser
-    {
-    public:
-        bool tryParse(const char *str)
-        {
-            unsigned char octetIndex = 0;
-
-            const char *octetStart = str;
-            char *endptr;
-            for (; *str; ++str) {
-                if (*str == '.') {
-                    long int extractedNum = strtol(octetStart, &endptr, 10);
-                    if ((extractedNum >= 0L) && (extractedNum <= 255L))
-                        m_buf[octetIndex++] = static_cast<unsigned char>(extractedNum);
-                    else
-                        return false;
-
-                    if (endptr != str)
-                        return false;
-                    if (octetIndex == 4)
-                        return true;
-
-                    octetStart = str + 1;
-                }
-            }
+    const int MAX_LOGGED_ERRORS = 5;
+    const int MIN_CHUNK_SIZE = 512 * 1024; // smaller files are parsed by a single thread
+    const int ABORT_CHECK_INTERVAL = 4096; // lines
 
-            if (str != octetStart) {
-                long int extractedNum = strtol(octetStart, &endptr, 10);
-                if ((extractedNum >= 0L) && (extractedNum <= 255L))
-                    m_buf[octetIndex] = static_cast<unsigned char>(strtol(octetStart, &endptr, 10));
-                else
-                    return false;
+    // Compiled rule set cache, written in native byte order
+    const char CACHE_FILENAME[] = "ipfilter.cache";
+    const quint32 CACHE_MAGIC = 0x51424950; // "QBIP"
+    const quint32 CACHE_VERSION = 1;
 
-                if ((endptr == str) && (octetIndex == 3))
-                    return true;
-            }
+    struct CacheHeader
+    {
+        quint32 magic;
+        quint32 version;
+        char key[16];
+        qint32 ruleCount;
+        qint32 v4Count;
+        qint32 v6Count;
+    };
 
-            return false;
-        }
+    enum class ParseError
+    {
+        Malformed,
+        MalformedStartIP,
+        MalformedEndIP,
+        MixedFamilies
+    };
 
-        libt::address_v4::bytes_type parsed() const
-        {
-            return m_buf;
-        }
+    struct LineError
+    {
+        int line;
+        ParseError error;
+    };
 
-    private:
-        libt::address_v4::bytes_type m_buf;
+    struct ParsedChunk
+    {
+        FilterParserThread::IPRanges ranges;
+        int ruleCount = 0;
+        int lineCount = 0;
+        int errorCount = 0;
+        std::vector<LineError> errors; // only the first MAX_LOGGED_ERRORS ones
     };
 
-    bool parseIPAddress(const char *data, libt::address &address)
+    bool isSpace(const char c)
     {
-        IPv4Parser parser;
-        boost::system::error_code ec;
+        return (isspace(static_cast<unsigned char>(c)) != 0);
+    }
 
-        if (parser.tryParse(data))
-            address = libt::address_v4(parser.parsed());
-        else
-            address = libt::address_v6::from_string(data, ec);
+    void trim(const char *&begin, const char *&end)
+    {
+        while ((begin < end) && isSpace(*begin))
+            ++begin;
+        while ((end > begin) && isSpace(*(end - 1)))
+            --end;
+    }
 
-        return !ec;
+    const char *findLast(const char *begin, const char *end, const char c)
+    {
+        for (const char *i = end; i > begin; --i) {
+            if (*(i - 1) == c)
+                return (i - 1);
+        }
+        return end;
     }
 
-    const int BUFFER_SIZE = 2 * 1024 * 1024; // 2 MiB
-    const int MAX_LOGGED_ERRORS = 5;
-}
+    // Mimics strtol(): leading spaces, optional sign and digits, 0 if there are none
+    long parseLong(const char *begin, const char *end)
+    {
+        while ((begin < end) && isSpace(*begin))
+            ++begin;
 
-FilterParserThread::FilterParserThread(QObject *parent)
-    : QThread(parent)
-    , m_abort(false)
-{
-}
+        bool isNegative = false;
+        if ((begin < end) && ((*begin == '-') || (*begin == '+'))) {
+            isNegative = (*begin == '-');
+            ++begin;
+        }
 
-FilterParserThread::~FilterParserThread()
-{
-    m_abort = true;
-    wait();
-}
+        long result = 0;
+        for (; (begin < end) && (*begin >= '0') && (*begin <= '9'); ++begin) {
+            result = (result * 10) + (*begin - '0');
+            if (result > 0xFFFF) break; // large enough for access levels
+        }
 
-// Parser for eMule ip filter in DAT format
-int FilterParserThread::parseDATFilterFile()
-{
-    int ruleCount = 0;
-    QFile file(m_filePath);
-    if (!file.exists()) return ruleCount;
+        return (isNegative ? -result : result);
+    }
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
-        return ruleCount;
+    bool parseIPv6(const char *begin, const char *end, libt::address_v6::bytes_type &address)
+    {
+        QIPv6Address parsed;
+        if (!Utils::Net::parseIPv6(begin, end, parsed))
+            return false;
+
+        std::copy(parsed.c, (parsed.c + 16), address.begin());
+        return true;
     }
 
-    std::vector<char> buffer(BUFFER_SIZE, 0); // seems a bit faster than QVector
-    qint64 bytesRead = 0;
-    int offset = 0;
-    int start = 0;
-    int endOfLine = -1;
-    int nbLine = 0;
-    int parseErrorCount = 0;
-    const auto addLog = [&parseErrorCount](const QString &msg)
+    bool addIPv4Range(FilterParserThread::IPRanges &ranges, const quint32 first, const quint32 last)
     {
-        if (parseErrorCount <= MAX_LOGGED_ERRORS)
-            LogMsg(msg, Log::CRITICAL);
-    };
+        if (first > last)
+            return false;
 
-    while (true) {
-        bytesRead = file.read(buffer.data() + offset, BUFFER_SIZE - offset - 1);
-        if (bytesRead < 0)
-            break;
-        int dataSize = bytesRead + offset;
-        if ((bytesRead == 0) && (dataSize == 0))
-            break;
-
-        for (start = 0; start < dataSize; ++start) {
-            endOfLine = -1;
-            // The file might have ended without the last line having a newline
-            if (!((bytesRead == 0) && (dataSize > 0))) {
-                for (int i = start; i < dataSize; ++i) {
-                    if (buffer[i] == '\n') {
-                        endOfLine = i;
-                        // We need to NULL the newline in case the line has only an IP range.
-                        // In that case the parser won't work for the end IP, because it ends
-                        // with the newline and not with a number.
-                        buffer[i] = '\0';
-                        break;
-                    }
-                }
-            }
-            else {
-                endOfLine = dataSize;
-                buffer[dataSize] = '\0';
-            }
+        ranges.v4.push_back({first, last});
+        return true;
+    }
 
-            if (endOfLine == -1) {
-                // read the next chunk from file
-                // but first move(copy) the leftover data to the front of the buffer
-                offset = dataSize - start;
-                memmove(buffer.data(), buffer.data() + start, offset);
-                break;
-            }
-            else {
-                ++nbLine;
-            }
+    // Parses "first - last", each side is trimmed
+    // "dataEnd" is the end of the mapped file, the IPv4 parser may read up to it
+    bool parseIPRange(const char *begin, const char *dash, const char *end, const char *dataEnd, FilterParserThread::IPRanges &ranges, ParseError &error)
+    {
+        const char *firstBegin = begin;
+        const char *firstEnd = dash;
+        trim(firstBegin, firstEnd);
+        const char *lastBegin = dash + 1;
+        const char *lastEnd = end;
+        trim(lastBegin, lastEnd);
+
+        quint32 firstIPv4 = 0;
+        libt::address_v6::bytes_type firstIPv6;
+        const bool isFirstIPv4 = Utils::Net::parseIPv4(firstBegin, firstEnd, firstIPv4, dataEnd);
+        if (!isFirstIPv4 && !parseIPv6(firstBegin, firstEnd, firstIPv6)) {
+            error = ParseError::MalformedStartIP;
+            return false;
+        }
 
-            if ((buffer[start] == '#')
-                || ((buffer[start] == '/') && ((start + 1 < dataSize) && (buffer[start + 1] == '/')))) {
-                start = endOfLine;
-                continue;
+        quint32 lastIPv4 = 0;
+        libt::address_v6::bytes_type lastIPv6;
+        const bool isLastIPv4 = Utils::Net::parseIPv4(lastBegin, lastEnd, lastIPv4, dataEnd);
+        if (!isLastIPv4 && !parseIPv6(lastBegin, lastEnd, lastIPv6)) {
+            error = ParseError::MalformedEndIP;
+            return false;
+        }
+
+        if (isFirstIPv4 != isLastIPv4) {
+            error = ParseError::MixedFamilies;
+            return false;
+        }
+
+        if (isFirstIPv4) {
+            if (!addIPv4Range(ranges, firstIPv4, lastIPv4)) {
+                error = ParseError::Malformed;
+                return false;
+            }
+        }
+        else {
+            if (lastIPv6 < firstIPv6) {
+                error = ParseError::Malformed;
+                return false;
             }
+            ranges.v6.push_back({firstIPv6, lastIPv6});
+        }
 
-            // Each line should follow this format:
-            // 001.009.096.105 - 001.009.096.105 , 000 , Some organization
-            // The 3rd entry is access level and if above 127 the IP range isn't blocked.
-            int firstComma = findAndNullDelimiter(buffer.data(), ',', start, endOfLine);
-            if (firstComma != -1)
-                findAndNullDelimiter(buffer.data(), ',', firstComma + 1, endOfLine);
+        return true;
+    }
 
+    // eMule ip filter in DAT format
+    // Each line should follow this format:
+    // 001.009.096.105 - 001.009.096.105 , 000 , Some organization
+    // The 3rd entry is access level and if above 127 the IP range isn't blocked.
+    bool parseDATLine(const char *begin, const char *end, const char *dataEnd, FilterParserThread::IPRanges &ranges, bool &isIgnored, ParseError &error)
+    {
+        const char *firstComma = std::find(begin, end, ',');
+        if (firstComma != end) {
             // Check if there is an access value (apparently not mandatory)
-            if (firstComma != -1) {
-                // There is possibly one
-                const long int nbAccess = strtol(buffer.data() + firstComma + 1, nullptr, 10);
-                // Ignoring this rule because access value is too high
-                if (nbAccess > 127L) {
-                    start = endOfLine;
-                    continue;
-                }
+            const char *secondComma = std::find((firstComma + 1), end, ',');
+            // Ignoring this rule because access value is too high
+            if (parseLong((firstComma + 1), secondComma) > 127L) {
+                isIgnored = true;
+                return true;
             }
+        }
 
-            // IP Range should be split by a dash
-            int endOfIPRange = ((firstComma == -1) ? (endOfLine - 1) : (firstComma - 1));
-            int delimIP = findAndNullDelimiter(buffer.data(), '-', start, endOfIPRange);
-            if (delimIP == -1) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+        // IP Range should be split by a dash
+        const char *dash = std::find(begin, firstComma, '-');
+        if (dash == firstComma) {
+            error = ParseError::Malformed;
+            return false;
+        }
 
-            libt::address startAddr;
-            int newStart = trim(buffer.data(), start, delimIP - 1);
-            if (!parseIPAddress(buffer.data() + newStart, startAddr)) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. Start IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+        return parseIPRange(begin, dash, firstComma, dataEnd, ranges, error);
+    }
 
-            libt::address endAddr;
-            newStart = trim(buffer.data(), delimIP + 1, endOfIPRange);
-            if (!parseIPAddress(buffer.data() + newStart, endAddr)) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. End IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+    // PeerGuardian ip filter in p2p format
+    // Each line should follow this format:
+    // Some organization:1.0.0.0-1.255.255.255
+    // The "Some organization" part might contain a ':' char itself so we find the last occurrence
+    bool parseP2PLine(const char *begin, const char *end, const char *dataEnd, FilterParserThread::IPRanges &ranges, bool &isIgnored, ParseError &error)
+    {
+        Q_UNUSED(isIgnored);
+
+        const char *partsDelimiter = findLast(begin, end, ':');
+        if (partsDelimiter == end) {
+            error = ParseError::Malformed;
+            return false;
+        }
+
+        // IP Range should be split by a dash
+        const char *dash = std::find((partsDelimiter + 1), end, '-');
+        if (dash == end) {
+            error = ParseError::Malformed;
+            return false;
+        }
 
-            if ((startAddr.is_v4() != endAddr.is_v4())
-                || (startAddr.is_v6() != endAddr.is_v6())) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. One IP is IPv4 and the other is IPv6!").arg(nbLine));
-                start = endOfLine;
+        return parseIPRange((partsDelimiter + 1), dash, end, dataEnd, ranges, error);
+    }
+
+    using LineParser = bool (*)(const char *begin, const char *end, const char *dataEnd, FilterParserThread::IPRanges &ranges, bool &isIgnored, ParseError &error);
+
+    void parseChunk(const char *begin, const char *end, const char *dataEnd, const LineParser parseLine, const volatile bool &abort, ParsedChunk &result)
+    {
+        const char *lineBegin = begin;
+        while (lineBegin < end) {
+            if (((result.lineCount % ABORT_CHECK_INTERVAL) == 0) && abort)
+                return;
+
+            const char *lineEnd = static_cast<const char *>(memchr(lineBegin, '\n', (end - lineBegin)));
+            if (!lineEnd)
+                lineEnd = end;
+            ++result.lineCount;
+
+            const char *contentBegin = lineBegin;
+            const char *contentEnd = lineEnd;
+            lineBegin = lineEnd + 1;
+
+            trim(contentBegin, contentEnd);
+            if ((contentBegin == contentEnd) || (*contentBegin == '#')
+                || ((*contentBegin == '/') && ((contentBegin + 1) < contentEnd) && (*(contentBegin + 1) == '/'))) {
                 continue;
             }
 
-            start = endOfLine;
-
-            // Now Add to the filter
-            try {
-                m_filter.add_rule(startAddr, endAddr, libt::ip_filter::blocked);
-                ++ruleCount;
+            bool isIgnored = false;
+            ParseError error = ParseError::Malformed;
+            if (!parseLine(contentBegin, contentEnd, dataEnd, result.ranges, isIgnored, error)) {
+                ++result.errorCount;
+                if (static_cast<int>(result.errors.size()) < MAX_LOGGED_ERRORS)
+                    result.errors.push_back({result.lineCount, error});
             }
-            catch (std::exception &e) {
-                ++parseErrorCount;
-                addLog(tr("IP filter exception thrown for line %1. Exception is: %2")
-                       .arg(nbLine).arg(QString::fromLocal8Bit(e.what())));
+            else if (!isIgnored) {
+                ++result.ruleCount;
             }
         }
-
-        if (start >= dataSize)
-            offset = 0;
     }
 
-    if (parseErrorCount > MAX_LOGGED_ERRORS)
-        LogMsg(tr("%1 extra IP filter parsing errors occurred.", "513 extra IP filter parsing errors occurred.")
-               .arg(parseErrorCount - MAX_LOGGED_ERRORS), Log::CRITICAL);
-    return ruleCount;
-}
+    class ParseChunkTask : public QRunnable
+    {
+    public:
+        ParseChunkTask(const char *begin, const char *end, const char *dataEnd, const LineParser parseLine, const volatile bool &abort, ParsedChunk &result)
+            : m_begin(begin)
+            , m_end(end)
+            , m_dataEnd(dataEnd)
+            , m_parseLine(parseLine)
+            , m_abort(abort)
+            , m_result(result)
+        {
+        }
 
-// Parser for PeerGuardian ip filter in p2p format
-int FilterParserThread::parseP2PFilterFile()
-{
-    int ruleCount = 0;
-    QFile file(m_filePath);
-    if (!file.exists()) return ruleCount;
+        void run() override
+        {
+            parseChunk(m_begin, m_end, m_dataEnd, m_parseLine, m_abort, m_result);
+        }
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
-        return ruleCount;
-    }
+    private:
+        const char *const m_begin;
+        const char *const m_end;
+        const char *const m_dataEnd;
+        const LineParser m_parseLine;
+        const volatile bool &m_abort;
+        ParsedChunk &m_result;
+    };
 
-    std::vector<char> buffer(BUFFER_SIZE, 0); // seems a bit faster than QVector
-    qint64 bytesRead = 0;
-    int offset = 0;
-    int start = 0;
-    int endOfLine = -1;
-    int nbLine = 0;
-    int parseErrorCount = 0;
-    const auto addLog = [&parseErrorCount](const QString &msg)
+    // Sorts the ranges and merges the overlapping (and for IPv4, adjacent) ones
+    template <typename Range, typename IsMergeable>
+    void mergeRanges(std::vector<Range> &ranges, IsMergeable isMergeable)
     {
-        if (parseErrorCount <= MAX_LOGGED_ERRORS)
-            LogMsg(msg, Log::CRITICAL);
-    };
+        if (ranges.empty()) return;
 
-    while (true) {
-        bytesRead = file.read(buffer.data() + offset, BUFFER_SIZE - offset - 1);
-        if (bytesRead < 0)
-            break;
-        int dataSize = bytesRead + offset;
-        if ((bytesRead == 0) && (dataSize == 0))
-            break;
-
-        for (start = 0; start < dataSize; ++start) {
-            endOfLine = -1;
-            // The file might have ended without the last line having a newline
-            if (!((bytesRead == 0) && (dataSize > 0))) {
-                for (int i = start; i < dataSize; ++i) {
-                    if (buffer[i] == '\n') {
-                        endOfLine = i;
-                        // We need to NULL the newline in case the line has only an IP range.
-                        // In that case the parser won't work for the end IP, because it ends
-                        // with the newline and not with a number.
-                        buffer[i] = '\0';
-                        break;
-                    }
-                }
-            }
-            else {
-                endOfLine = dataSize;
-                buffer[dataSize] = '\0';
-            }
+        std::sort(ranges.begin(), ranges.end(), [](const Range &left, const Range &right) { return (left.first < right.first); });
 
-            if (endOfLine == -1) {
-                // read the next chunk from file
-                // but first move(copy) the leftover data to the front of the buffer
-                offset = dataSize - start;
-                memmove(buffer.data(), buffer.data() + start, offset);
-                break;
+        auto merged = ranges.begin();
+        for (auto i = (ranges.begin() + 1); i != ranges.end(); ++i) {
+            if (isMergeable(*merged, *i)) {
+                if (merged->last < i->last)
+                    merged->last = i->last;
             }
             else {
-                ++nbLine;
-            }
-
-            if ((buffer[start] == '#')
-                || ((buffer[start] == '/') && ((start + 1 < dataSize) && (buffer[start + 1] == '/')))) {
-                start = endOfLine;
-                continue;
-            }
-
-            // Each line should follow this format:
-            // Some organization:1.0.0.0-1.255.255.255
-            // The "Some organization" part might contain a ':' char itself so we find the last occurrence
-            int partsDelimiter = findAndNullDelimiter(buffer.data(), ':', start, endOfLine, true);
-            if (partsDelimiter == -1) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
-
-            // IP Range should be split by a dash
-            int delimIP = findAndNullDelimiter(buffer.data(), '-', partsDelimiter + 1, endOfLine);
-            if (delimIP == -1) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
+                *(++merged) = *i;
             }
+        }
+        ranges.erase((merged + 1), ranges.end());
+    }
 
-            libt::address startAddr;
-            int newStart = trim(buffer.data(), partsDelimiter + 1, delimIP - 1);
-            if (!parseIPAddress(buffer.data() + newStart, startAddr)) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. Start IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+    QString cacheFilePath()
+    {
+        return specialFolderLocation(SpecialFolder::Cache) + QLatin1Char('/') + QLatin1String(CACHE_FILENAME);
+    }
+}
 
-            libt::address endAddr;
-            newStart = trim(buffer.data(), delimIP + 1, endOfLine);
-            if (!parseIPAddress(buffer.data() + newStart, endAddr)) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. End IP of the range is malformed.").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+FilterParserThread::FilterParserThread(QObject *parent)
+    : QThread(parent)
+    , m_abort(false)
+{
+}
 
-            if ((startAddr.is_v4() != endAddr.is_v4())
-                || (startAddr.is_v6() != endAddr.is_v6())) {
-                ++parseErrorCount;
-                addLog(tr("IP filter line %1 is malformed. One IP is IPv4 and the other is IPv6!").arg(nbLine));
-                start = endOfLine;
-                continue;
-            }
+FilterParserThread::~FilterParserThread()
+{
+    m_abort = true;
+    wait();
+}
 
-            start = endOfLine;
+// Parser for the text formats (DAT and P2P)
+// The file is memory mapped, split at line boundaries and the chunks are parsed in parallel
+int FilterParserThread::parseTextFilterFile(const uchar *data, const qint64 size, const TextFormat format, IPRanges &ranges)
+{
+    const LineParser parseLine = (format == TextFormat::P2P) ? parseP2PLine : parseDATLine;
+    const char *const begin = reinterpret_cast<const char *>(data);
+    const char *const end = begin + size;
+
+    const int chunkCount = qBound<qint64>(1, (size / MIN_CHUNK_SIZE), QThread::idealThreadCount());
+    std::vector<ParsedChunk> chunks(chunkCount);
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(chunkCount);
+    const char *chunkBegin = begin;
+    for (int i = 0; i < chunkCount; ++i) {
+        const char *chunkEnd = (i == (chunkCount - 1)) ? end : (begin + ((size * (i + 1)) / chunkCount));
+        if (chunkEnd < chunkBegin)
+            chunkEnd = chunkBegin;
+        // move the boundary past the end of the line
+        const char *newLine = static_cast<const char *>(memchr(chunkEnd, '\n', (end - chunkEnd)));
+        if (chunkEnd != end)
+            chunkEnd = newLine ? (newLine + 1) : end;
+
+        threadPool.start(new ParseChunkTask(chunkBegin, chunkEnd, end, parseLine, m_abort, chunks[i]));
+        chunkBegin = chunkEnd;
+    }
+    threadPool.waitForDone();
 
-            try {
-                m_filter.add_rule(startAddr, endAddr, libt::ip_filter::blocked);
-                ++ruleCount;
-            }
-            catch (std::exception &e) {
-                ++parseErrorCount;
-                addLog(tr("IP filter exception thrown for line %1. Exception is: %2")
-                       .arg(nbLine).arg(QString::fromLocal8Bit(e.what())));
+    int ruleCount = 0;
+    int lineCount = 0;
+    int parseErrorCount = 0;
+    for (const ParsedChunk &chunk : chunks) {
+        for (const LineError &lineError : chunk.errors) {
+            if (parseErrorCount >= MAX_LOGGED_ERRORS) break;
+
+            const int line = lineCount + lineError.line;
+            switch (lineError.error) {
+            case ParseError::Malformed:
+                LogMsg(tr("IP filter line %1 is malformed.").arg(line), Log::CRITICAL);
+                break;
+            case ParseError::MalformedStartIP:
+                LogMsg(tr("IP filter line %1 is malformed. Start IP of the range is malformed.").arg(line), Log::CRITICAL);
+                break;
+            case ParseError::MalformedEndIP:
+                LogMsg(tr("IP filter line %1 is malformed. End IP of the range is malformed.").arg(line), Log::CRITICAL);
+                break;
+            case ParseError::MixedFamilies:
+                LogMsg(tr("IP filter line %1 is malformed. One IP is IPv4 and the other is IPv6!").arg(line), Log::CRITICAL);
+                break;
             }
+            ++parseErrorCount;
         }
+        parseErrorCount += chunk.errorCount - static_cast<int>(chunk.errors.size());
 
-        if (start >= dataSize)
-            offset = 0;
+        ruleCount += chunk.ruleCount;
+        lineCount += chunk.lineCount;
+        ranges.v4.insert(ranges.v4.end(), chunk.ranges.v4.cbegin(), chunk.ranges.v4.cend());
+        ranges.v6.insert(ranges.v6.end(), chunk.ranges.v6.cbegin(), chunk.ranges.v6.cend());
     }
 
     if (parseErrorCount > MAX_LOGGED_ERRORS)
@@ -428,7 +466,7 @@ int FilterParserThread::getlineInStream(QDataStream &stream, std::string &name,
 }
 
 // Parser for PeerGuardian ip filter in p2p format
-int FilterParserThread::parseP2BFilterFile()
+int FilterParserThread::parseP2BFilterFile(IPRanges &ranges)
 {
     int ruleCount = 0;
     QFile file(m_filePath);
@@ -463,16 +501,8 @@ int FilterParserThread::parseP2BFilterFile()
             }
 
             // Network byte order to Host byte order
-            // asio address_v4 constructor expects it
-            // that way
-            libt::address_v4 first(ntohl(start));
-            libt::address_v4 last(ntohl(end));
-            // Apply to bittorrent session
-            try {
-                m_filter.add_rule(first, last, libt::ip_filter::blocked);
+            if (addIPv4Range(ranges, ntohl(start), ntohl(end)))
                 ++ruleCount;
-            }
-            catch (std::exception &) {}
         }
     }
     else if (version == 3) {
@@ -513,16 +543,8 @@ int FilterParserThread::parseP2BFilterFile()
             }
 
             // Network byte order to Host byte order
-            // asio address_v4 constructor expects it
-            // that way
-            libt::address_v4 first(ntohl(start));
-            libt::address_v4 last(ntohl(end));
-            // Apply to bittorrent session
-            try {
-                m_filter.add_rule(first, last, libt::ip_filter::blocked);
+            if (addIPv4Range(ranges, ntohl(start), ntohl(end)))
                 ++ruleCount;
-            }
-            catch (std::exception &) {}
 
             if (m_abort) return ruleCount;
         }
@@ -534,6 +556,63 @@ int FilterParserThread::parseP2BFilterFile()
     return ruleCount;
 }
 
+bool FilterParserThread::loadCache(const QByteArray &key, IPRanges &ranges, int &ruleCount) const
+{
+    QFile file(cacheFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    CacheHeader header;
+    if ((file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header))
+        || (header.magic != CACHE_MAGIC) || (header.version != CACHE_VERSION)
+        || (memcmp(header.key, key.constData(), sizeof(header.key)) != 0)
+        || (header.v4Count < 0) || (header.v6Count < 0)) {
+        return false;
+    }
+
+    const qint64 v4Size = static_cast<qint64>(header.v4Count) * sizeof(IPv4Range);
+    const qint64 v6Size = static_cast<qint64>(header.v6Count) * sizeof(IPv6Range);
+    if (file.size() != static_cast<qint64>(sizeof(header) + v4Size + v6Size))
+        return false;
+
+    ranges.v4.resize(header.v4Count);
+    ranges.v6.resize(header.v6Count);
+    if ((file.read(reinterpret_cast<char *>(ranges.v4.data()), v4Size) != v4Size)
+        || (file.read(reinterpret_cast<char *>(ranges.v6.data()), v6Size) != v6Size)) {
+        ranges = IPRanges();
+        return false;
+    }
+
+    ruleCount = header.ruleCount;
+    return true;
+}
+
+void FilterParserThread::saveCache(const QByteArray &key, const IPRanges &ranges, const int ruleCount) const
+{
+    const QString filePath = cacheFilePath();
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    CacheHeader header;
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    memcpy(header.key, key.constData(), sizeof(header.key));
+    header.ruleCount = ruleCount;
+    header.v4Count = static_cast<qint32>(ranges.v4.size());
+    header.v6Count = static_cast<qint32>(ranges.v6.size());
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug("Could not write IP filter cache: %s", qUtf8Printable(file.errorString()));
+        return;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(ranges.v4.data()), (ranges.v4.size() * sizeof(IPv4Range)));
+    file.write(reinterpret_cast<const char *>(ranges.v6.data()), (ranges.v6.size() * sizeof(IPv6Range)));
+    if (!file.commit())
+        qDebug("Could not write IP filter cache: %s", qUtf8Printable(file.errorString()));
+}
+
 // Process ip filter file
 // Supported formats:
 //  * eMule IP list (DAT): http://wiki.phoenixlabs.org/wiki/DAT_Format
@@ -563,74 +642,85 @@ void FilterParserThread::run()
 {
     qDebug("Processing filter file");
     int ruleCount = 0;
-    if (m_filePath.endsWith(".p2p", Qt::CaseInsensitive)) {
-        // PeerGuardian p2p file
-        ruleCount = parseP2PFilterFile();
-    }
-    else if (m_filePath.endsWith(".p2b", Qt::CaseInsensitive)) {
-        // PeerGuardian p2b file
-        ruleCount = parseP2BFilterFile();
-    }
-    else if (m_filePath.endsWith(".dat", Qt::CaseInsensitive)) {
-        // eMule DAT format
-        ruleCount = parseDATFilterFile();
-    }
+    IPRanges ranges;
 
-    if (m_abort) return;
+    QFile file(m_filePath);
+    if (file.exists() && !file.open(QIODevice::ReadOnly))
+        LogMsg(tr("I/O Error: Could not open IP filter file in read mode."), Log::CRITICAL);
 
-    try {
-        emit IPFilterParsed(ruleCount);
-    }
-    catch (std::exception &) {
-        emit IPFilterError();
+    const qint64 fileSize = file.size();
+    const uchar *data = nullptr;
+    uchar *mappedData = nullptr;
+    QByteArray fileContent;
+    if (file.isOpen() && (fileSize > 0)) {
+        mappedData = file.map(0, fileSize);
+        if (!mappedData) {
+            // mapping isn't supported everywhere, fall back to reading the whole file
+            fileContent = file.readAll();
+        }
+        data = mappedData ? mappedData : reinterpret_cast<const uchar *>(fileContent.constData());
     }
 
-    qDebug("IP Filter thread: finished parsing, filter applied");
-}
-
-int FilterParserThread::findAndNullDelimiter(char *const data, char delimiter, int start, int end, bool reverse)
-{
-    if (!reverse) {
-        for (int i = start; i <= end; ++i) {
-            if (data[i] == delimiter) {
-                data[i] = '\0';
-                return i;
-            }
+    if (data && (fileContent.isEmpty() || (fileContent.size() == fileSize))) {
+        // The compiled rules are cached, keyed by the file path, its modification time and its content
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        hash.addData(m_filePath.toUtf8());
+        hash.addData(QByteArray::number(QFileInfo(file).lastModified().toMSecsSinceEpoch()));
+        hash.addData(QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char *>(data), fileSize)
+                                              , QCryptographicHash::Md5));
+        const QByteArray cacheKey = hash.result();
+
+        if (loadCache(cacheKey, ranges, ruleCount)) {
+            qDebug("IP filter loaded from cache");
         }
-    }
-    else {
-        for (int i = end; i >= start; --i) {
-            if (data[i] == delimiter) {
-                data[i] = '\0';
-                return i;
+        else {
+            if (m_filePath.endsWith(".p2p", Qt::CaseInsensitive)) {
+                // PeerGuardian p2p file
+                ruleCount = parseTextFilterFile(data, fileSize, TextFormat::P2P, ranges);
+            }
+            else if (m_filePath.endsWith(".p2b", Qt::CaseInsensitive)) {
+                // PeerGuardian p2b file
+                ruleCount = parseP2BFilterFile(ranges);
+            }
+            else if (m_filePath.endsWith(".dat", Qt::CaseInsensitive)) {
+                // eMule DAT format
+                ruleCount = parseTextFilterFile(data, fileSize, TextFormat::DAT, ranges);
             }
-        }
-    }
 
-    return -1;
-}
+            if (m_abort) return;
 
-int FilterParserThread::trim(char *const data, int start, int end)
-{
-    if (start >= end) return start;
-    int newStart = start;
+            mergeRanges(ranges.v4, [](const IPv4Range &merged, const IPv4Range &range)
+            {
+                return ((merged.last == 0xFFFFFFFF) || (range.first <= (merged.last + 1)));
+            });
+            mergeRanges(ranges.v6, [](const IPv6Range &merged, const IPv6Range &range)
+            {
+                return !(merged.last < range.first);
+            });
 
-    for (int i = start; i <= end; ++i) {
-        if (isspace(data[i]) != 0) {
-            data[i] = '\0';
-        }
-        else {
-            newStart = i;
-            break;
+            saveCache(cacheKey, ranges, ruleCount);
         }
+
+        if (mappedData)
+            file.unmap(mappedData);
     }
 
-    for (int i = end; i >= start; --i) {
-        if (isspace(data[i]) != 0)
-            data[i] = '\0';
-        else
-            break;
+    // The ranges are sorted and don't overlap which keeps inserting them cheap
+    for (const IPv4Range &range : ranges.v4) {
+        if (m_abort) return;
+        m_filter.add_rule(libt::address_v4(range.first), libt::address_v4(range.last), libt::ip_filter::blocked);
+    }
+    for (const IPv6Range &range : ranges.v6) {
+        if (m_abort) return;
+        m_filter.add_rule(libt::address_v6(range.first), libt::address_v6(range.last), libt::ip_filter::blocked);
     }
 
-    return newStart;
+    try {
+        emit IPFilterParsed(ruleCount);
+    }
+    catch (std::exception &) {
+        emit IPFilterError();
+    }
+
+    qDebug("IP Filter thread: finished parsing, filter applied");
 }
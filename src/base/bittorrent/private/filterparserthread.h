@@ -40,6 +40,10 @@ class FilterParserThread : public QThread
     Q_OBJECT
 
 public:
+    struct IPv4Range;
+    struct IPv6Range;
+    struct IPRanges;
+
     FilterParserThread(QObject *parent = nullptr);
     ~FilterParserThread();
     void processFilterFile(const QString &filePath);
@@ -53,14 +57,20 @@ protected:
     void run();
 
 private:
-    int findAndNullDelimiter(char *const data, char delimiter, int start, int end, bool reverse = false);
-    int trim(char *const data, int start, int end);
-    int parseDATFilterFile();
-    int parseP2PFilterFile();
+    enum class TextFormat
+    {
+        DAT,
+        P2P
+    };
+
+    int parseTextFilterFile(const uchar *data, qint64 size, TextFormat format, IPRanges &ranges);
     int getlineInStream(QDataStream &stream, std::string &name, char delim);
-    int parseP2BFilterFile();
+    int parseP2BFilterFile(IPRanges &ranges);
+
+    bool loadCache(const QByteArray &key, IPRanges &ranges, int &ruleCount) const;
+    void saveCache(const QByteArray &key, const IPRanges &ranges, int ruleCount) const;
 
-    bool m_abort;
+    volatile bool m_abort;
     QString m_filePath;
     libtorrent::ip_filter m_filter;
 };
@@ -0,0 +1,401 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#include "resumedatabase.h"
+
+#include <cstring>
+
+#include <QDebug>
+#include <QDir>
+#include <QRegExp>
+#include <QSaveFile>
+#include <QStringList>
+#include <QtEndian>
+
+#include <zlib.h>
+
+#include "base/global.h"
+#include "base/logger.h"
+#include "base/utils/fs.h"
+
+namespace
+{
+    const char MAGIC[] = {'q', 'B', 't', 'R', 'D', 'B', '0', '1'};
+    const qint64 MAGIC_SIZE = sizeof(MAGIC);
+
+    // Record layout (little-endian):
+    // [0..3]   payload size
+    // [4]      record type
+    // [5..24]  info hash
+    // [25..28] CRC32 of the bytes [0..24] followed by the payload
+    const int HASH_SIZE = 20;
+    const int CHECKSUM_OFFSET = 5 + HASH_SIZE;
+    const int RECORD_HEADER_SIZE = CHECKSUM_OFFSET + 4;
+
+    enum RecordType
+    {
+        StoreRecord = 1,
+        RemoveRecord = 2
+    };
+
+    // Don't bother rewriting small files
+    const qint64 COMPACTION_MIN_SIZE = 8 * 1024 * 1024;
+    // Flush while importing so the whole folder isn't kept in memory
+    const int IMPORT_BATCH_SIZE = 4 * 1024 * 1024;
+
+    quint32 recordChecksum(const uchar *header, const char *payload, quint32 payloadSize)
+    {
+        uLong crc = crc32(0L, Z_NULL, 0);
+        crc = crc32(crc, header, CHECKSUM_OFFSET);
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(payload), payloadSize);
+        return static_cast<quint32>(crc);
+    }
+
+    // Calls handler(type, rawHash, recordOffset, recordSize) for each valid record
+    // and returns the size of the valid part of the data or -1 if it isn't a database at all
+    template <typename Handler>
+    qint64 scanRecords(const uchar *data, const qint64 size, Handler handler)
+    {
+        if ((size < MAGIC_SIZE) || (std::memcmp(data, MAGIC, MAGIC_SIZE) != 0))
+            return -1;
+
+        qint64 pos = MAGIC_SIZE;
+        while ((size - pos) >= RECORD_HEADER_SIZE) {
+            const uchar *header = data + pos;
+            const quint32 payloadSize = qFromLittleEndian<quint32>(header);
+            const int type = header[4];
+            if ((size - pos - RECORD_HEADER_SIZE) < payloadSize) break;
+            if ((type != StoreRecord) && (type != RemoveRecord)) break;
+
+            const char *payload = reinterpret_cast<const char *>(header + RECORD_HEADER_SIZE);
+            if (qFromLittleEndian<quint32>(header + CHECKSUM_OFFSET) != recordChecksum(header, payload, payloadSize))
+                break;
+
+            const QByteArray rawHash(reinterpret_cast<const char *>(header + 5), HASH_SIZE);
+            const qint64 recordSize = RECORD_HEADER_SIZE + payloadSize;
+            handler(type, rawHash, pos, recordSize);
+            pos += recordSize;
+        }
+
+        return pos;
+    }
+
+    QByteArray toRawHash(const QString &hash)
+    {
+        return QByteArray::fromHex(hash.toLatin1());
+    }
+
+    QString fromRawHash(const QByteArray &rawHash)
+    {
+        return QString::fromLatin1(rawHash.toHex());
+    }
+}
+
+ResumeDatabase::ResumeDatabase(const QString &path)
+    : m_file(path)
+    , m_fileSize(0)
+    , m_liveSize(0)
+{
+}
+
+ResumeDatabase::~ResumeDatabase()
+{
+    flush();
+}
+
+bool ResumeDatabase::open()
+{
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Unbuffered))
+        return false;
+
+    m_index.clear();
+    m_liveSize = 0;
+    m_fileSize = m_file.size();
+    if (m_fileSize == 0) {
+        if (m_file.write(MAGIC, MAGIC_SIZE) != MAGIC_SIZE) {
+            m_file.close();
+            return false;
+        }
+        m_fileSize = MAGIC_SIZE;
+        return m_file.flush();
+    }
+
+    uchar *data = m_file.map(0, m_fileSize);
+    if (!data) {
+        m_file.close();
+        return false;
+    }
+
+    const qint64 validSize = scanRecords(data, m_fileSize
+        , [this](int type, const QByteArray &rawHash, qint64 offset, qint64 size)
+    {
+        const auto it = m_index.find(rawHash);
+        if (it != m_index.end()) {
+            m_liveSize -= it->size;
+            m_index.erase(it);
+        }
+
+        if (type == StoreRecord) {
+            m_index.insert(rawHash, {offset, size});
+            m_liveSize += size;
+        }
+    });
+    m_file.unmap(data);
+
+    if (validSize < 0) {
+        LogMsg(QString("'%1' is not a resume database.").arg(Utils::Fs::toNativePath(m_file.fileName())), Log::WARNING);
+        m_file.close();
+        return false;
+    }
+
+    if (validSize < m_fileSize) {
+        LogMsg(QString("Resume database '%1' has a damaged tail, %2 bytes were dropped.")
+               .arg(Utils::Fs::toNativePath(m_file.fileName())).arg(m_fileSize - validSize), Log::WARNING);
+        m_file.resize(validSize);
+        m_fileSize = validSize;
+    }
+
+    return m_file.seek(m_fileSize);
+}
+
+QString ResumeDatabase::errorString() const
+{
+    return m_file.errorString();
+}
+
+void ResumeDatabase::store(const QString &hash, const QByteArray &data)
+{
+    const QByteArray rawHash = toRawHash(hash);
+    if (rawHash.size() != HASH_SIZE) return;
+
+    const Record record {m_fileSize + m_pending.size(), RECORD_HEADER_SIZE + data.size()};
+    appendRecord(StoreRecord, rawHash, data);
+
+    const auto it = m_index.find(rawHash);
+    if (it != m_index.end()) {
+        m_liveSize -= it->size;
+        *it = record;
+    }
+    else {
+        m_index.insert(rawHash, record);
+    }
+    m_liveSize += record.size;
+}
+
+void ResumeDatabase::remove(const QString &hash)
+{
+    const QByteArray rawHash = toRawHash(hash);
+    const auto it = m_index.find(rawHash);
+    if (it == m_index.end()) return;
+
+    m_liveSize -= it->size;
+    m_index.erase(it);
+    appendRecord(RemoveRecord, rawHash, {});
+}
+
+bool ResumeDatabase::flush()
+{
+    if (m_pending.isEmpty()) return true;
+    if (!m_file.isOpen()) return false;
+
+    const qint64 written = m_file.write(m_pending);
+    if ((written != m_pending.size()) || !m_file.flush()) {
+        // Cut off the torn tail (the file is unbuffered, so nothing is left behind in Qt)
+        // and keep the pending records to rewrite them at the offsets the index refers to
+        m_file.resize(m_fileSize);
+        m_file.seek(m_fileSize);
+        return false;
+    }
+
+    m_fileSize += written;
+    m_pending.clear();
+    return true;
+}
+
+bool ResumeDatabase::isCompactionNeeded() const
+{
+    return (m_fileSize > COMPACTION_MIN_SIZE) && (m_fileSize > (2 * (MAGIC_SIZE + m_liveSize)));
+}
+
+bool ResumeDatabase::compact()
+{
+    if (!flush()) return false;
+
+    uchar *data = m_file.map(0, m_fileSize);
+    if (!data) return false;
+
+    QSaveFile newFile(m_file.fileName());
+    if (!newFile.open(QIODevice::WriteOnly)) {
+        m_file.unmap(data);
+        return false;
+    }
+
+    QHash<QByteArray, Record> newIndex;
+    newIndex.reserve(m_index.size());
+    qint64 pos = MAGIC_SIZE;
+    newFile.write(MAGIC, MAGIC_SIZE);
+    for (auto it = m_index.cbegin(); it != m_index.cend(); ++it) {
+        newFile.write(reinterpret_cast<const char *>(data + it->offset), it->size);
+        newIndex.insert(it.key(), {pos, it->size});
+        pos += it->size;
+    }
+
+    m_file.unmap(data);
+    // File can't be replaced while it is opened on Windows
+    m_file.close();
+    const bool committed = newFile.commit();
+    if (!committed) {
+        LogMsg(QString("Couldn't compact resume database '%1'. Error: %2")
+               .arg(Utils::Fs::toNativePath(m_file.fileName()), newFile.errorString()), Log::WARNING);
+    }
+
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) return false;
+    if (!committed) {
+        m_file.seek(m_fileSize);
+        return false;
+    }
+
+    m_index = newIndex;
+    m_fileSize = pos;
+    m_liveSize = pos - MAGIC_SIZE;
+    return m_file.seek(m_fileSize);
+}
+
+void ResumeDatabase::appendRecord(const int type, const QByteArray &rawHash, const QByteArray &data)
+{
+    uchar header[RECORD_HEADER_SIZE];
+    qToLittleEndian<quint32>(data.size(), header);
+    header[4] = static_cast<uchar>(type);
+    std::memcpy(header + 5, rawHash.constData(), HASH_SIZE);
+    qToLittleEndian<quint32>(recordChecksum(header, data.constData(), data.size()), header + CHECKSUM_OFFSET);
+
+    m_pending.append(reinterpret_cast<const char *>(header), RECORD_HEADER_SIZE);
+    m_pending.append(data);
+}
+
+bool ResumeDatabase::readAll(const QString &path, QHash<QString, QByteArray> &fastresumes)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    const qint64 fileSize = file.size();
+    uchar *data = file.map(0, fileSize);
+    if (!data) return false;
+
+    // Find the latest record of each torrent first so outdated ones aren't copied
+    QHash<QByteArray, Record> index;
+    const qint64 validSize = scanRecords(data, fileSize
+        , [&index](int type, const QByteArray &rawHash, qint64 offset, qint64 size)
+    {
+        if (type == StoreRecord)
+            index.insert(rawHash, {offset, size});
+        else
+            index.remove(rawHash);
+    });
+
+    if (validSize >= 0) {
+        fastresumes.reserve(fastresumes.size() + index.size());
+        for (auto it = index.cbegin(); it != index.cend(); ++it) {
+            const char *payload = reinterpret_cast<const char *>(data + it->offset + RECORD_HEADER_SIZE);
+            fastresumes.insert(fromRawHash(it.key()), QByteArray(payload, it->size - RECORD_HEADER_SIZE));
+        }
+    }
+
+    file.unmap(data);
+    return (validSize >= 0);
+}
+
+bool ResumeDatabase::importFolder(const QString &path, const QString &folderPath)
+{
+    const QDir folder(folderPath);
+    const QStringList fastresumes = folder.entryList(
+                QStringList(QLatin1String("*.fastresume")), QDir::Files, QDir::Unsorted);
+    if (fastresumes.isEmpty()) return true;
+
+    ResumeDatabase database(path);
+    if (!database.open()) return false;
+
+    QStringList imported;
+    const QRegExp rx(QLatin1String("^([A-Fa-f0-9]{40})\\.fastresume$"));
+    for (const QString &fastresumeName : fastresumes) {
+        if (rx.indexIn(fastresumeName) == -1) continue;
+
+        QFile file(folder.absoluteFilePath(fastresumeName));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qDebug("Cannot read file %s: %s", qUtf8Printable(file.fileName()), qUtf8Printable(file.errorString()));
+            continue;
+        }
+
+        database.store(rx.cap(1).toLower(), file.readAll());
+        imported << file.fileName();
+        if ((database.m_pending.size() >= IMPORT_BATCH_SIZE) && !database.flush())
+            return false;
+    }
+
+    if (!database.flush()) return false;
+
+    // Only get rid of the old files once their content is safely stored
+    for (const QString &filePath : qAsConst(imported))
+        Utils::Fs::forceRemove(filePath);
+
+    LogMsg(QString("Migrated %1 fastresume files to '%2'.")
+           .arg(imported.size()).arg(Utils::Fs::toNativePath(path)));
+    return true;
+}
+
+bool ResumeDatabase::exportFolder(const QString &path, const QString &folderPath)
+{
+    QHash<QString, QByteArray> fastresumes;
+    if (!readAll(path, fastresumes)) return false;
+
+    const QDir folder(folderPath);
+    QStringList exported;
+    bool ok = true;
+    for (auto it = fastresumes.cbegin(); ok && (it != fastresumes.cend()); ++it) {
+        QSaveFile file(folder.absoluteFilePath(QString("%1.fastresume").arg(it.key())));
+        ok = file.open(QIODevice::WriteOnly);
+        if (ok) {
+            file.write(it.value());
+            ok = file.commit();
+        }
+        if (ok)
+            exported << file.fileName();
+    }
+
+    if (!ok || !Utils::Fs::forceRemove(path)) {
+        // Files left behind would shadow the database content
+        for (const QString &filePath : qAsConst(exported))
+            Utils::Fs::forceRemove(filePath);
+        return false;
+    }
+
+    LogMsg(QString("Migrated %1 torrents from '%2' to separate fastresume files.")
+           .arg(exported.size()).arg(Utils::Fs::toNativePath(path)));
+    return true;
+}
@@ -0,0 +1,84 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#ifndef BITTORRENT_RESUMEDATABASE_H
+#define BITTORRENT_RESUMEDATABASE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+
+const char RESUME_DATABASE_FILENAME[] = "fastresume.db";
+
+// Append-only log of the fastresume data of all torrents.
+// Every record carries its own checksum, so a partially written tail
+// (e.g. after a crash) is detected and dropped when the file is opened.
+// Outdated records are removed by rewriting the file from time to time.
+class ResumeDatabase
+{
+    Q_DISABLE_COPY(ResumeDatabase)
+
+public:
+    explicit ResumeDatabase(const QString &path);
+    ~ResumeDatabase();
+
+    bool open();
+    QString errorString() const;
+
+    // Changes are buffered until the next successful flush()
+    void store(const QString &hash, const QByteArray &data);
+    void remove(const QString &hash);
+    bool flush();
+
+    bool isCompactionNeeded() const;
+    bool compact();
+
+    static bool readAll(const QString &path, QHash<QString, QByteArray> &fastresumes);
+    // Migration from/to the one-file-per-torrent layout
+    static bool importFolder(const QString &path, const QString &folderPath);
+    static bool exportFolder(const QString &path, const QString &folderPath);
+
+private:
+    struct Record
+    {
+        qint64 offset;
+        qint64 size;
+    };
+
+    void appendRecord(int type, const QByteArray &rawHash, const QByteArray &data);
+
+    QFile m_file;
+    qint64 m_fileSize;
+    qint64 m_liveSize;
+    QHash<QByteArray, Record> m_index;
+    QByteArray m_pending;
+};
+
+#endif // BITTORRENT_RESUMEDATABASE_H
@@ -0,0 +1,377 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#include "resumedataloader.h"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <QRunnable>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+
+#include <libtorrent/error_code.hpp>
+#if LIBTORRENT_VERSION_NUM < 10100
+#include <libtorrent/lazy_entry.hpp>
+#else
+#include <libtorrent/bdecode.hpp>
+#endif
+
+#include "base/bittorrent/session.h"
+#include "base/global.h"
+#include "base/profile.h"
+#include "base/utils/fs.h"
+#include "resumedatabase.h"
+
+namespace libt = libtorrent;
+using namespace BitTorrent;
+
+namespace
+{
+    // Maximum number of torrents handed to the session per event loop iteration
+    const int MAX_BATCH_SIZE = 100;
+
+    template <typename Entry>
+    QSet<QString> entryListToSetImpl(const Entry &entry)
+    {
+        Q_ASSERT(entry.type() == Entry::list_t);
+        QSet<QString> output;
+        for (int i = 0; i < entry.list_size(); ++i) {
+            const QString tag = QString::fromStdString(entry.list_string_value_at(i));
+            if (Session::isValidTag(tag))
+                output.insert(tag);
+            else
+                qWarning() << QString("Dropping invalid stored tag: %1").arg(tag);
+        }
+        return output;
+    }
+
+#if LIBTORRENT_VERSION_NUM < 10100
+    bool isList(const libt::lazy_entry *entry)
+    {
+        return entry && (entry->type() == libt::lazy_entry::list_t);
+    }
+
+    QSet<QString> entryListToSet(const libt::lazy_entry *entry)
+    {
+        return entry ? entryListToSetImpl(*entry) : QSet<QString>();
+    }
+#else
+    bool isList(const libt::bdecode_node &entry)
+    {
+        return entry.type() == libt::bdecode_node::list_t;
+    }
+
+    QSet<QString> entryListToSet(const libt::bdecode_node &entry)
+    {
+        return entryListToSetImpl(entry);
+    }
+#endif
+
+    bool readFile(const QString &path, QByteArray &buf)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qDebug("Cannot read file %s: %s", qUtf8Printable(path), qUtf8Printable(file.errorString()));
+            return false;
+        }
+
+        buf = file.readAll();
+        return true;
+    }
+
+    bool loadTorrentResumeData(const QByteArray &data, AddTorrentData &torrentData, int &prio,  MagnetUri &magnetUri)
+    {
+        torrentData = AddTorrentData();
+        torrentData.resumed = true;
+        torrentData.skipChecking = false;
+
+        libt::error_code ec;
+#if LIBTORRENT_VERSION_NUM < 10100
+        libt::lazy_entry fast;
+        libt::lazy_bdecode(data.constData(), data.constData() + data.size(), fast, ec);
+        if (ec || (fast.type() != libt::lazy_entry::dict_t)) return false;
+#else
+        libt::bdecode_node fast;
+        libt::bdecode(data.constData(), data.constData() + data.size(), fast, ec);
+        if (ec || (fast.type() != libt::bdecode_node::dict_t)) return false;
+#endif
+
+        torrentData.savePath = Profile::instance().fromPortablePath(
+            Utils::Fs::fromNativePath(QString::fromStdString(fast.dict_find_string_value("qBt-savePath"))));
+
+        std::string ratioLimitString = fast.dict_find_string_value("qBt-ratioLimit");
+        if (ratioLimitString.empty())
+            torrentData.ratioLimit = fast.dict_find_int_value("qBt-ratioLimit", TorrentHandle::USE_GLOBAL_RATIO * 1000) / 1000.0;
+        else
+            torrentData.ratioLimit = QString::fromStdString(ratioLimitString).toDouble();
+        torrentData.seedingTimeLimit = fast.dict_find_int_value("qBt-seedingTimeLimit", TorrentHandle::USE_GLOBAL_SEEDING_TIME);
+        // **************************************************************************************
+        // Workaround to convert legacy label to category
+        // TODO: Should be removed in future
+        torrentData.category = QString::fromStdString(fast.dict_find_string_value("qBt-label"));
+        if (torrentData.category.isEmpty())
+        // **************************************************************************************
+            torrentData.category = QString::fromStdString(fast.dict_find_string_value("qBt-category"));
+        // auto because the return type depends on the #if above.
+        const auto tagsEntry = fast.dict_find_list("qBt-tags");
+        if (isList(tagsEntry))
+            torrentData.tags = entryListToSet(tagsEntry);
+        torrentData.name = QString::fromStdString(fast.dict_find_string_value("qBt-name"));
+        torrentData.hasSeedStatus = fast.dict_find_int_value("qBt-seedStatus");
+        torrentData.disableTempPath = fast.dict_find_int_value("qBt-tempPathDisabled");
+        torrentData.hasRootFolder = fast.dict_find_int_value("qBt-hasRootFolder");
+
+        magnetUri = MagnetUri(QString::fromStdString(fast.dict_find_string_value("qBt-magnetUri")));
+        torrentData.addPaused = fast.dict_find_int_value("qBt-paused");
+        torrentData.addForced = fast.dict_find_int_value("qBt-forced");
+        torrentData.firstLastPiecePriority = fast.dict_find_int_value("qBt-firstLastPiecePriority");
+        torrentData.sequential = fast.dict_find_int_value("qBt-sequential");
+
+        prio = fast.dict_find_int_value("qBt-queuePosition");
+
+        return true;
+    }
+}
+
+class ResumeDataLoader::LoadTask : public QRunnable
+{
+public:
+    LoadTask(ResumeDataLoader *loader, const QString &hash, const QByteArray &fastresumeData)
+        : m_loader(loader)
+        , m_hash(hash)
+        , m_fastresumeData(fastresumeData)
+    {
+    }
+
+    void run() override
+    {
+        m_loader->load(m_hash, m_fastresumeData);
+    }
+
+private:
+    ResumeDataLoader *m_loader;
+    QString m_hash;
+    QByteArray m_fastresumeData;
+};
+
+ResumeDataLoader::ResumeDataLoader(const QString &resumeFolderPath, QObject *parent)
+    : QObject(parent)
+    , m_resumeFolderPath(QDir(resumeFolderPath).absolutePath() + QLatin1Char('/'))
+    , m_aborted(0)
+    , m_total(0)
+    , m_processed(0)
+    , m_remappedCount(0)
+    , m_isFinished(false)
+    , m_nextQueuePosition(1)
+{
+    m_threadPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+ResumeDataLoader::~ResumeDataLoader()
+{
+    m_aborted.storeRelease(1);
+    m_threadPool.clear();
+    m_threadPool.waitForDone();
+
+    qDeleteAll(m_loaded);
+    qDeleteAll(m_pending);
+    qDeleteAll(m_outOfRange);
+    qDeleteAll(m_ready);
+}
+
+void ResumeDataLoader::start()
+{
+    // Stored fastresume data, null ones are read from separate files
+    QHash<QString, QByteArray> fastresumes;
+
+    const QString databasePath = m_resumeFolderPath + QLatin1String(RESUME_DATABASE_FILENAME);
+    if (QFile::exists(databasePath) && !ResumeDatabase::readAll(databasePath, fastresumes))
+        qWarning() << "Couldn't read resume database" << databasePath;
+
+    // Separate files exist only if the database isn't used
+    // or the migration to it has failed, so they take precedence
+    const QDir resumeDataDir(m_resumeFolderPath);
+    const QStringList fastresumeFiles = resumeDataDir.entryList(
+                QStringList(QLatin1String("*.fastresume")), QDir::Files, QDir::Unsorted);
+    const QRegExp rx(QLatin1String("^([A-Fa-f0-9]{40})\\.fastresume$"));
+    for (const QString &fastresumeName : fastresumeFiles) {
+        if (rx.indexIn(fastresumeName) != -1)
+            fastresumes[rx.cap(1)] = QByteArray();
+    }
+
+    qDebug("Queue size: %d", fastresumes.size());
+
+    m_total = fastresumes.size();
+    // Valid queue positions are in range [1, m_total]
+    m_pending.assign(m_total + 1, nullptr);
+
+    for (auto it = fastresumes.cbegin(); it != fastresumes.cend(); ++it)
+        m_threadPool.start(new LoadTask(this, it.key(), it.value()));
+
+    if (m_total == 0)
+        QMetaObject::invokeMethod(this, "processLoadedData", Qt::QueuedConnection);
+}
+
+// Runs in a worker thread
+void ResumeDataLoader::load(const QString &hash, const QByteArray &fastresumeData)
+{
+    if (m_aborted.loadAcquire()) return;
+
+    LoadedResumeData *resumeData = new LoadedResumeData;
+    resumeData->hash = hash;
+    resumeData->fastresumeData = fastresumeData;
+
+    const QString fastresumePath = m_resumeFolderPath + hash + QLatin1String(".fastresume");
+    if ((!fastresumeData.isNull() || readFile(fastresumePath, resumeData->fastresumeData))
+        && loadTorrentResumeData(resumeData->fastresumeData, resumeData->addTorrentData
+                                 , resumeData->queuePosition, resumeData->magnetUri)) {
+        // Torrents without metadata are resumed from the stored magnet URI
+        if (!resumeData->magnetUri.isValid())
+            resumeData->torrentInfo = TorrentInfo::loadFromFile(m_resumeFolderPath + hash + QLatin1String(".torrent"));
+    }
+    else {
+        resumeData->hash.clear();
+    }
+
+    QMutexLocker locker(&m_loadedMutex);
+    const bool wasEmpty = m_loaded.isEmpty();
+    m_loaded.append(resumeData);
+    if (wasEmpty)
+        QMetaObject::invokeMethod(this, "processLoadedData", Qt::QueuedConnection);
+}
+
+void ResumeDataLoader::processLoadedData()
+{
+    if (m_isFinished) return;
+
+    QVector<LoadedResumeData *> loaded;
+    {
+        QMutexLocker locker(&m_loadedMutex);
+        loaded.swap(m_loaded);
+    }
+
+    for (LoadedResumeData *resumeData : qAsConst(loaded)) {
+        ++m_processed;
+        if (resumeData->hash.isEmpty())
+            delete resumeData;
+        else
+            reorder(resumeData);
+    }
+
+    if (m_processed == m_total)
+        releaseAll();
+
+    if (!loaded.isEmpty())
+        emit progressChanged(m_processed, m_total);
+
+    QVector<LoadedResumeData> batch;
+    batch.reserve(std::min(m_ready.size(), MAX_BATCH_SIZE));
+    while (!m_ready.isEmpty() && (batch.size() < MAX_BATCH_SIZE)) {
+        LoadedResumeData *resumeData = m_ready.dequeue();
+        batch.append(*resumeData);
+        delete resumeData;
+    }
+
+    if (!batch.isEmpty())
+        emit resumeDataLoaded(batch);
+
+    if (!m_ready.isEmpty()) {
+        // Let the event loop handle alerts and user input before continuing
+        QMetaObject::invokeMethod(this, "processLoadedData", Qt::QueuedConnection);
+    }
+    else if (m_processed == m_total) {
+        m_isFinished = true;
+        emit finished(m_remappedCount);
+    }
+}
+
+void ResumeDataLoader::reorder(LoadedResumeData *resumeData)
+{
+    const int queuePosition = resumeData->queuePosition;
+
+    // Seeding torrents (queue position 0) don't depend on the order
+    if (queuePosition <= m_nextQueuePosition) {
+        m_ready.enqueue(resumeData);
+        if (queuePosition == m_nextQueuePosition) {
+            ++m_nextQueuePosition;
+            releaseInOrder();
+        }
+        return;
+    }
+
+    int pos = queuePosition;
+    while ((pos < static_cast<int>(m_pending.size())) && m_pending[pos])
+        ++pos;
+
+    if (pos >= static_cast<int>(m_pending.size())) {
+        m_outOfRange.append(resumeData);
+        return;
+    }
+
+    if (pos != queuePosition)
+        ++m_remappedCount;
+    m_pending[pos] = resumeData;
+}
+
+void ResumeDataLoader::releaseInOrder()
+{
+    while ((m_nextQueuePosition < static_cast<int>(m_pending.size())) && m_pending[m_nextQueuePosition]) {
+        m_ready.enqueue(m_pending[m_nextQueuePosition]);
+        m_pending[m_nextQueuePosition] = nullptr;
+        ++m_nextQueuePosition;
+    }
+}
+
+void ResumeDataLoader::releaseAll()
+{
+    // There is nothing more to wait for, so the remaining gaps
+    // in the queue positions are just skipped
+    for (LoadedResumeData *&resumeData : m_pending) {
+        if (resumeData) {
+            m_ready.enqueue(resumeData);
+            resumeData = nullptr;
+        }
+    }
+
+    std::stable_sort(m_outOfRange.begin(), m_outOfRange.end()
+                     , [](const LoadedResumeData *left, const LoadedResumeData *right)
+    {
+        return left->queuePosition < right->queuePosition;
+    });
+    for (LoadedResumeData *resumeData : qAsConst(m_outOfRange))
+        m_ready.enqueue(resumeData);
+    m_outOfRange.clear();
+}
@@ -0,0 +1,110 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#ifndef BITTORRENT_RESUMEDATALOADER_H
+#define BITTORRENT_RESUMEDATALOADER_H
+
+#include <vector>
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+#include "base/bittorrent/magneturi.h"
+#include "base/bittorrent/torrenthandle.h"
+#include "base/bittorrent/torrentinfo.h"
+
+namespace BitTorrent
+{
+    struct LoadedResumeData
+    {
+        QString hash;
+        QByteArray fastresumeData;
+        AddTorrentData addTorrentData;
+        MagnetUri magnetUri;
+        TorrentInfo torrentInfo;
+        int queuePosition = 0;
+    };
+
+    // Reads and decodes the fastresume (and .torrent) files of the resume folder
+    // on a pool of worker threads and hands the results back to the owner thread
+    // in small batches, already sorted by their stored queue position.
+    class ResumeDataLoader : public QObject
+    {
+        Q_OBJECT
+        Q_DISABLE_COPY(ResumeDataLoader)
+
+    public:
+        explicit ResumeDataLoader(const QString &resumeFolderPath, QObject *parent = nullptr);
+        ~ResumeDataLoader() override;
+
+        void start();
+
+    signals:
+        void resumeDataLoaded(const QVector<BitTorrent::LoadedResumeData> &batch);
+        void progressChanged(int loaded, int total);
+        void finished(int remappedCount);
+
+    private slots:
+        void processLoadedData();
+
+    private:
+        class LoadTask;
+
+        void load(const QString &hash, const QByteArray &fastresumeData);
+        void reorder(LoadedResumeData *resumeData);
+        void releaseInOrder();
+        void releaseAll();
+
+        const QString m_resumeFolderPath;
+        QThreadPool m_threadPool;
+        QAtomicInt m_aborted;
+
+        QMutex m_loadedMutex;
+        QVector<LoadedResumeData *> m_loaded;
+
+        int m_total;
+        int m_processed;
+        int m_remappedCount;
+        bool m_isFinished;
+
+        // reorder buffer indexed by queue position
+        int m_nextQueuePosition;
+        std::vector<LoadedResumeData *> m_pending;
+        QVector<LoadedResumeData *> m_outOfRange;
+        QQueue<LoadedResumeData *> m_ready;
+    };
+}
+
+#endif // BITTORRENT_RESUMEDATALOADER_H
@@ -28,18 +28,76 @@
 
 #include <QDebug>
 #include <QSaveFile>
+#include <QTimer>
 
 #include "base/logger.h"
 #include "base/utils/fs.h"
+#include "resumedatabase.h"
 #include "resumedatasavingmanager.h"
 
-ResumeDataSavingManager::ResumeDataSavingManager(const QString &resumeFolderPath)
+namespace
+{
+    // Resume data of many torrents usually arrives in bursts,
+    // so it is collected for a while and written in one go
+    const int DATABASE_FLUSH_DELAY = 1000; // ms
+}
+
+ResumeDataSavingManager::ResumeDataSavingManager(const QString &resumeFolderPath, const bool useDatabase)
     : m_resumeDataDir(resumeFolderPath)
+    , m_database(nullptr)
+    , m_flushTimer(nullptr)
 {
+    const QString databasePath = m_resumeDataDir.absoluteFilePath(RESUME_DATABASE_FILENAME);
+    bool databaseEnabled = useDatabase;
+    if (!databaseEnabled && QFile::exists(databasePath)) {
+        if (!ResumeDatabase::exportFolder(databasePath, resumeFolderPath)) {
+            Logger::instance()->addMessage(QString("Couldn't migrate resume data from %1, keep using it.")
+                                           .arg(Utils::Fs::toNativePath(databasePath)), Log::CRITICAL);
+            databaseEnabled = true;
+        }
+    }
+
+    if (databaseEnabled) {
+        if (!ResumeDatabase::importFolder(databasePath, resumeFolderPath)) {
+            // The fastresume files are still in place so keep using them
+            Logger::instance()->addMessage(QString("Couldn't migrate fastresume files to %1.")
+                                           .arg(Utils::Fs::toNativePath(databasePath)), Log::CRITICAL);
+            return;
+        }
+
+        m_database = new ResumeDatabase(databasePath);
+        if (!m_database->open()) {
+            Logger::instance()->addMessage(QString("Couldn't open resume database %1. Error: %2")
+                                           .arg(Utils::Fs::toNativePath(databasePath), m_database->errorString()), Log::CRITICAL);
+            delete m_database;
+            m_database = nullptr;
+            return;
+        }
+
+        m_flushTimer = new QTimer(this);
+        m_flushTimer->setSingleShot(true);
+        m_flushTimer->setInterval(DATABASE_FLUSH_DELAY);
+        connect(m_flushTimer, &QTimer::timeout, this, &ResumeDataSavingManager::flushDatabase);
+    }
 }
 
-void ResumeDataSavingManager::saveResumeData(QString infoHash, QByteArray data) const
+ResumeDataSavingManager::~ResumeDataSavingManager()
 {
+    if (m_database) {
+        flushDatabase();
+        delete m_database;
+    }
+}
+
+void ResumeDataSavingManager::saveResumeData(QString infoHash, QByteArray data)
+{
+    if (m_database) {
+        m_database->store(infoHash, data);
+        if (!m_flushTimer->isActive())
+            m_flushTimer->start();
+        return;
+    }
+
     QString filename = QString("%1.fastresume").arg(infoHash);
     QString filepath = m_resumeDataDir.absoluteFilePath(filename);
 
@@ -53,3 +111,27 @@ void ResumeDataSavingManager::saveResumeData(QString infoHash, QByteArray data)
         }
     }
 }
+
+void ResumeDataSavingManager::removeResumeData(QString infoHash)
+{
+    if (m_database) {
+        m_database->remove(infoHash);
+        if (!m_flushTimer->isActive())
+            m_flushTimer->start();
+        return;
+    }
+
+    Utils::Fs::forceRemove(m_resumeDataDir.absoluteFilePath(QString("%1.fastresume").arg(infoHash)));
+}
+
+void ResumeDataSavingManager::flushDatabase()
+{
+    if (!m_database->flush()) {
+        Logger::instance()->addMessage(QString("Couldn't save resume data. Error: %1")
+                                       .arg(m_database->errorString()), Log::WARNING);
+        return;
+    }
+
+    if (m_database->isCompactionNeeded())
+        m_database->compact();
+}
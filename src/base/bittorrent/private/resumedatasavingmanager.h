@@ -33,18 +33,28 @@
 #include <QDir>
 #include <QObject>
 
+class QTimer;
+class ResumeDatabase;
+
 class ResumeDataSavingManager : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit ResumeDataSavingManager(const QString &resumeFolderPath);
+    ResumeDataSavingManager(const QString &resumeFolderPath, bool useDatabase);
+    ~ResumeDataSavingManager() override;
 
 public slots:
-    void saveResumeData(QString infoHash, QByteArray data) const;
+    void saveResumeData(QString infoHash, QByteArray data);
+    void removeResumeData(QString infoHash);
+
+private slots:
+    void flushDatabase();
 
 private:
     QDir m_resumeDataDir;
+    ResumeDatabase *m_database;
+    QTimer *m_flushTimer;
 };
 
 #endif // RESUMEDATASAVINGMANAGER_H
@@ -62,14 +62,12 @@
 #include <libtorrent/session_status.hpp>
 #include <libtorrent/torrent_info.hpp>
 
-#if LIBTORRENT_VERSION_NUM < 10100
-#include <libtorrent/lazy_entry.hpp>
-#else
-#include <libtorrent/bdecode.hpp>
+#if LIBTORRENT_VERSION_NUM >= 10100
 #include <libtorrent/session_stats.hpp>
 #endif
 
 #include "base/algorithm.h"
+#include "base/global.h"
 #include "base/logger.h"
 #include "base/net/downloadhandler.h"
 #include "base/net/downloadmanager.h"
@@ -87,6 +85,7 @@
 #include "magneturi.h"
 #include "private/bandwidthscheduler.h"
 #include "private/filterparserthread.h"
+#include "private/resumedataloader.h"
 #include "private/resumedatasavingmanager.h"
 #include "private/statistics.h"
 #include "torrenthandle.h"
@@ -108,11 +107,22 @@ static const char USER_AGENT[] = "qBittorrent/" QBT_VERSION_2;
 namespace libt = libtorrent;
 using namespace BitTorrent;
 
-namespace
+struct Session::DeferredTorrent
 {
-    bool readFile(const QString &path, QByteArray &buf);
-    bool loadTorrentResumeData(const QByteArray &data, AddTorrentData &torrentData, int &prio, MagnetUri &magnetUri);
+    AddTorrentData addData;
+    MagnetUri magnetUri;
+    TorrentInfo torrentInfo;
 
+    QString name() const
+    {
+        if (!addData.name.isEmpty())
+            return addData.name;
+        return magnetUri.isValid() ? magnetUri.name() : torrentInfo.name();
+    }
+};
+
+namespace
+{
     void torrentQueuePositionUp(const libt::torrent_handle &handle);
     void torrentQueuePositionDown(const libt::torrent_handle &handle);
     void torrentQueuePositionTop(const libt::torrent_handle &handle);
@@ -138,42 +148,60 @@ namespace
         return result;
     }
 
-    template <typename Entry>
-    QSet<QString> entryListToSetImpl(const Entry &entry)
-    {
-        Q_ASSERT(entry.type() == Entry::list_t);
-        QSet<QString> output;
-        for (int i = 0; i < entry.list_size(); ++i) {
-            const QString tag = QString::fromStdString(entry.list_string_value_at(i));
-            if (Session::isValidTag(tag))
-                output.insert(tag);
-            else
-                qWarning() << QString("Dropping invalid stored tag: %1").arg(tag);
-        }
-        return output;
-    }
-
-#if LIBTORRENT_VERSION_NUM < 10100
-    bool isList(const libt::lazy_entry *entry)
+    enum StatusReportFlag
     {
-        return entry && (entry->type() == libt::lazy_entry::list_t);
-    }
+        DownloadingFlag = 1 << 0,
+        SeedingFlag = 1 << 1,
+        CompletedFlag = 1 << 2,
+        PausedFlag = 1 << 3,
+        ResumedFlag = 1 << 4,
+        ActiveFlag = 1 << 5,
+        InactiveFlag = 1 << 6,
+        ErroredFlag = 1 << 7
+    };
 
-    QSet<QString> entryListToSet(const libt::lazy_entry *entry)
+    uint statusReportFlags(const TorrentHandle *torrent)
     {
-        return entry ? entryListToSetImpl(*entry) : QSet<QString>();
-    }
-#else
-    bool isList(const libt::bdecode_node &entry)
-    {
-        return entry.type() == libt::bdecode_node::list_t;
+        uint flags = 0;
+        if (torrent->isDownloading())
+            flags |= DownloadingFlag;
+        if (torrent->isUploading())
+            flags |= SeedingFlag;
+        if (torrent->isCompleted())
+            flags |= CompletedFlag;
+        if (torrent->isPaused())
+            flags |= PausedFlag;
+        if (torrent->isResumed())
+            flags |= ResumedFlag;
+        if (torrent->isActive())
+            flags |= ActiveFlag;
+        if (torrent->isInactive())
+            flags |= InactiveFlag;
+        if (torrent->isErrored())
+            flags |= ErroredFlag;
+        return flags;
     }
 
-    QSet<QString> entryListToSet(const libt::bdecode_node &entry)
+    // delta is +1 to count the torrent in or -1 to count it out
+    void applyStatusReportFlags(TorrentStatusReport &report, const uint flags, const int delta)
     {
-        return entryListToSetImpl(entry);
+        if (flags & DownloadingFlag)
+            report.nbDownloading += delta;
+        if (flags & SeedingFlag)
+            report.nbSeeding += delta;
+        if (flags & CompletedFlag)
+            report.nbCompleted += delta;
+        if (flags & PausedFlag)
+            report.nbPaused += delta;
+        if (flags & ResumedFlag)
+            report.nbResumed += delta;
+        if (flags & ActiveFlag)
+            report.nbActive += delta;
+        if (flags & InactiveFlag)
+            report.nbInactive += delta;
+        if (flags & ErroredFlag)
+            report.nbErrored += delta;
     }
-#endif
 
     QString normalizePath(const QString &path)
     {
@@ -250,6 +278,29 @@ namespace
             return value;
         };
     }
+
+    bool parseIPAddress(const QString &ip, libt::address &address)
+    {
+        const QByteArray ipLatin1 = ip.toLatin1();
+        const char *begin = ipLatin1.constData();
+        const char *end = begin + ipLatin1.size();
+
+        quint32 ipv4 = 0;
+        if (Utils::Net::parseIPv4(begin, end, ipv4, (end + 1))) { // includes the terminating '\0'
+            address = libt::address_v4(ipv4);
+            return true;
+        }
+
+        QIPv6Address ipv6;
+        if (Utils::Net::parseIPv6(begin, end, ipv6)) {
+            libt::address_v6::bytes_type bytes;
+            std::copy(ipv6.c, (ipv6.c + 16), bytes.begin());
+            address = libt::address_v6(bytes);
+            return true;
+        }
+
+        return false;
+    }
 }
 
 // Session
@@ -331,6 +382,7 @@ Session::Session(QObject *parent)
     , m_isAltGlobalSpeedLimitEnabled(BITTORRENT_SESSION_KEY("UseAlternativeGlobalSpeedLimit"), false)
     , m_isBandwidthSchedulerEnabled(BITTORRENT_SESSION_KEY("BandwidthSchedulerEnabled"), false)
     , m_saveResumeDataInterval(BITTORRENT_SESSION_KEY("SaveResumeDataInterval"), 3)
+    , m_isResumeDataDatabaseEnabled(BITTORRENT_SESSION_KEY("ResumeDataDatabase"), false)
     , m_port(BITTORRENT_SESSION_KEY("Port"), 8999)
     , m_useRandomPort(BITTORRENT_SESSION_KEY("UseRandomPort"), false)
     , m_networkInterface(BITTORRENT_SESSION_KEY("Interface"))
@@ -369,6 +421,7 @@ Session::Session(QObject *parent)
     , m_numResumeData(0)
     , m_extraLimit(0)
     , m_useProxy(false)
+    , m_resumeDataLoader(nullptr)
 {
     Logger *const logger = Logger::instance();
 
@@ -527,7 +580,7 @@ Session::Session(QObject *parent)
     connect(&m_networkManager, &QNetworkConfigurationManager::configurationChanged, this, &Session::networkConfigurationChange);
 
     m_ioThread = new QThread(this);
-    m_resumeDataSavingManager = new ResumeDataSavingManager(m_resumeFolderPath);
+    m_resumeDataSavingManager = new ResumeDataSavingManager(m_resumeFolderPath, isResumeDataDatabaseEnabled());
     m_resumeDataSavingManager->moveToThread(m_ioThread);
     connect(m_ioThread, &QThread::finished, m_resumeDataSavingManager, &QObject::deleteLater);
     m_ioThread->start();
@@ -927,6 +980,11 @@ bool Session::isTrackerEnabled() const
     return m_isTrackerEnabled;
 }
 
+Tracker *Session::tracker() const
+{
+    return m_tracker;
+}
+
 void Session::setTrackerEnabled(bool enabled)
 {
     if (isTrackerEnabled() != enabled) {
@@ -950,6 +1008,7 @@ void Session::setGlobalMaxRatio(qreal ratio)
     if (ratio != globalMaxRatio()) {
         m_globalMaxRatio = ratio;
         updateSeedingLimitTimer();
+        emit globalShareLimitChanged();
     }
 }
 
@@ -966,12 +1025,22 @@ void Session::setGlobalMaxSeedingMinutes(int minutes)
     if (minutes != globalMaxSeedingMinutes()) {
         m_globalMaxSeedingMinutes = minutes;
         updateSeedingLimitTimer();
+        emit globalShareLimitChanged();
     }
 }
 
 // Main destructor
 Session::~Session()
 {
+    // Stop loading the remaining torrents
+    delete m_resumeDataLoader;
+
+    // The torrents added while loading never made it into the session
+    for (const DeferredTorrent &torrent : qAsConst(m_deferredTorrents)) {
+        LogMsg(tr("Couldn't add torrent '%1'. Reason: the application was closed before the torrents were loaded.")
+               .arg(torrent.name()), Log::WARNING);
+    }
+
     // Do some BT related saving
     saveResumeData();
 
@@ -1072,10 +1141,10 @@ void Session::processBannedIPs(libt::ip_filter &filter)
 {
     // First, import current filter
     foreach (const QString &ip, m_bannedIPs.value()) {
-        boost::system::error_code ec;
-        libt::address addr = libt::address::from_string(ip.toLatin1().constData(), ec);
-        Q_ASSERT(!ec);
-        if (!ec)
+        libt::address addr;
+        const bool isValid = parseIPAddress(ip, addr);
+        Q_ASSERT(isValid);
+        if (isValid)
             filter.add_rule(addr, addr, libt::ip_filter::blocked);
     }
 }
@@ -1894,6 +1963,8 @@ bool Session::deleteTorrent(const QString &hash, bool deleteLocalFiles)
     TorrentHandle *const torrent = m_torrents.take(hash);
     if (!torrent) return false;
 
+    applyStatusReportFlags(m_torrentStatusReport, m_torrentStatusFlags.take(torrent), -1);
+
     qDebug("Deleting torrent with hash: %s", qUtf8Printable(torrent->hash()));
     emit torrentAboutToBeRemoved(torrent);
 
@@ -1931,6 +2002,7 @@ bool Session::deleteTorrent(const QString &hash, bool deleteLocalFiles)
     }
 
     // Remove it from torrent resume directory
+    QMetaObject::invokeMethod(m_resumeDataSavingManager, "removeResumeData", Q_ARG(QString, torrent->hash()));
     QDir resumeDataDir(m_resumeFolderPath);
     QStringList filters;
     filters << QString("%1.*").arg(torrent->hash());
@@ -2102,6 +2174,13 @@ bool Session::addTorrent(const TorrentInfo &torrentInfo, const AddTorrentParams
 bool Session::addTorrent_impl(AddTorrentData addData, const MagnetUri &magnetUri,
                               TorrentInfo torrentInfo, const QByteArray &fastresumeData)
 {
+    // The torrent may still be waiting for its resume data to be loaded,
+    // so it's added once all the resumed torrents are known
+    if (!addData.resumed && isLoadingTorrents()) {
+        m_deferredTorrents.append(DeferredTorrent {addData, magnetUri, torrentInfo});
+        return true;
+    }
+
     addData.savePath = normalizeSavePath(addData.savePath, "");
 
     if (!addData.category.isEmpty()) {
@@ -2693,6 +2772,17 @@ void Session::setSaveResumeDataInterval(uint value)
     }
 }
 
+bool Session::isResumeDataDatabaseEnabled() const
+{
+    return m_isResumeDataDatabaseEnabled;
+}
+
+void Session::setResumeDataDatabaseEnabled(bool enabled)
+{
+    // Takes effect on next start, the stored data is migrated then
+    m_isResumeDataDatabaseEnabled = enabled;
+}
+
 int Session::port() const
 {
     static int randomPort = Utils::Random::rand(1024, 65535);
@@ -2896,11 +2986,22 @@ void Session::setBannedIPs(const QStringList &newList)
     // here filter out incorrect IP
     QStringList filteredList;
     for (const QString &ip : newList) {
-        if (Utils::Net::isValidIP(ip)) {
+        libt::address addr;
+        if (parseIPAddress(ip, addr)) {
             // the same IPv6 addresses could be written in different forms;
             // QHostAddress::toString() result format follows RFC5952;
             // thus we avoid duplicate entries pointing to the same address
-            filteredList << QHostAddress(ip).toString();
+            QHostAddress hostAddress;
+            if (addr.is_v4()) {
+                hostAddress.setAddress(static_cast<quint32>(addr.to_v4().to_ulong()));
+            }
+            else {
+                const libt::address_v6::bytes_type bytes = addr.to_v6().to_bytes();
+                Q_IPV6ADDR ipv6;
+                std::copy(bytes.begin(), bytes.end(), ipv6.c);
+                hostAddress.setAddress(ipv6);
+            }
+            filteredList << hostAddress.toString();
         }
         else {
             Logger::instance()->addMessage(
@@ -3482,8 +3583,23 @@ void Session::updateSeedingLimitTimer()
 
 void Session::handleTorrentShareLimitChanged(TorrentHandle *const torrent)
 {
-    Q_UNUSED(torrent);
     updateSeedingLimitTimer();
+    emit torrentShareLimitChanged(torrent);
+}
+
+void Session::handleTorrentNameChanged(TorrentHandle *const torrent)
+{
+    emit torrentNameChanged(torrent);
+}
+
+void Session::handleTorrentSpeedLimitChanged(TorrentHandle *const torrent)
+{
+    emit torrentSpeedLimitChanged(torrent);
+}
+
+void Session::handleTorrentFirstLastPiecePriorityChanged(TorrentHandle *const torrent)
+{
+    emit torrentFirstLastPiecePriorityChanged(torrent);
 }
 
 void Session::saveTorrentResumeData(TorrentHandle *const torrent, bool finalSave)
@@ -3546,12 +3662,14 @@ void Session::handleTorrentUrlSeedsAdded(TorrentHandle *const torrent, const QLi
 {
     foreach (const QUrl &newUrlSeed, newUrlSeeds)
         Logger::instance()->addMessage(tr("URL seed '%1' was added to torrent '%2'").arg(newUrlSeed.toString(), torrent->name()));
+    emit urlSeedsChanged(torrent);
 }
 
 void Session::handleTorrentUrlSeedsRemoved(TorrentHandle *const torrent, const QList<QUrl> &urlSeeds)
 {
     foreach (const QUrl &urlSeed, urlSeeds)
         Logger::instance()->addMessage(tr("URL seed '%1' was removed from torrent '%2'").arg(urlSeed.toString(), torrent->name()));
+    emit urlSeedsChanged(torrent);
 }
 
 void Session::handleTorrentMetadataReceived(TorrentHandle *const torrent)
@@ -3574,16 +3692,19 @@ void Session::handleTorrentPaused(TorrentHandle *const torrent)
 {
     if (!torrent->hasError() && !torrent->hasMissingFiles())
         saveTorrentResumeData(torrent);
+    updateTorrentStatusReport(torrent);
     emit torrentPaused(torrent);
 }
 
 void Session::handleTorrentResumed(TorrentHandle *const torrent)
 {
+    updateTorrentStatusReport(torrent);
     emit torrentResumed(torrent);
 }
 
 void Session::handleTorrentChecked(TorrentHandle *const torrent)
 {
+    updateTorrentStatusReport(torrent);
     emit torrentFinishedChecking(torrent);
 }
 
@@ -3591,6 +3712,7 @@ void Session::handleTorrentFinished(TorrentHandle *const torrent)
 {
     if (!torrent->hasError() && !torrent->hasMissingFiles())
         saveTorrentResumeData(torrent);
+    updateTorrentStatusReport(torrent);
     emit torrentFinished(torrent);
 
     qDebug("Checking if the torrent contains torrent files to download");
@@ -3772,86 +3894,60 @@ const CacheStatus &Session::cacheStatus() const
 // Will resume torrents in backup directory
 void Session::startUpTorrents()
 {
+    if (m_resumeDataLoader) return;
+
     qDebug("Resuming torrents...");
 
-    const QDir resumeDataDir(m_resumeFolderPath);
-    QStringList fastresumes = resumeDataDir.entryList(
-                QStringList(QLatin1String("*.fastresume")), QDir::Files, QDir::Unsorted);
+    m_resumeDataLoader = new ResumeDataLoader(m_resumeFolderPath, this);
+    connect(m_resumeDataLoader, &ResumeDataLoader::resumeDataLoaded, this, &Session::handleResumeDataLoaded);
+    connect(m_resumeDataLoader, &ResumeDataLoader::progressChanged, this, &Session::torrentsLoadingProgress);
+    connect(m_resumeDataLoader, &ResumeDataLoader::finished, this, &Session::handleResumeDataLoadingFinished);
+    m_resumeDataLoader->start();
+}
+
+bool Session::isLoadingTorrents() const
+{
+    return m_resumeDataLoader;
+}
 
+void Session::handleResumeDataLoaded(const QVector<LoadedResumeData> &batch)
+{
     Logger *const logger = Logger::instance();
 
-    typedef struct
-    {
-        QString hash;
-        MagnetUri magnetUri;
-        AddTorrentData addTorrentData;
-        QByteArray data;
-    } TorrentResumeData;
-
-    int resumedTorrentsCount = 0;
-    const auto startupTorrent = [this, logger, &resumeDataDir, &resumedTorrentsCount](const TorrentResumeData &params)
-    {
-        QString filePath = resumeDataDir.filePath(QString("%1.torrent").arg(params.hash));
-        qDebug() << "Starting up torrent" << params.hash << "...";
-        if (!addTorrent_impl(params.addTorrentData, params.magnetUri, TorrentInfo::loadFromFile(filePath), params.data))
+    for (const LoadedResumeData &resumeData : batch) {
+        qDebug() << "Starting up torrent" << resumeData.hash << "...";
+        if (!addTorrent_impl(resumeData.addTorrentData, resumeData.magnetUri, resumeData.torrentInfo, resumeData.fastresumeData))
             logger->addMessage(tr("Unable to resume torrent '%1'.", "e.g: Unable to resume torrent 'hash'.")
-                               .arg(params.hash), Log::CRITICAL);
-
-        // process add torrent messages before message queue overflow
-        if ((resumedTorrentsCount % 100) == 0) readAlerts();
+                               .arg(resumeData.hash), Log::CRITICAL);
+    }
 
-        ++resumedTorrentsCount;
-    };
+    // process add torrent messages before message queue overflow
+    readAlerts();
+}
 
-    qDebug("Starting up torrents");
-    qDebug("Queue size: %d", fastresumes.size());
-    // Resume downloads
-    QMap<int, TorrentResumeData> queuedResumeData;
-    int nextQueuePosition = 1;
-    int numOfRemappedFiles = 0;
-    QRegExp rx(QLatin1String("^([A-Fa-f0-9]{40})\\.fastresume$"));
-    foreach (const QString &fastresumeName, fastresumes) {
-        if (rx.indexIn(fastresumeName) == -1) continue;
-
-        QString hash = rx.cap(1);
-        QString fastresumePath = resumeDataDir.absoluteFilePath(fastresumeName);
-        QByteArray data;
-        AddTorrentData resumeData;
-        MagnetUri magnetUri;
-        int queuePosition;
-        if (readFile(fastresumePath, data) && loadTorrentResumeData(data, resumeData, queuePosition, magnetUri)) {
-            if (queuePosition <= nextQueuePosition) {
-                startupTorrent({ hash, magnetUri, resumeData, data });
-
-                if (queuePosition == nextQueuePosition) {
-                    ++nextQueuePosition;
-                    while (queuedResumeData.contains(nextQueuePosition)) {
-                        startupTorrent(queuedResumeData.take(nextQueuePosition));
-                        ++nextQueuePosition;
-                    }
-                }
-            }
-            else {
-                int q = queuePosition;
-                for (; queuedResumeData.contains(q); ++q) {
-                }
-                if (q != queuePosition) {
-                    ++numOfRemappedFiles;
-                }
-                queuedResumeData[q] = {hash, magnetUri, resumeData, data};
-            }
-        }
+void Session::handleResumeDataLoadingFinished(int remappedCount)
+{
+    if (remappedCount > 0) {
+        Logger::instance()->addMessage(
+            QString(tr("Queue positions were corrected in %1 resume files")).arg(remappedCount),
+            Log::CRITICAL);
     }
 
-    if (numOfRemappedFiles > 0) {
-        logger->addMessage(
-            QString(tr("Queue positions were corrected in %1 resume files")).arg(numOfRemappedFiles),
-            Log::CRITICAL);
+    m_resumeDataLoader->deleteLater();
+    m_resumeDataLoader = nullptr;
+
+    const QVector<DeferredTorrent> deferredTorrents = m_deferredTorrents;
+    m_deferredTorrents.clear();
+    for (const DeferredTorrent &torrent : deferredTorrents) {
+        // the caller was already told that the torrent is added, so report the failure here
+        if (!addTorrent_impl(torrent.addData, torrent.magnetUri, torrent.torrentInfo)) {
+            const QString msg = tr("Couldn't add torrent '%1'.").arg(torrent.name());
+            LogMsg(msg, Log::WARNING);
+            emit addTorrentFailed(msg);
+        }
     }
 
-    // starting up downloading torrents (queue position > 0)
-    foreach (const TorrentResumeData &torrentResumeData, queuedResumeData)
-        startupTorrent(torrentResumeData);
+    emit torrentsLoaded();
 }
 
 quint64 Session::getAlltimeDL() const
@@ -4045,6 +4141,7 @@ void Session::createTorrentHandle(const libt::torrent_handle &nativeHandle)
 
     TorrentHandle *const torrent = new TorrentHandle(this, nativeHandle, data);
     m_torrents.insert(torrent->hash(), torrent);
+    updateTorrentStatusReport(torrent);
 
     Logger *const logger = Logger::instance();
 
@@ -4398,102 +4495,37 @@ void Session::handleStateUpdateAlert(libt::state_update_alert *p)
     updateStats();
 #endif
 
-    foreach (const libt::torrent_status &status, p->status) {
+    QVector<TorrentHandle *> updatedTorrents;
+    updatedTorrents.reserve(p->status.size());
+    for (const libt::torrent_status &status : p->status) {
         TorrentHandle *const torrent = m_torrents.value(status.info_hash);
-        if (torrent)
-            torrent->handleStateUpdate(status);
-    }
+        if (!torrent) continue;
 
-    m_torrentStatusReport = TorrentStatusReport();
-    foreach (TorrentHandle *const torrent, m_torrents) {
-        if (torrent->isDownloading())
-            ++m_torrentStatusReport.nbDownloading;
-        if (torrent->isUploading())
-            ++m_torrentStatusReport.nbSeeding;
-        if (torrent->isCompleted())
-            ++m_torrentStatusReport.nbCompleted;
-        if (torrent->isPaused())
-            ++m_torrentStatusReport.nbPaused;
-        if (torrent->isResumed())
-            ++m_torrentStatusReport.nbResumed;
-        if (torrent->isActive())
-            ++m_torrentStatusReport.nbActive;
-        if (torrent->isInactive())
-            ++m_torrentStatusReport.nbInactive;
-        if (torrent->isErrored())
-            ++m_torrentStatusReport.nbErrored;
+        torrent->handleStateUpdate(status);
+        updateTorrentStatusReport(torrent);
+        updatedTorrents.append(torrent);
     }
 
-    emit torrentsUpdated();
+    emit torrentsUpdated(updatedTorrents);
 }
 
-namespace
+void Session::updateTorrentStatusReport(TorrentHandle *const torrent)
 {
-    bool readFile(const QString &path, QByteArray &buf)
-    {
-        QFile file(path);
-        if (!file.open(QIODevice::ReadOnly)) {
-            qDebug("Cannot read file %s: %s", qUtf8Printable(path), qUtf8Printable(file.errorString()));
-            return false;
-        }
-
-        buf = file.readAll();
-        return true;
+    const uint flags = statusReportFlags(torrent);
+    const auto it = m_torrentStatusFlags.find(torrent);
+    if (it == m_torrentStatusFlags.end()) {
+        m_torrentStatusFlags.insert(torrent, flags);
+        applyStatusReportFlags(m_torrentStatusReport, flags, 1);
     }
-
-    bool loadTorrentResumeData(const QByteArray &data, AddTorrentData &torrentData, int &prio,  MagnetUri &magnetUri)
-    {
-        torrentData = AddTorrentData();
-        torrentData.resumed = true;
-        torrentData.skipChecking = false;
-
-        libt::error_code ec;
-#if LIBTORRENT_VERSION_NUM < 10100
-        libt::lazy_entry fast;
-        libt::lazy_bdecode(data.constData(), data.constData() + data.size(), fast, ec);
-        if (ec || (fast.type() != libt::lazy_entry::dict_t)) return false;
-#else
-        libt::bdecode_node fast;
-        libt::bdecode(data.constData(), data.constData() + data.size(), fast, ec);
-        if (ec || (fast.type() != libt::bdecode_node::dict_t)) return false;
-#endif
-
-        torrentData.savePath = Profile::instance().fromPortablePath(
-            Utils::Fs::fromNativePath(QString::fromStdString(fast.dict_find_string_value("qBt-savePath"))));
-
-        std::string ratioLimitString = fast.dict_find_string_value("qBt-ratioLimit");
-        if (ratioLimitString.empty())
-            torrentData.ratioLimit = fast.dict_find_int_value("qBt-ratioLimit", TorrentHandle::USE_GLOBAL_RATIO * 1000) / 1000.0;
-        else
-            torrentData.ratioLimit = QString::fromStdString(ratioLimitString).toDouble();
-        torrentData.seedingTimeLimit = fast.dict_find_int_value("qBt-seedingTimeLimit", TorrentHandle::USE_GLOBAL_SEEDING_TIME);
-        // **************************************************************************************
-        // Workaround to convert legacy label to category
-        // TODO: Should be removed in future
-        torrentData.category = QString::fromStdString(fast.dict_find_string_value("qBt-label"));
-        if (torrentData.category.isEmpty())
-        // **************************************************************************************
-            torrentData.category = QString::fromStdString(fast.dict_find_string_value("qBt-category"));
-        // auto because the return type depends on the #if above.
-        const auto tagsEntry = fast.dict_find_list("qBt-tags");
-        if (isList(tagsEntry))
-            torrentData.tags = entryListToSet(tagsEntry);
-        torrentData.name = QString::fromStdString(fast.dict_find_string_value("qBt-name"));
-        torrentData.hasSeedStatus = fast.dict_find_int_value("qBt-seedStatus");
-        torrentData.disableTempPath = fast.dict_find_int_value("qBt-tempPathDisabled");
-        torrentData.hasRootFolder = fast.dict_find_int_value("qBt-hasRootFolder");
-
-        magnetUri = MagnetUri(QString::fromStdString(fast.dict_find_string_value("qBt-magnetUri")));
-        torrentData.addPaused = fast.dict_find_int_value("qBt-paused");
-        torrentData.addForced = fast.dict_find_int_value("qBt-forced");
-        torrentData.firstLastPiecePriority = fast.dict_find_int_value("qBt-firstLastPiecePriority");
-        torrentData.sequential = fast.dict_find_int_value("qBt-sequential");
-
-        prio = fast.dict_find_int_value("qBt-queuePosition");
-
-        return true;
+    else if (*it != flags) {
+        applyStatusReportFlags(m_torrentStatusReport, *it, -1);
+        applyStatusReportFlags(m_torrentStatusReport, flags, 1);
+        *it = flags;
     }
+}
 
+namespace
+{
     void torrentQueuePositionUp(const libt::torrent_handle &handle)
     {
         try {
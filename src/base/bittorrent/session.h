@@ -138,6 +138,8 @@ namespace BitTorrent
     class Tracker;
     class MagnetUri;
     class TrackerEntry;
+    class ResumeDataLoader;
+    struct LoadedResumeData;
     struct AddTorrentData;
 
     struct TorrentStatusReport
@@ -311,6 +313,7 @@ namespace BitTorrent
         void setCreateTorrentSubfolder(bool value);
         bool isTrackerEnabled() const;
         void setTrackerEnabled(bool enabled);
+        Tracker *tracker() const;  // nullptr if the embedded tracker is disabled
         bool isAppendExtensionEnabled() const;
         void setAppendExtensionEnabled(bool enabled);
         uint refreshInterval() const;
@@ -341,6 +344,8 @@ namespace BitTorrent
 
         uint saveResumeDataInterval() const;
         void setSaveResumeDataInterval(uint value);
+        bool isResumeDataDatabaseEnabled() const;
+        void setResumeDataDatabaseEnabled(bool enabled);
         int port() const;
         void setPort(int port);
         bool useRandomPort() const;
@@ -447,6 +452,7 @@ namespace BitTorrent
         void setBannedIPs(const QStringList &newList);
 
         void startUpTorrents();
+        bool isLoadingTorrents() const;
         TorrentHandle *findTorrent(const InfoHash &hash) const;
         QHash<InfoHash, TorrentHandle *> torrents() const;
         TorrentStatusReport torrentStatusReport() const;
@@ -478,6 +484,9 @@ namespace BitTorrent
 
         // TorrentHandle interface
         void handleTorrentShareLimitChanged(TorrentHandle *const torrent);
+        void handleTorrentNameChanged(TorrentHandle *const torrent);
+        void handleTorrentSpeedLimitChanged(TorrentHandle *const torrent);
+        void handleTorrentFirstLastPiecePriorityChanged(TorrentHandle *const torrent);
         void handleTorrentSavePathChanged(TorrentHandle *const torrent);
         void handleTorrentCategoryChanged(TorrentHandle *const torrent, const QString &oldCategory);
         void handleTorrentTagAdded(TorrentHandle *const torrent, const QString &tag);
@@ -502,7 +511,9 @@ namespace BitTorrent
 
     signals:
         void statsUpdated();
-        void torrentsUpdated();
+        void torrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents);
+        void torrentsLoadingProgress(int loaded, int total);
+        void torrentsLoaded();
         void addTorrentFailed(const QString &error);
         void torrentAdded(BitTorrent::TorrentHandle *const torrent);
         void torrentNew(BitTorrent::TorrentHandle *const torrent);
@@ -512,6 +523,11 @@ namespace BitTorrent
         void torrentFinished(BitTorrent::TorrentHandle *const torrent);
         void torrentFinishedChecking(BitTorrent::TorrentHandle *const torrent);
         void torrentSavePathChanged(BitTorrent::TorrentHandle *const torrent);
+        void torrentShareLimitChanged(BitTorrent::TorrentHandle *const torrent);
+        void torrentNameChanged(BitTorrent::TorrentHandle *const torrent);
+        void torrentSpeedLimitChanged(BitTorrent::TorrentHandle *const torrent);
+        void torrentFirstLastPiecePriorityChanged(BitTorrent::TorrentHandle *const torrent);
+        void globalShareLimitChanged();
         void torrentCategoryChanged(BitTorrent::TorrentHandle *const torrent, const QString &oldCategory);
         void torrentTagAdded(TorrentHandle *const torrent, const QString &tag);
         void torrentTagRemoved(TorrentHandle *const torrent, const QString &tag);
@@ -531,6 +547,7 @@ namespace BitTorrent
         void trackersRemoved(BitTorrent::TorrentHandle *const torrent, const QList<BitTorrent::TrackerEntry> &trackers);
         void trackersChanged(BitTorrent::TorrentHandle *const torrent);
         void trackerlessStateChanged(BitTorrent::TorrentHandle *const torrent, bool trackerless);
+        void urlSeedsChanged(BitTorrent::TorrentHandle *const torrent);
         void downloadFromUrlFailed(const QString &url, const QString &reason);
         void downloadFromUrlFinished(const QString &url);
         void categoryAdded(const QString &categoryName);
@@ -563,6 +580,9 @@ namespace BitTorrent
             bool requestedFileDeletion;
         };
 
+        // Torrent added while the resume data is being loaded
+        struct DeferredTorrent;
+
         explicit Session(QObject *parent = nullptr);
         ~Session();
 
@@ -599,6 +619,8 @@ namespace BitTorrent
                              TorrentInfo torrentInfo = TorrentInfo(),
                              const QByteArray &fastresumeData = QByteArray());
         bool findIncompleteFiles(TorrentInfo &torrentInfo, QString &savePath) const;
+        void handleResumeDataLoaded(const QVector<LoadedResumeData> &batch);
+        void handleResumeDataLoadingFinished(int remappedCount);
 
         void updateSeedingLimitTimer();
         void exportTorrentFile(TorrentHandle *const torrent, TorrentExportFolder folder = TorrentExportFolder::Regular);
@@ -608,6 +630,7 @@ namespace BitTorrent
         void dispatchTorrentAlert(libtorrent::alert *a);
         void handleAddTorrentAlert(libtorrent::add_torrent_alert *p);
         void handleStateUpdateAlert(libtorrent::state_update_alert *p);
+        void updateTorrentStatusReport(TorrentHandle *const torrent);
         void handleMetadataReceivedAlert(libtorrent::metadata_received_alert *p);
         void handleFileErrorAlert(libtorrent::file_error_alert *p);
         void handleTorrentRemovedAlert(libtorrent::torrent_removed_alert *p);
@@ -702,6 +725,7 @@ namespace BitTorrent
         CachedSettingValue<bool> m_isAltGlobalSpeedLimitEnabled;
         CachedSettingValue<bool> m_isBandwidthSchedulerEnabled;
         CachedSettingValue<uint> m_saveResumeDataInterval;
+        CachedSettingValue<bool> m_isResumeDataDatabaseEnabled;
         CachedSettingValue<int> m_port;
         CachedSettingValue<bool> m_useRandomPort;
         CachedSettingValue<QString> m_networkInterface;
@@ -751,13 +775,18 @@ namespace BitTorrent
         // fastresume data writing thread
         QThread *m_ioThread;
         ResumeDataSavingManager *m_resumeDataSavingManager;
+        // fastresume data loading pool, exists until all torrents are resumed
+        ResumeDataLoader *m_resumeDataLoader;
 
         QHash<InfoHash, TorrentInfo> m_loadedMetadata;
         QHash<InfoHash, TorrentHandle *> m_torrents;
         QHash<InfoHash, AddTorrentData> m_addingTorrents;
         QHash<QString, AddTorrentParams> m_downloadedTorrents;
+        QVector<DeferredTorrent> m_deferredTorrents;
         QHash<InfoHash, RemovingTorrentData> m_removingTorrents;
+        // maintained incrementally from the torrent state changes
         TorrentStatusReport m_torrentStatusReport;
+        QHash<TorrentHandle *, uint> m_torrentStatusFlags;
         QStringMap m_categories;
         QSet<QString> m_tags;
 
@@ -402,6 +402,7 @@ void TorrentHandle::replaceTrackers(QList<TrackerEntry> trackers)
     }
 
     m_nativeHandle.replace_trackers(announces);
+    m_magnetUri.clear();
     if (addedTrackers.isEmpty() && existingTrackers.isEmpty()) {
         m_session->handleTorrentTrackersChanged(this);
     }
@@ -419,6 +420,7 @@ bool TorrentHandle::addTracker(const TrackerEntry &tracker)
         return false;
 
     m_nativeHandle.add_tracker(tracker.nativeEntry());
+    m_magnetUri.clear();
     return true;
 }
 
@@ -463,6 +465,7 @@ bool TorrentHandle::addUrlSeed(const QUrl &urlSeed)
     if (seeds.contains(urlSeed)) return false;
 
     m_nativeHandle.add_url_seed(urlSeed.toString().toStdString());
+    m_magnetUri.clear();
     return true;
 }
 
@@ -472,6 +475,7 @@ bool TorrentHandle::removeUrlSeed(const QUrl &urlSeed)
     if (!seeds.contains(urlSeed)) return false;
 
     m_nativeHandle.remove_url_seed(urlSeed.toString().toStdString());
+    m_magnetUri.clear();
     return true;
 }
 
@@ -607,6 +611,16 @@ int TorrentHandle::seedingTimeLimit() const
     return m_seedingTimeLimit;
 }
 
+FileTree TorrentHandle::fileTree() const
+{
+    if (!m_fileTreeUpToDate && hasMetadata()) {
+        m_fileTree = FileTree(m_torrentInfo);
+        m_fileTreeUpToDate = true;
+    }
+
+    return m_fileTree;
+}
+
 QString TorrentHandle::filePath(int index) const
 {
     return m_torrentInfo.filePath(index);
@@ -776,6 +790,14 @@ bool TorrentHandle::hasFirstLastPiecePriority() const
     if (!hasMetadata())
         return m_needsToSetFirstLastPiecePriority;
 
+    if (m_hasFirstLastPiecePriority == TriStateBool::Undefined)
+        m_hasFirstLastPiecePriority = hasFirstLastPiecePriority_impl() ? TriStateBool::True : TriStateBool::False;
+
+    return (m_hasFirstLastPiecePriority == TriStateBool::True);
+}
+
+bool TorrentHandle::hasFirstLastPiecePriority_impl() const
+{
     // Get int first media file
     std::vector<int> fp;
     fp = m_nativeHandle.file_priorities();
@@ -969,20 +991,9 @@ qulonglong TorrentHandle::eta() const
 
 QVector<qreal> TorrentHandle::filesProgress() const
 {
-    std::vector<boost::int64_t> fp;
-    QVector<qreal> result;
-    m_nativeHandle.file_progress(fp, libt::torrent_handle::piece_granularity);
-
-    int count = static_cast<int>(fp.size());
-    for (int i = 0; i < count; ++i) {
-        qlonglong size = fileSize(i);
-        if ((size <= 0) || (fp[i] == size))
-            result << 1;
-        else
-            result << (fp[i] / static_cast<qreal>(size));
-    }
-
-    return result;
+    // The progress is counted with piece granularity so it can be calculated
+    // from the pieces of the last status update instead of querying libtorrent
+    return fileTree().filesProgress(pieces());
 }
 
 int TorrentHandle::seedsCount() const
@@ -1089,14 +1100,14 @@ QList<PeerInfo> TorrentHandle::peers() const
     return peers;
 }
 
-QBitArray TorrentHandle::pieces() const
+Bitfield TorrentHandle::pieces() const
 {
-    QBitArray result(m_nativeStatus.pieces.size());
-
-    for (int i = 0; i < m_nativeStatus.pieces.size(); ++i)
-        result.setBit(i, m_nativeStatus.pieces.get_bit(i));
+    if (!m_piecesUpToDate) {
+        m_pieces = Bitfield(m_nativeStatus.pieces);
+        m_piecesUpToDate = true;
+    }
 
-    return result;
+    return m_pieces;
 }
 
 QBitArray TorrentHandle::downloadingPieces() const
@@ -1201,6 +1212,7 @@ void TorrentHandle::setName(const QString &name)
     if (m_name != name) {
         m_name = name;
         m_needSaveResumeData = true;
+        m_session->handleTorrentNameChanged(this);
     }
 }
 
@@ -1298,6 +1310,7 @@ void TorrentHandle::setFirstLastPiecePriority(bool b)
 {
     if (!hasMetadata()) {
         m_needsToSetFirstLastPiecePriority = b;
+        m_session->handleTorrentFirstLastPiecePriorityChanged(this);
         return;
     }
 
@@ -1327,6 +1340,8 @@ void TorrentHandle::setFirstLastPiecePriority(bool b)
     }
 
     m_nativeHandle.prioritize_pieces(pp);
+    m_hasFirstLastPiecePriority = TriStateBool::Undefined;
+    m_session->handleTorrentFirstLastPiecePriorityChanged(this);
 }
 
 void TorrentHandle::toggleFirstLastPiecePriority()
@@ -1498,6 +1513,8 @@ void TorrentHandle::handleTrackerReplyAlert(const libtorrent::tracker_reply_aler
     // Connection was successful now. Remove possible old errors
     m_trackerInfos[trackerUrl].lastMessage.clear(); // Reset error/warning message
     m_trackerInfos[trackerUrl].numPeers = p->num_peers;
+    // Trackers could have been added by libtorrent itself (e.g. by tracker exchange)
+    m_magnetUri.clear();
 
     m_session->handleTorrentTrackerReply(this, trackerUrl);
 }
@@ -1670,6 +1687,8 @@ void TorrentHandle::handleFileRenamedAlert(const libtorrent::file_renamed_alert
     QString newName = Utils::Fs::fromNativePath(p->new_name());
 #endif
 
+    m_fileTreeUpToDate = false;
+
     // TODO: Check this!
     if (filesCount() > 1) {
         // Check if folders were renamed
@@ -1687,6 +1706,8 @@ void TorrentHandle::handleFileRenamedAlert(const libtorrent::file_renamed_alert
         }
     }
 
+    // File extension affects which files get first/last piece priority
+    m_hasFirstLastPiecePriority = TriStateBool::Undefined;
     updateStatus();
 
     --m_renameCount;
@@ -1731,11 +1752,14 @@ void TorrentHandle::handleMetadataReceivedAlert(const libt::metadata_received_al
 {
     Q_UNUSED(p);
     qDebug("Metadata received for torrent %s.", qUtf8Printable(name()));
+    m_magnetUri.clear();
+    m_hasFirstLastPiecePriority = TriStateBool::Undefined;
     updateStatus();
     if (m_session->isAppendExtensionEnabled())
         manageIncompleteFiles();
     if (!m_hasRootFolder)
         m_torrentInfo.stripRootFolder();
+    m_fileTreeUpToDate = false;
     if (filesCount() == 1)
         m_hasRootFolder = false;
     m_session->handleTorrentMetadataReceived(this);
@@ -1914,6 +1938,7 @@ void TorrentHandle::updateStatus()
 void TorrentHandle::updateStatus(const libtorrent::torrent_status &nativeStatus)
 {
     m_nativeStatus = nativeStatus;
+    m_piecesUpToDate = false;
 
     updateState();
     updateTorrentInfo();
@@ -1950,11 +1975,13 @@ void TorrentHandle::setSeedingTimeLimit(int limit)
 void TorrentHandle::setUploadLimit(int limit)
 {
     m_nativeHandle.set_upload_limit(limit);
+    m_session->handleTorrentSpeedLimitChanged(this);
 }
 
 void TorrentHandle::setDownloadLimit(int limit)
 {
     m_nativeHandle.set_download_limit(limit);
+    m_session->handleTorrentSpeedLimitChanged(this);
 }
 
 void TorrentHandle::setSuperSeeding(bool enable)
@@ -1971,7 +1998,9 @@ void TorrentHandle::flushCache()
 
 QString TorrentHandle::toMagnetUri() const
 {
-    return QString::fromStdString(libt::make_magnet_uri(m_nativeHandle));
+    if (m_magnetUri.isEmpty())
+        m_magnetUri = QString::fromStdString(libt::make_magnet_uri(m_nativeHandle));
+    return m_magnetUri;
 }
 
 void TorrentHandle::prioritizeFiles(const QVector<int> &priorities)
@@ -1995,6 +2024,7 @@ void TorrentHandle::prioritizeFiles(const QVector<int> &priorities)
 
     qDebug() << Q_FUNC_INFO << "Changing files priorities...";
     m_nativeHandle.prioritize_files(priorities.toStdVector());
+    m_hasFirstLastPiecePriority = TriStateBool::Undefined;
 
     qDebug() << Q_FUNC_INFO << "Moving unwanted files to .unwanted folder and conversely...";
     QString spath = savePath(true);
@@ -2063,19 +2093,23 @@ QVector<qreal> TorrentHandle::availableFileFractions() const
     const auto filesCount = this->filesCount();
     if (filesCount < 0) return {};
 
-    const QVector<int> piecesAvailability = pieceAvailability();
+    std::vector<int> piecesAvailability;
+    m_nativeHandle.piece_availability(piecesAvailability);
     // libtorrent returns empty array for seeding only torrents
     if (piecesAvailability.empty()) return QVector<qreal>(filesCount, -1.);
 
+    // availableBefore[i] is the number of available pieces preceding piece i,
+    // so available pieces of each file are counted in constant time
+    std::vector<int> availableBefore(piecesAvailability.size() + 1, 0);
+    for (std::size_t piece = 0; piece < piecesAvailability.size(); ++piece)
+        availableBefore[piece + 1] = availableBefore[piece] + ((piecesAvailability[piece] > 0) ? 1 : 0);
+
     QVector<qreal> res;
     res.reserve(filesCount);
-    TorrentInfo info = this->info();
+    const FileTree files = fileTree();
     for (int file = 0; file < filesCount; ++file) {
-        TorrentInfo::PieceRange filePieces = info.filePieces(file);
-        int availablePieces = 0;
-        for (int piece = filePieces.first(); piece <= filePieces.last(); ++piece) {
-            availablePieces += piecesAvailability[piece] > 0 ? 1 : 0;
-        }
+        const TorrentInfo::PieceRange filePieces = files.filePieces(file);
+        const int availablePieces = availableBefore[filePieces.last() + 1] - availableBefore[filePieces.first()];
         res.push_back(static_cast<qreal>(availablePieces) / filePieces.size());
     }
     return res;
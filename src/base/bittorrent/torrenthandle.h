@@ -48,6 +48,8 @@
 
 #include "base/tristatebool.h"
 #include "private/speedmonitor.h"
+#include "bitfield.h"
+#include "filetree.h"
 #include "infohash.h"
 #include "torrentinfo.h"
 
@@ -257,6 +259,7 @@ namespace BitTorrent
         qreal ratioLimit() const;
         int seedingTimeLimit() const;
 
+        FileTree fileTree() const;
         QString filePath(int index) const;
         QString fileName(int index) const;
         qlonglong fileSize(int index) const;
@@ -313,7 +316,7 @@ namespace BitTorrent
         int uploadLimit() const;
         bool superSeeding() const;
         QList<PeerInfo> peers() const;
-        QBitArray pieces() const;
+        Bitfield pieces() const;
         QBitArray downloadingPieces() const;
         QVector<int> pieceAvailability() const;
         qreal distributedCopies() const;
@@ -418,10 +421,17 @@ namespace BitTorrent
         bool addTracker(const TrackerEntry &tracker);
         bool addUrlSeed(const QUrl &urlSeed);
         bool removeUrlSeed(const QUrl &urlSeed);
+        bool hasFirstLastPiecePriority_impl() const;
 
         Session *const m_session;
         libtorrent::torrent_handle m_nativeHandle;
         libtorrent::torrent_status m_nativeStatus;
+        // snapshot of m_nativeStatus.pieces, it is made on demand once per status update
+        mutable Bitfield m_pieces;
+        mutable bool m_piecesUpToDate = false;
+        // file layout is rebuilt on demand when metadata is received or files are renamed
+        mutable FileTree m_fileTree;
+        mutable bool m_fileTreeUpToDate = false;
         TorrentState m_state;
         TorrentInfo m_torrentInfo;
         SpeedMonitor m_speedMonitor;
@@ -461,6 +471,11 @@ namespace BitTorrent
         bool m_pauseAfterRecheck;
         bool m_needSaveResumeData;
         QHash<QString, TrackerInfo> m_trackerInfos;
+
+        // These are expensive to query from libtorrent so they are cached
+        // until something they depend on is changed
+        mutable QString m_magnetUri;
+        mutable TriStateBool m_hasFirstLastPiecePriority;
     };
 }
 
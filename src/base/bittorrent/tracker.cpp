@@ -29,49 +29,159 @@
 
 #include "tracker.h"
 
+#include <cstring>
 #include <vector>
 
+#include <QCryptographicHash>
+#include <QMap>
+#include <QSet>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QtEndian>
+
 #include <libtorrent/bencode.hpp>
 #include <libtorrent/entry.hpp>
 
 #include "base/global.h"
 #include "base/http/server.h"
+#include "base/logger.h"
 #include "base/preferences.h"
 #include "base/utils/bytearray.h"
+#include "base/utils/random.h"
 #include "base/utils/string.h"
 
 // static limits
-static const int MAX_TORRENTS = 100;
-static const int MAX_PEERS_PER_TORRENT = 1000;
+static const int MAX_PEERS = 1000000;  // a peer takes about 50 bytes
 static const int ANNOUNCE_INTERVAL = 1800; // 30min
+static const int PEER_TIMEOUT = 2 * ANNOUNCE_INTERVAL; // peers that stop announcing are dropped after it
+static const int EXPIRATION_SCAN_INTERVAL = 300; // 5min
+static const int DEFAULT_NUMWANT = 50;
+static const int MAX_NUMWANT = 200;
+
+// [BEP 15] UDP Tracker Protocol
+static const quint64 UDP_PROTOCOL_ID = 0x41727101980;
+static const qint32 UDP_ACTION_CONNECT = 0;
+static const qint32 UDP_ACTION_ANNOUNCE = 1;
+static const qint32 UDP_ACTION_SCRAPE = 2;
+static const qint32 UDP_ACTION_ERROR = 3;
+static const int UDP_CONNECTION_ID_LIFETIME = 60 * 1000; // msecs, ids are accepted for 1-2 lifetimes
+static const int UDP_REQUEST_HEADER_SIZE = 16;
+static const int UDP_ANNOUNCE_REQUEST_SIZE = 98;
+static const int UDP_MAX_REPLY_SIZE = 1472; // avoids fragmentation on ethernet
+static const int UDP_MAX_SCRAPE_HASHES = 74;
 
 using namespace BitTorrent;
 
-// Peer
-bool Peer::operator!=(const Peer &other) const
+namespace
+{
+    const quint8 IPV4_MAPPED_PREFIX[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+
+    PeerEndpoint makeEndpoint(const QHostAddress &address, const quint16 port)
+    {
+        PeerEndpoint endpoint;
+
+        bool isIPv4 = false;
+        const quint32 ipv4 = address.toIPv4Address(&isIPv4);
+        if (isIPv4) {
+            memcpy(endpoint.address, IPV4_MAPPED_PREFIX, sizeof(IPV4_MAPPED_PREFIX));
+            qToBigEndian(ipv4, endpoint.address + 12);
+        }
+        else {
+            const Q_IPV6ADDR ipv6 = address.toIPv6Address();
+            memcpy(endpoint.address, ipv6.c, sizeof(endpoint.address));
+        }
+
+        endpoint.port = port;
+        return endpoint;
+    }
+
+    template <typename Container>
+    void appendCompact(Container &out, const PeerEndpoint &endpoint)
+    {
+        // [BEP 23] 4 bytes IPv4 address or [BEP 7] 16 bytes IPv6 address,
+        // followed by 2 bytes port, all in network byte order
+        const char *address = reinterpret_cast<const char *>(endpoint.address);
+        if (endpoint.isIPv4())
+            out.append((address + 12), 4);
+        else
+            out.append(address, 16);
+        out.push_back(static_cast<char>(endpoint.port >> 8));
+        out.push_back(static_cast<char>(endpoint.port & 0xFF));
+    }
+
+    libtorrent::entry toEntry(const Peer &peer, const bool noPeerId)
+    {
+        libtorrent::entry::dictionary_type peerMap;
+        if (!noPeerId)
+            peerMap["id"] = libtorrent::entry(std::string(peer.peerId, sizeof(peer.peerId)));
+        peerMap["ip"] = libtorrent::entry(peer.endpoint.hostAddress().toString().toStdString());
+        peerMap["port"] = libtorrent::entry(static_cast<libtorrent::entry::integer_type>(peer.endpoint.port));
+
+        return libtorrent::entry(peerMap);
+    }
+
+    QMultiMap<QString, QByteArray> parseQuery(const QByteArray &query)
+    {
+        QMultiMap<QString, QByteArray> queryParams;
+        // Parse GET parameters
+        using namespace Utils::ByteArray;
+        for (const QByteArray &param : copyAsConst(splitToViews(query, "&"))) {
+            const int sepPos = param.indexOf('=');
+            if (sepPos <= 0) continue; // ignores params without name
+
+            const QString paramName {QString::fromUtf8(param.constData(), sepPos)};
+            const QByteArray paramValue {param.mid(sepPos + 1)};
+            queryParams.insert(paramName, paramValue);
+        }
+
+        return queryParams;
+    }
+
+    template <typename T>
+    void appendBigEndian(QByteArray &out, const T value)
+    {
+        uchar buffer[sizeof(T)];
+        qToBigEndian(value, buffer);
+        out.append(reinterpret_cast<const char *>(buffer), sizeof(T));
+    }
+
+    template <typename T>
+    T readBigEndian(const QByteArray &data, const int offset)
+    {
+        return qFromBigEndian<T>(reinterpret_cast<const uchar *>(data.constData() + offset));
+    }
+}
+
+// PeerEndpoint
+bool PeerEndpoint::isIPv4() const
 {
-    return uid() != other.uid();
+    return (memcmp(address, IPV4_MAPPED_PREFIX, sizeof(IPV4_MAPPED_PREFIX)) == 0);
 }
 
-bool Peer::operator==(const Peer &other) const
+QHostAddress PeerEndpoint::hostAddress() const
 {
-    return uid() == other.uid();
+    if (isIPv4())
+        return QHostAddress(qFromBigEndian<quint32>(address + 12));
+
+    Q_IPV6ADDR ipv6;
+    memcpy(ipv6.c, address, sizeof(address));
+    return QHostAddress(ipv6);
 }
 
-QString Peer::uid() const
+bool BitTorrent::operator==(const PeerEndpoint &left, const PeerEndpoint &right)
 {
-    return ip + ":" + QString::number(port);
+    return ((left.port == right.port)
+            && (memcmp(left.address, right.address, sizeof(left.address)) == 0));
 }
 
-libtorrent::entry Peer::toEntry(bool noPeerId) const
+bool BitTorrent::operator!=(const PeerEndpoint &left, const PeerEndpoint &right)
 {
-    libtorrent::entry::dictionary_type peerMap;
-    if (!noPeerId)
-        peerMap["id"] = libtorrent::entry(peerId.toStdString());
-    peerMap["ip"] = libtorrent::entry(ip.toStdString());
-    peerMap["port"] = libtorrent::entry(port);
+    return !(left == right);
+}
 
-    return libtorrent::entry(peerMap);
+uint BitTorrent::qHash(const PeerEndpoint &key, const uint seed)
+{
+    return (qHashBits(key.address, sizeof(key.address), seed) ^ ::qHash(key.port, seed));
 }
 
 // Tracker
@@ -79,7 +189,20 @@ libtorrent::entry Peer::toEntry(bool noPeerId) const
 Tracker::Tracker(QObject *parent)
     : QObject(parent)
     , m_server(new Http::Server(this, this))
+    , m_udpSocket(new QUdpSocket(this))
+    , m_udpSecret((static_cast<quint64>(Utils::Random::rand()) << 32) | Utils::Random::rand())
+    , m_peerCount(0)
+    , m_seederCount(0)
+    , m_downloadedCount(0)
+    , m_announceCount(0)
+    , m_scrapeCount(0)
 {
+    m_clock.start();
+    connect(m_udpSocket, &QUdpSocket::readyRead, this, &Tracker::readUdpDatagrams);
+
+    QTimer *expirationTimer = new QTimer(this);
+    connect(expirationTimer, &QTimer::timeout, this, &Tracker::removeExpiredPeers);
+    expirationTimer->start(EXPIRATION_SCAN_INTERVAL * 1000);
 }
 
 Tracker::~Tracker()
@@ -93,6 +216,13 @@ bool Tracker::start()
 {
     const int listenPort = Preferences::instance()->getTrackerPort();
 
+    if ((m_udpSocket->state() == QAbstractSocket::BoundState) && (m_udpSocket->localPort() != listenPort))
+        m_udpSocket->close();
+    if ((m_udpSocket->state() != QAbstractSocket::BoundState) && !m_udpSocket->bind(QHostAddress::Any, listenPort)) {
+        LogMsg(tr("Embedded tracker: unable to listen on UDP port %1. Reason: %2")
+               .arg(listenPort).arg(m_udpSocket->errorString()), Log::WARNING);
+    }
+
     if (m_server->isListening()) {
         if (m_server->serverPort() == listenPort) {
             // Already listening on the right port, just return
@@ -117,39 +247,31 @@ Http::Response Tracker::processRequest(const Http::Request &request, const Http:
         qDebug("Tracker: Unsupported HTTP request: %s", qUtf8Printable(request.method));
         status(100, "Invalid request type");
     }
-    else if (!request.path.startsWith("/announce", Qt::CaseInsensitive)) {
-        qDebug("Tracker: Unrecognized path: %s", qUtf8Printable(request.path));
-        status(100, "Invalid request type");
-    }
-    else {
+    else if (request.path.startsWith("/announce", Qt::CaseInsensitive)) {
         // OK, this is a GET request
         m_request = request;
         m_env = env;
         respondToAnnounceRequest();
     }
+    else if (request.path.startsWith("/scrape", Qt::CaseInsensitive)) {
+        m_request = request;
+        m_env = env;
+        respondToScrapeRequest();
+    }
+    else {
+        qDebug("Tracker: Unrecognized path: %s", qUtf8Printable(request.path));
+        status(100, "Invalid request type");
+    }
 
     return response();
 }
 
 void Tracker::respondToAnnounceRequest()
 {
-    QMap<QString, QByteArray> queryParams;
-    // Parse GET parameters
-    using namespace Utils::ByteArray;
-    for (const QByteArray &param : copyAsConst(splitToViews(m_request.query, "&"))) {
-        const int sepPos = param.indexOf('=');
-        if (sepPos <= 0) continue; // ignores params without name
-
-        const QString paramName {QString::fromUtf8(param.constData(), sepPos)};
-        const QByteArray paramValue {param.mid(sepPos + 1)};
-        queryParams[paramName] = paramValue;
-    }
+    const QMultiMap<QString, QByteArray> queryParams = parseQuery(m_request.query);
 
     TrackerAnnounceRequest annonceReq;
 
-    // IP
-    annonceReq.peer.ip = m_env.clientAddress.toString();
-
     // 1. Get info_hash
     if (!queryParams.contains("info_hash")) {
         qDebug("Tracker: Missing info_hash");
@@ -170,7 +292,9 @@ void Tracker::respondToAnnounceRequest()
         status(102, "Missing peer_id");
         return;
     }
-    annonceReq.peer.peerId = queryParams.value("peer_id");
+    const QByteArray peerId = queryParams.value("peer_id");
+    memset(annonceReq.peer.peerId, 0, sizeof(annonceReq.peer.peerId));
+    memcpy(annonceReq.peer.peerId, peerId.constData(), qMin<size_t>(peerId.size(), sizeof(annonceReq.peer.peerId)));
     // peer_id cannot be longer than 20 bytes
     /*if (annonce_req.peer.peer_id.length() > 20) {
         qDebug("Tracker: peer_id is not 20 byte long: %s", qUtf8Printable(annonce_req.peer.peer_id));
@@ -185,13 +309,17 @@ void Tracker::respondToAnnounceRequest()
         return;
     }
     bool ok = false;
-    annonceReq.peer.port = queryParams.value("port").toInt(&ok);
-    if (!ok || (annonceReq.peer.port < 0) || (annonceReq.peer.port > 65535)) {
-        qDebug("Tracker: Invalid port number (%d)", annonceReq.peer.port);
+    const int port = queryParams.value("port").toInt(&ok);
+    if (!ok || (port < 0) || (port > 65535)) {
+        qDebug("Tracker: Invalid port number (%d)", port);
         status(103, "Missing port");
         return;
     }
 
+    // IP
+    annonceReq.peer.endpoint = makeEndpoint(m_env.clientAddress, port);
+    annonceReq.peer.lastAnnounced = m_clock.elapsed() / 1000;
+
     // 4.  Get event
     annonceReq.event = "";
     if (queryParams.contains("event")) {
@@ -200,23 +328,28 @@ void Tracker::respondToAnnounceRequest()
     }
 
     // 5. Get numwant
-    annonceReq.numwant = 50;
+    annonceReq.numwant = DEFAULT_NUMWANT;
     if (queryParams.contains("numwant")) {
         int tmp = queryParams.value("numwant").toInt();
-        if (tmp > 0) {
+        if (tmp >= 0) {
             qDebug("Tracker: numwant = %d", tmp);
-            annonceReq.numwant = tmp;
+            annonceReq.numwant = qMin(tmp, MAX_NUMWANT);
         }
     }
 
-    // 6. no_peer_id (extension)
+    // 6. left
+    annonceReq.peer.isSeed = (queryParams.contains("left") && (queryParams.value("left").toLongLong() == 0));
+
+    // 7. no_peer_id (extension)
     annonceReq.noPeerId = false;
     if (queryParams.contains("no_peer_id"))
         annonceReq.noPeerId = true;
 
-    // 7. TODO: support "compact" extension
+    // 8. compact (extension)
+    annonceReq.compact = (queryParams.value("compact") == "1");
 
     // Done parsing, now let's reply
+    ++m_announceCount;
     if (annonceReq.event == "stopped") {
         unregisterPeer(annonceReq);
     }
@@ -226,36 +359,227 @@ void Tracker::respondToAnnounceRequest()
     }
 }
 
-void Tracker::registerPeer(const TrackerAnnounceRequest &annonceReq)
+void Tracker::respondToScrapeRequest()
 {
-    if (annonceReq.peer.port == 0) return;
+    ++m_scrapeCount;
+
+    // [BEP 48] no "info_hash" means all torrents
+    QList<QByteArray> infoHashes = parseQuery(m_request.query).values("info_hash");
+    if (infoHashes.isEmpty())
+        infoHashes = m_torrents.keys();
+
+    libtorrent::entry::dictionary_type filesDict;
+    for (const QByteArray &infoHash : qAsConst(infoHashes)) {
+        const TrackerTorrentStats torrentStats = this->torrentStats(infoHash);
+
+        libtorrent::entry::dictionary_type torrentDict;
+        torrentDict["complete"] = libtorrent::entry(torrentStats.complete);
+        torrentDict["downloaded"] = libtorrent::entry(torrentStats.downloaded);
+        torrentDict["incomplete"] = libtorrent::entry(torrentStats.incomplete);
+        filesDict[infoHash.toStdString()] = libtorrent::entry(torrentDict);
+    }
 
-    if (!m_torrents.contains(annonceReq.infoHash)) {
-        // Unknown torrent
-        if (m_torrents.size() == MAX_TORRENTS) {
-            // Reached max size, remove a random torrent
-            m_torrents.erase(m_torrents.begin());
-        }
+    libtorrent::entry::dictionary_type replyDict;
+    replyDict["files"] = libtorrent::entry(filesDict);
+
+    const libtorrent::entry replyEntry(replyDict);
+    // bencode
+    QByteArray reply;
+    libtorrent::bencode(std::back_inserter(reply), replyEntry);
+
+    // HTTP reply
+    print(reply, Http::CONTENT_TYPE_TXT);
+}
+
+TrackerStats Tracker::stats() const
+{
+    return {m_torrents.size(), m_peerCount, m_seederCount, m_downloadedCount, m_announceCount, m_scrapeCount};
+}
+
+TrackerTorrentStats Tracker::torrentStats(const QByteArray &infoHash) const
+{
+    const int downloaded = m_completedCounts.value(infoHash);
+    const auto torrentIter = m_torrents.constFind(infoHash);
+    if (torrentIter == m_torrents.constEnd())
+        return {0, 0, downloaded};
+
+    const PeerList &peerList = *torrentIter;
+    return {peerList.seeders, (peerList.peers.size() - peerList.seeders), downloaded};
+}
+
+QHash<QByteArray, TrackerTorrentStats> Tracker::torrentStats() const
+{
+    QHash<QByteArray, TrackerTorrentStats> result;
+    result.reserve(m_torrents.size());
+    for (auto i = m_torrents.cbegin(); i != m_torrents.cend(); ++i)
+        result.insert(i.key(), {i->seeders, (i->peers.size() - i->seeders), m_completedCounts.value(i.key())});
+    for (auto i = m_completedCounts.cbegin(); i != m_completedCounts.cend(); ++i) {
+        if (!result.contains(i.key()))
+            result.insert(i.key(), {0, 0, i.value()});
     }
 
-    // Register the user
-    PeerList &peers = m_torrents[annonceReq.infoHash];
-    if (!peers.contains(annonceReq.peer.uid())) {
-        // Unknown peer
-        if (peers.size() == MAX_PEERS_PER_TORRENT) {
-            // Too many peers, remove a random one
-            peers.erase(peers.begin());
+    return result;
+}
+
+void Tracker::registerPeer(const TrackerAnnounceRequest &annonceReq)
+{
+    if (annonceReq.peer.endpoint.port == 0) return;
+
+    auto torrentIter = m_torrents.find(annonceReq.infoHash);
+    if (torrentIter != m_torrents.end()) {
+        PeerList &peerList = *torrentIter;
+        const auto indexIter = peerList.indexes.constFind(annonceReq.peer.endpoint);
+        if (indexIter != peerList.indexes.constEnd()) {
+            // Known peer
+            Peer &peer = peerList.peers[*indexIter];
+            if (peer.isSeed != annonceReq.peer.isSeed) {
+                const int delta = annonceReq.peer.isSeed ? 1 : -1;
+                peerList.seeders += delta;
+                m_seederCount += delta;
+            }
+            if (annonceReq.event == "completed") {
+                ++m_completedCounts[annonceReq.infoHash];
+                ++m_downloadedCount;
+            }
+            peer = annonceReq.peer;
+            return;
         }
     }
-    peers[annonceReq.peer.uid()] = annonceReq.peer;
+
+    // Unknown peer
+    if (m_peerCount >= MAX_PEERS) {
+        qDebug("Tracker: Reached the maximum number of peers");
+        return;
+    }
+
+    if (torrentIter == m_torrents.end())
+        torrentIter = m_torrents.insert(annonceReq.infoHash, PeerList());
+
+    PeerList &peerList = *torrentIter;
+    peerList.indexes.insert(annonceReq.peer.endpoint, peerList.peers.size());
+    peerList.peers.append(annonceReq.peer);
+    ++m_peerCount;
+    if (annonceReq.peer.isSeed) {
+        ++peerList.seeders;
+        ++m_seederCount;
+    }
+    if (annonceReq.event == "completed") {
+        ++m_completedCounts[annonceReq.infoHash];
+        ++m_downloadedCount;
+    }
 }
 
 void Tracker::unregisterPeer(const TrackerAnnounceRequest &annonceReq)
 {
-    if (annonceReq.peer.port == 0) return;
+    if (annonceReq.peer.endpoint.port == 0) return;
+
+    const auto torrentIter = m_torrents.find(annonceReq.infoHash);
+    if (torrentIter == m_torrents.end()) return;
+
+    PeerList &peerList = *torrentIter;
+    const int index = peerList.indexes.value(annonceReq.peer.endpoint, -1);
+    if (index < 0) return;
+
+    qDebug("Tracker: Peer stopped downloading, deleting it from the list");
+    removePeerAt(peerList, index);
+    if (peerList.peers.isEmpty())
+        m_torrents.erase(torrentIter);
+}
+
+void Tracker::removeExpiredPeers()
+{
+    const int now = m_clock.elapsed() / 1000;
+
+    QMutableHashIterator<QByteArray, PeerList> i(m_torrents);
+    while (i.hasNext()) {
+        PeerList &peerList = i.next().value();
+        // iterate backwards so the peer moved into a gap is already checked
+        for (int index = (peerList.peers.size() - 1); index >= 0; --index) {
+            if ((now - peerList.peers[index].lastAnnounced) > PEER_TIMEOUT)
+                removePeerAt(peerList, index);
+        }
+
+        if (peerList.peers.isEmpty())
+            i.remove();
+    }
+}
+
+void Tracker::removePeerAt(PeerList &peerList, const int index)
+{
+    --m_peerCount;
+    if (peerList.peers[index].isSeed) {
+        --peerList.seeders;
+        --m_seederCount;
+    }
+
+    // fill the gap with the last peer
+    peerList.indexes.remove(peerList.peers[index].endpoint);
+    const int lastIndex = peerList.peers.size() - 1;
+    if (index != lastIndex) {
+        peerList.peers[index] = peerList.peers[lastIndex];
+        peerList.indexes[peerList.peers[index].endpoint] = index;
+    }
+    peerList.peers.removeLast();
+}
+
+QVector<const Peer *> Tracker::pickPeers(const QByteArray &infoHash, const int count, const PeerEndpoint &self
+    , const QAbstractSocket::NetworkLayerProtocol protocol) const
+{
+    QVector<const Peer *> result;
+
+    const auto torrentIter = m_torrents.constFind(infoHash);
+    if ((torrentIter == m_torrents.constEnd()) || (count <= 0))
+        return result;
+
+    const QVector<Peer> &peers = (*torrentIter).peers;
+    const bool anyProtocol = (protocol == QAbstractSocket::AnyIPProtocol);
+
+    // sample only among the peers of the requested address family
+    QVector<const Peer *> matchingPeers;
+    if (!anyProtocol) {
+        const bool wantsIPv4 = (protocol == QAbstractSocket::IPv4Protocol);
+        for (const Peer &peer : peers) {
+            if (peer.endpoint.isIPv4() == wantsIPv4)
+                matchingPeers.append(&peer);
+        }
+    }
+
+    const auto peerAt = [&peers, &matchingPeers, anyProtocol](const int index)
+    {
+        return anyProtocol ? &peers[index] : matchingPeers[index];
+    };
+
+    // pick one more peer in case the requesting one is among them
+    const int peerCount = anyProtocol ? peers.size() : matchingPeers.size();
+    const int sampleSize = qMin((count + 1), peerCount);
+    result.reserve(sampleSize);
+
+    if (sampleSize == peerCount) {
+        for (int index = 0; index < peerCount; ++index)
+            result.append(peerAt(index));
+    }
+    else {
+        // Robert Floyd's algorithm, picks `sampleSize` distinct indexes in O(sampleSize)
+        QSet<int> picked;
+        picked.reserve(sampleSize);
+        for (int j = (peerCount - sampleSize); j < peerCount; ++j) {
+            const int t = Utils::Random::rand(0, j);
+            const int index = picked.contains(t) ? j : t;
+            picked.insert(index);
+            result.append(peerAt(index));
+        }
+    }
+
+    for (int i = 0; i < result.size(); ++i) {
+        if (result[i]->endpoint == self) {
+            result.remove(i);
+            break;
+        }
+    }
+    if (result.size() > count)
+        result.resize(count);
 
-    if (m_torrents[annonceReq.infoHash].remove(annonceReq.peer.uid()) > 0)
-        qDebug("Tracker: Peer stopped downloading, deleting it from the list");
+    return result;
 }
 
 void Tracker::replyWithPeerList(const TrackerAnnounceRequest &annonceReq)
@@ -264,17 +588,193 @@ void Tracker::replyWithPeerList(const TrackerAnnounceRequest &annonceReq)
     libtorrent::entry::dictionary_type replyDict;
     replyDict["interval"] = libtorrent::entry(ANNOUNCE_INTERVAL);
 
-    libtorrent::entry::list_type peerList;
-    for (const Peer &p : m_torrents.value(annonceReq.infoHash))
-        peerList.push_back(p.toEntry(annonceReq.noPeerId));
-    replyDict["peers"] = libtorrent::entry(peerList);
+    const TrackerTorrentStats torrentStats = this->torrentStats(annonceReq.infoHash);
+    replyDict["complete"] = libtorrent::entry(torrentStats.complete);
+    replyDict["incomplete"] = libtorrent::entry(torrentStats.incomplete);
+
+    const QVector<const Peer *> peers = pickPeers(annonceReq.infoHash, annonceReq.numwant, annonceReq.peer.endpoint);
+    if (annonceReq.compact) {
+        std::string peers4;
+        std::string peers6;
+        peers4.reserve(peers.size() * 6);
+        for (const Peer *peer : peers)
+            appendCompact((peer->endpoint.isIPv4() ? peers4 : peers6), peer->endpoint);
+
+        replyDict["peers"] = libtorrent::entry(peers4);
+        if (!peers6.empty())
+            replyDict["peers6"] = libtorrent::entry(peers6);
+    }
+    else {
+        libtorrent::entry::list_type peerList;
+        for (const Peer *peer : peers)
+            peerList.push_back(toEntry(*peer, annonceReq.noPeerId));
+        replyDict["peers"] = libtorrent::entry(peerList);
+    }
 
     const libtorrent::entry replyEntry(replyDict);
     // bencode
     QByteArray reply;
     libtorrent::bencode(std::back_inserter(reply), replyEntry);
-    qDebug("Tracker: reply with the following bencoded data:\n %s", reply.constData());
 
     // HTTP reply
     print(reply, Http::CONTENT_TYPE_TXT);
 }
+
+void Tracker::readUdpDatagrams()
+{
+    char buffer[UDP_REQUEST_HEADER_SIZE + (UDP_MAX_SCRAPE_HASHES * 20)];
+
+    while (m_udpSocket->hasPendingDatagrams()) {
+        QHostAddress sender;
+        quint16 senderPort = 0;
+        const qint64 size = m_udpSocket->readDatagram(buffer, sizeof(buffer), &sender, &senderPort);
+        if (size < UDP_REQUEST_HEADER_SIZE) continue;
+
+        processUdpRequest(QByteArray::fromRawData(buffer, size), sender, senderPort);
+    }
+}
+
+quint64 Tracker::udpConnectionId(const PeerEndpoint &client, const qint64 timeSlot) const
+{
+    // Connection ids aren't stored, they are derived from the client endpoint,
+    // the time and a secret so a spoofed source address can't be used [BEP 15]
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(reinterpret_cast<const char *>(&m_udpSecret), sizeof(m_udpSecret));
+    hash.addData(reinterpret_cast<const char *>(client.address), sizeof(client.address));
+    hash.addData(reinterpret_cast<const char *>(&client.port), sizeof(client.port));
+    hash.addData(reinterpret_cast<const char *>(&timeSlot), sizeof(timeSlot));
+    return qFromBigEndian<quint64>(reinterpret_cast<const uchar *>(hash.result().constData()));
+}
+
+void Tracker::processUdpRequest(const QByteArray &data, const QHostAddress &sender, const quint16 senderPort)
+{
+    const quint64 connectionId = readBigEndian<quint64>(data, 0);
+    const qint32 action = readBigEndian<qint32>(data, 8);
+    const qint32 transactionId = readBigEndian<qint32>(data, 12);
+
+    const PeerEndpoint client = makeEndpoint(sender, senderPort);
+    const qint64 timeSlot = m_clock.elapsed() / UDP_CONNECTION_ID_LIFETIME;
+
+    if (action == UDP_ACTION_CONNECT) {
+        if (connectionId != UDP_PROTOCOL_ID) return;
+
+        QByteArray reply;
+        appendBigEndian(reply, UDP_ACTION_CONNECT);
+        appendBigEndian(reply, transactionId);
+        appendBigEndian(reply, udpConnectionId(client, timeSlot));
+        m_udpSocket->writeDatagram(reply, sender, senderPort);
+        return;
+    }
+
+    if ((connectionId != udpConnectionId(client, timeSlot))
+        && (connectionId != udpConnectionId(client, (timeSlot - 1)))) {
+        qDebug("Tracker: Invalid UDP connection id");
+        sendUdpError(transactionId, "Invalid connection id", sender, senderPort);
+        return;
+    }
+
+    switch (action) {
+    case UDP_ACTION_ANNOUNCE:
+        processUdpAnnounce(data, sender, senderPort);
+        break;
+    case UDP_ACTION_SCRAPE:
+        processUdpScrape(data, sender, senderPort);
+        break;
+    default:
+        sendUdpError(transactionId, "Invalid action", sender, senderPort);
+    }
+}
+
+void Tracker::processUdpAnnounce(const QByteArray &data, const QHostAddress &sender, const quint16 senderPort)
+{
+    const qint32 transactionId = readBigEndian<qint32>(data, 12);
+    if (data.size() < UDP_ANNOUNCE_REQUEST_SIZE) {
+        sendUdpError(transactionId, "Invalid announce request", sender, senderPort);
+        return;
+    }
+
+    TrackerAnnounceRequest annonceReq;
+    annonceReq.infoHash = data.mid(16, 20);
+    memcpy(annonceReq.peer.peerId, (data.constData() + 36), sizeof(annonceReq.peer.peerId));
+    annonceReq.peer.isSeed = (readBigEndian<qint64>(data, 64) == 0);
+    annonceReq.peer.endpoint = makeEndpoint(sender, readBigEndian<quint16>(data, 96));
+    annonceReq.peer.lastAnnounced = m_clock.elapsed() / 1000;
+
+    switch (readBigEndian<qint32>(data, 80)) {
+    case 1:
+        annonceReq.event = QLatin1String("completed");
+        break;
+    case 2:
+        annonceReq.event = QLatin1String("started");
+        break;
+    case 3:
+        annonceReq.event = QLatin1String("stopped");
+        break;
+    }
+
+    // the reply carries peers of the same address family as the client
+    const bool isIPv4 = annonceReq.peer.endpoint.isIPv4();
+    const int peerSize = isIPv4 ? 6 : 18;
+    const int maxNumwant = qMin(MAX_NUMWANT, ((UDP_MAX_REPLY_SIZE - 20) / peerSize));
+    const qint32 numwant = readBigEndian<qint32>(data, 92);
+    annonceReq.numwant = (numwant < 0) ? qMin(DEFAULT_NUMWANT, maxNumwant) : qMin<int>(numwant, maxNumwant);
+    annonceReq.noPeerId = true;
+    annonceReq.compact = true;
+
+    QVector<const Peer *> peers;
+    if (annonceReq.event == "stopped") {
+        unregisterPeer(annonceReq);
+    }
+    else {
+        registerPeer(annonceReq);
+        peers = pickPeers(annonceReq.infoHash, annonceReq.numwant, annonceReq.peer.endpoint
+            , (isIPv4 ? QAbstractSocket::IPv4Protocol : QAbstractSocket::IPv6Protocol));
+    }
+
+    ++m_announceCount;
+    const TrackerTorrentStats torrentStats = this->torrentStats(annonceReq.infoHash);
+
+    QByteArray reply;
+    reply.reserve(20 + (peers.size() * peerSize));
+    appendBigEndian(reply, UDP_ACTION_ANNOUNCE);
+    appendBigEndian(reply, transactionId);
+    appendBigEndian<qint32>(reply, ANNOUNCE_INTERVAL);
+    appendBigEndian<qint32>(reply, torrentStats.incomplete);
+    appendBigEndian<qint32>(reply, torrentStats.complete);
+    for (const Peer *peer : qAsConst(peers))
+        appendCompact(reply, peer->endpoint);
+
+    m_udpSocket->writeDatagram(reply, sender, senderPort);
+}
+
+void Tracker::processUdpScrape(const QByteArray &data, const QHostAddress &sender, const quint16 senderPort)
+{
+    const qint32 transactionId = readBigEndian<qint32>(data, 12);
+    const int hashCount = qMin(((data.size() - UDP_REQUEST_HEADER_SIZE) / 20), UDP_MAX_SCRAPE_HASHES);
+    ++m_scrapeCount;
+
+    QByteArray reply;
+    reply.reserve(8 + (hashCount * 12));
+    appendBigEndian(reply, UDP_ACTION_SCRAPE);
+    appendBigEndian(reply, transactionId);
+    for (int i = 0; i < hashCount; ++i) {
+        const QByteArray infoHash = QByteArray::fromRawData((data.constData() + UDP_REQUEST_HEADER_SIZE + (i * 20)), 20);
+        const TrackerTorrentStats torrentStats = this->torrentStats(infoHash);
+
+        appendBigEndian<qint32>(reply, torrentStats.complete);
+        appendBigEndian<qint32>(reply, torrentStats.downloaded);
+        appendBigEndian<qint32>(reply, torrentStats.incomplete);
+    }
+
+    m_udpSocket->writeDatagram(reply, sender, senderPort);
+}
+
+void Tracker::sendUdpError(const qint32 transactionId, const QByteArray &message, const QHostAddress &receiver, const quint16 receiverPort)
+{
+    QByteArray reply;
+    appendBigEndian(reply, UDP_ACTION_ERROR);
+    appendBigEndian(reply, transactionId);
+    reply.append(message);
+
+    m_udpSocket->writeDatagram(reply, receiver, receiverPort);
+}
@@ -30,17 +30,17 @@
 #ifndef BITTORRENT_TRACKER_H
 #define BITTORRENT_TRACKER_H
 
+#include <QElapsedTimer>
 #include <QHash>
+#include <QHostAddress>
 #include <QObject>
+#include <QVector>
 
 #include "base/http/irequesthandler.h"
 #include "base/http/responsebuilder.h"
 #include "base/http/types.h"
 
-namespace libtorrent
-{
-    class entry;
-}
+class QUdpSocket;
 
 namespace Http
 {
@@ -49,16 +49,26 @@ namespace Http
 
 namespace BitTorrent
 {
+    // IPv4 addresses are stored as IPv4-mapped IPv6 addresses
+    struct PeerEndpoint
+    {
+        quint8 address[16];
+        quint16 port;
+
+        bool isIPv4() const;
+        QHostAddress hostAddress() const;
+    };
+
+    bool operator==(const PeerEndpoint &left, const PeerEndpoint &right);
+    bool operator!=(const PeerEndpoint &left, const PeerEndpoint &right);
+    uint qHash(const PeerEndpoint &key, uint seed = 0);
+
     struct Peer
     {
-        QString ip;
-        QByteArray peerId;
-        int port;
-
-        bool operator!=(const Peer &other) const;
-        bool operator==(const Peer &other) const;
-        QString uid() const;
-        libtorrent::entry toEntry(bool noPeerId) const;
+        PeerEndpoint endpoint;
+        char peerId[20];
+        int lastAnnounced;  // seconds since the tracker was created
+        bool isSeed;
     };
 
     struct TrackerAnnounceRequest
@@ -69,13 +79,39 @@ namespace BitTorrent
         Peer peer;
         // Extensions
         bool noPeerId;
+        bool compact;
+    };
+
+    // Peers are packed in a vector and indexed by their endpoint
+    struct PeerList
+    {
+        QVector<Peer> peers;
+        QHash<PeerEndpoint, int> indexes;
+        int seeders = 0;
     };
 
-    typedef QHash<QString, Peer> PeerList;
     typedef QHash<QByteArray, PeerList> TorrentList;
 
+    struct TrackerTorrentStats
+    {
+        int complete;  // seeders
+        int incomplete;  // leechers
+        int downloaded;
+    };
+
+    struct TrackerStats
+    {
+        int torrents;
+        int peers;
+        int seeders;
+        int downloaded;
+        qint64 announces;
+        qint64 scrapes;
+    };
+
     /* Basic Bittorrent tracker implementation in Qt */
     /* Following http://wiki.theory.org/BitTorrent_Tracker_Protocol */
+    /* and the UDP tracker protocol [BEP 15] on the same port */
     class Tracker : public QObject, public Http::IRequestHandler, private Http::ResponseBuilder
     {
         Q_OBJECT
@@ -88,14 +124,43 @@ namespace BitTorrent
         bool start();
         Http::Response processRequest(const Http::Request &request, const Http::Environment &env);
 
+        TrackerStats stats() const;
+        QHash<QByteArray, TrackerTorrentStats> torrentStats() const;
+
+    private slots:
+        void removeExpiredPeers();
+        void readUdpDatagrams();
+
     private:
         void respondToAnnounceRequest();
+        void respondToScrapeRequest();
         void registerPeer(const TrackerAnnounceRequest &annonceReq);
         void unregisterPeer(const TrackerAnnounceRequest &annonceReq);
         void replyWithPeerList(const TrackerAnnounceRequest &annonceReq);
+        void removePeerAt(PeerList &peerList, int index);
+        TrackerTorrentStats torrentStats(const QByteArray &infoHash) const;
+        // picks up to `count` random peers of the torrent and of the given address family, except `self`
+        QVector<const Peer *> pickPeers(const QByteArray &infoHash, int count, const PeerEndpoint &self
+            , QAbstractSocket::NetworkLayerProtocol protocol = QAbstractSocket::AnyIPProtocol) const;
+
+        void processUdpRequest(const QByteArray &data, const QHostAddress &sender, quint16 senderPort);
+        void processUdpAnnounce(const QByteArray &data, const QHostAddress &sender, quint16 senderPort);
+        void processUdpScrape(const QByteArray &data, const QHostAddress &sender, quint16 senderPort);
+        void sendUdpError(qint32 transactionId, const QByteArray &message, const QHostAddress &receiver, quint16 receiverPort);
+        quint64 udpConnectionId(const PeerEndpoint &client, qint64 timeSlot) const;
 
         Http::Server *m_server;
+        QUdpSocket *m_udpSocket;
+        quint64 m_udpSecret;
         TorrentList m_torrents;
+        // "completed" events by torrent, kept when the torrent has no peers any more
+        QHash<QByteArray, int> m_completedCounts;
+        int m_peerCount;
+        int m_seederCount;
+        int m_downloadedCount;
+        qint64 m_announceCount;
+        qint64 m_scrapeCount;
+        QElapsedTimer m_clock;
 
         Http::Request m_request;
         Http::Environment m_env;
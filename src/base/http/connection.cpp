@@ -34,16 +34,17 @@
 #include <QTcpSocket>
 
 #include "base/logger.h"
-#include "irequesthandler.h"
 #include "requestparser.h"
 #include "responsegenerator.h"
 
 using namespace Http;
 
-Connection::Connection(QTcpSocket *socket, IRequestHandler *requestHandler, QObject *parent)
+Connection::Connection(QTcpSocket *socket, QObject *parent)
     : QObject(parent)
     , m_socket(socket)
-    , m_requestHandler(requestHandler)
+    , m_frameOffset(0)
+    , m_isProcessing(false)
+    , m_acceptsGzip(false)
 {
     m_socket->setParent(this);
     m_idleTimer.start();
@@ -60,21 +61,43 @@ void Connection::read()
     m_idleTimer.restart();
     m_receivedData.append(m_socket->readAll());
 
-    while (!m_receivedData.isEmpty()) {
-        const RequestParser::ParseResult result = RequestParser::parse(m_receivedData);
+    // data keeps arriving while a request is processed, so the limit applies to everything not parsed yet
+    const long bufferLimit = RequestParser::MAX_CONTENT_SIZE * 1.1;  // some margin for headers
+    if ((m_receivedData.size() - m_frameOffset) > bufferLimit) {
+        Logger::instance()->addMessage(tr("Http request size exceeds limiation, closing socket. Limit: %ld, IP: %s")
+            .arg(bufferLimit).arg(m_socket->peerAddress().toString()), Log::WARNING);
+
+        Response resp(413, "Payload Too Large");
+        resp.headers[HEADER_CONNECTION] = "close";
+
+        sendResponse(resp);
+        m_socket->close();
+        m_receivedData.clear();
+        m_frameOffset = 0;
+        return;
+    }
+
+    processReceivedData();
+}
+
+void Connection::processReceivedData()
+{
+    // pipelined requests are parsed once the response to the current one is sent
+    while (!m_isProcessing && (m_frameOffset < m_receivedData.size())) {
+        const RequestParser::ParseResult result = m_requestParser.parse(m_receivedData, m_frameOffset);
 
         switch (result.status) {
         case RequestParser::ParseStatus::Incomplete: {
-                const long bufferLimit = RequestParser::MAX_CONTENT_SIZE * 1.1;  // some margin for headers
-                if (m_receivedData.size() > bufferLimit) {
-                    Logger::instance()->addMessage(tr("Http request size exceeds limiation, closing socket. Limit: %ld, IP: %s")
-                        .arg(bufferLimit).arg(m_socket->peerAddress().toString()), Log::WARNING);
-
-                    Response resp(413, "Payload Too Large");
-                    resp.headers[HEADER_CONNECTION] = "close";
+                // drop the frames handled so far, only the partial frame is moved
+                if (m_frameOffset > 0) {
+                    m_receivedData.remove(0, m_frameOffset);
+                    m_frameOffset = 0;
+                }
 
-                    sendResponse(resp);
-                    m_socket->close();
+                // the buffer size is limited by read()
+                if (result.frameSize > m_receivedData.capacity()) {
+                    // the size of the message body is known, avoid growing the buffer in steps
+                    m_receivedData.reserve(result.frameSize);
                 }
             }
             return;
@@ -94,15 +117,15 @@ void Connection::read()
         case RequestParser::ParseStatus::OK: {
                 const Environment env {m_socket->localAddress(), m_socket->localPort(), m_socket->peerAddress(), m_socket->peerPort()};
 
-                Response resp = m_requestHandler->processRequest(result.request, env);
-
-                if (acceptsGzipEncoding(result.request.headers["accept-encoding"]))
-                    resp.headers[HEADER_CONTENT_ENCODING] = "gzip";
-
-                resp.headers[HEADER_CONNECTION] = "keep-alive";
+                m_acceptsGzip = acceptsGzipEncoding(result.request.headers[HEADER_ACCEPT_ENCODING]);
+                m_frameOffset += result.frameSize;
+                if (m_frameOffset == m_receivedData.size()) {
+                    m_receivedData.clear();
+                    m_frameOffset = 0;
+                }
 
-                sendResponse(resp);
-                m_receivedData = m_receivedData.mid(result.frameSize);
+                m_isProcessing = true;
+                emit requestReady(result.request, env);
             }
             break;
 
@@ -113,6 +136,30 @@ void Connection::read()
     }
 }
 
+void Connection::handleResponse(const Response &response)
+{
+    m_idleTimer.restart();
+
+    Response resp = response;
+    // the content is compressed here, in the connection's thread,
+    // unless the request handler did provide already encoded content
+    // or marked it as final ("identity", which isn't sent)
+    if (resp.headers.value(HEADER_CONTENT_ENCODING) == QLatin1String("identity")) {
+        resp.headers.remove(HEADER_CONTENT_ENCODING);
+    }
+    else if (m_acceptsGzip && !resp.headers.contains(HEADER_CONTENT_ENCODING)) {
+        resp.headers[HEADER_CONTENT_ENCODING] = "gzip";
+        compressContent(resp);
+    }
+
+    resp.headers[HEADER_CONNECTION] = "keep-alive";
+
+    sendResponse(resp);
+    m_isProcessing = false;
+
+    processReceivedData();
+}
+
 void Connection::sendResponse(const Response &response) const
 {
     m_socket->write(toByteArray(response));
@@ -128,44 +175,7 @@ bool Connection::isClosed() const
     return (m_socket->state() == QAbstractSocket::UnconnectedState);
 }
 
-bool Connection::acceptsGzipEncoding(QString codings)
+bool Connection::isProcessing() const
 {
-    // [rfc7231] 5.3.4. Accept-Encoding
-
-    const auto isCodingAvailable = [](const QStringList &list, const QString &encoding) -> bool
-    {
-        foreach (const QString &str, list) {
-            if (!str.startsWith(encoding))
-                continue;
-
-            // without quality values
-            if (str == encoding)
-                return true;
-
-            // [rfc7231] 5.3.1. Quality Values
-            const QStringRef substr = str.midRef(encoding.size() + 3);  // ex. skip over "gzip;q="
-
-            bool ok = false;
-            const double qvalue = substr.toDouble(&ok);
-            if (!ok || (qvalue <= 0.0))
-                return false;
-
-            return true;
-        }
-        return false;
-    };
-
-    const QStringList list = codings.remove(' ').remove('\t').split(',', QString::SkipEmptyParts);
-    if (list.isEmpty())
-        return false;
-
-    const bool canGzip = isCodingAvailable(list, QLatin1String("gzip"));
-    if (canGzip)
-        return true;
-
-    const bool canAny = isCodingAvailable(list, QLatin1String("*"));
-    if (canAny)
-        return true;
-
-    return false;
+    return m_isProcessing;
 }
@@ -34,37 +34,47 @@
 #include <QElapsedTimer>
 #include <QObject>
 
+#include "requestparser.h"
 #include "types.h"
 
 class QTcpSocket;
 
 namespace Http
 {
-    class IRequestHandler;
-
     class Connection : public QObject
     {
         Q_OBJECT
         Q_DISABLE_COPY(Connection)
 
     public:
-        Connection(QTcpSocket *socket, IRequestHandler *requestHandler, QObject *parent = nullptr);
+        Connection(QTcpSocket *socket, QObject *parent = nullptr);
         ~Connection();
 
         bool hasExpired(qint64 timeout) const;
         bool isClosed() const;
+        // true while waiting for the response to the last emitted request
+        bool isProcessing() const;
+
+    public slots:
+        void handleResponse(const Http::Response &response);
+
+    signals:
+        void requestReady(const Http::Request &request, const Http::Environment &env);
 
     private slots:
         void read();
 
     private:
-        static bool acceptsGzipEncoding(QString codings);
+        void processReceivedData();
         void sendResponse(const Response &response) const;
 
         QTcpSocket *m_socket;
-        IRequestHandler *m_requestHandler;
         QByteArray m_receivedData;
+        int m_frameOffset;  // start of the first unhandled request in `m_receivedData`
+        RequestParser m_requestParser;
         QElapsedTimer m_idleTimer;
+        bool m_isProcessing;
+        bool m_acceptsGzip;
     };
 }
 
@@ -30,8 +30,10 @@
 
 #include "requestparser.h"
 
+#include <algorithm>
+#include <utility>
+
 #include <QDebug>
-#include <QRegularExpression>
 #include <QStringList>
 #include <QUrl>
 #include <QUrlQuery>
@@ -54,7 +56,21 @@ namespace
         return in;
     }
 
-    bool parseHeaderLine(const QString &line, QStringMap &out)
+    bool isLinearWhiteSpace(const char c)
+    {
+        return ((c == ' ') || (c == '\t'));
+    }
+
+    QByteArray trimmedView(const char *begin, const char *end)
+    {
+        while ((begin < end) && isLinearWhiteSpace(*begin))
+            ++begin;
+        while ((begin < end) && isLinearWhiteSpace(*(end - 1)))
+            --end;
+        return QByteArray::fromRawData(begin, (end - begin));
+    }
+
+    bool parseHeaderLine(const QByteArray &line, QStringMap &out)
     {
         // [rfc7230] 3.2. Header Fields
         const int i = line.indexOf(':');
@@ -63,8 +79,9 @@ namespace
             return false;
         }
 
-        const QString name = line.leftRef(i).trimmed().toString().toLower();
-        const QString value = line.midRef(i + 1).trimmed().toString();
+        const char *begin = line.constData();
+        const QString name = QString::fromLatin1(trimmedView(begin, (begin + i))).toLower();
+        const QString value = QString::fromLatin1(trimmedView((begin + i + 1), (begin + line.size())));
         out[name] = value;
 
         return true;
@@ -73,81 +90,124 @@ namespace
 
 RequestParser::RequestParser()
 {
+    reset();
 }
 
-RequestParser::ParseResult RequestParser::parse(const QByteArray &data)
+void RequestParser::reset()
+{
+    m_state = State::Header;
+    m_scannedSize = 0;
+    m_headerLength = 0;
+    m_contentLength = 0;
+    m_request = Request();
+}
+
+RequestParser::ParseResult RequestParser::parse(const QByteArray &data, const int offset)
 {
     // Warning! Header names are converted to lowercase
-    return RequestParser().doParse(data);
+    if (m_state == State::Header)
+        return parseHeader(data, offset);
+    return parseBody(data, offset);
 }
 
-RequestParser::ParseResult RequestParser::doParse(const QByteArray &data)
+RequestParser::ParseResult RequestParser::finish(const long frameSize)
+{
+    const ParseResult result {ParseStatus::OK, std::move(m_request), frameSize};
+    reset();
+    return result;
+}
+
+RequestParser::ParseResult RequestParser::fail()
+{
+    reset();
+    return {ParseStatus::BadRequest, Request(), 0};
+}
+
+RequestParser::ParseResult RequestParser::parseHeader(const QByteArray &data, const int offset)
 {
     // we don't handle malformed requests which use double `LF` as delimiter
-    const int headerEnd = data.indexOf(EOH);
-    if (headerEnd < 0) {
+    // resume the search where the previous one stopped, the delimiter may have been cut in half
+    const int searchFrom = qMax(0, (m_scannedSize - EOH.size() + 1));
+    const int eohPos = data.indexOf(EOH, (offset + searchFrom));
+    if (eohPos < 0) {
         qDebug() << Q_FUNC_INFO << "incomplete request";
+        m_scannedSize = data.size() - offset;
         return {ParseStatus::Incomplete, Request(), 0};
     }
 
-    const QString httpHeaders = QString::fromLatin1(data.constData(), headerEnd);
-    if (!parseStartLines(httpHeaders)) {
+    const char *frame = data.constData() + offset;
+    const int headerEnd = eohPos - offset;
+    if (!parseStartLines(frame, (frame + headerEnd))) {
         qWarning() << Q_FUNC_INFO << "header parsing error";
-        return {ParseStatus::BadRequest, Request(), 0};
+        return fail();
     }
 
-    const int headerLength = headerEnd + EOH.length();
+    m_headerLength = headerEnd + EOH.length();
 
     // handle supported methods
     if ((m_request.method == HEADER_REQUEST_METHOD_GET) || (m_request.method == HEADER_REQUEST_METHOD_HEAD))
-        return {ParseStatus::OK, m_request, headerLength};
+        return finish(m_headerLength);
     if (m_request.method == HEADER_REQUEST_METHOD_POST) {
         bool ok = false;
-        const int contentLength = m_request.headers[HEADER_CONTENT_LENGTH].toInt(&ok);
-        if (!ok || (contentLength < 0)) {
+        m_contentLength = m_request.headers[HEADER_CONTENT_LENGTH].toInt(&ok);
+        if (!ok || (m_contentLength < 0)) {
             qWarning() << Q_FUNC_INFO << "bad request: content-length invalid";
-            return {ParseStatus::BadRequest, Request(), 0};
+            return fail();
         }
-        if (contentLength > MAX_CONTENT_SIZE) {
+        if (m_contentLength > MAX_CONTENT_SIZE) {
             qWarning() << Q_FUNC_INFO << "bad request: message too long";
-            return {ParseStatus::BadRequest, Request(), 0};
+            return fail();
         }
 
-        if (contentLength > 0) {
-            const QByteArray httpBodyView = midView(data, headerLength, contentLength);
-            if (httpBodyView.length() < contentLength) {
-                qDebug() << Q_FUNC_INFO << "incomplete request";
-                return {ParseStatus::Incomplete, Request(), 0};
-            }
+        m_state = State::Body;
+        return parseBody(data, offset);
+    }
 
-            if (!parsePostMessage(httpBodyView)) {
-                qWarning() << Q_FUNC_INFO << "message body parsing error";
-                return {ParseStatus::BadRequest, Request(), 0};
-            }
-        }
+    qWarning() << Q_FUNC_INFO << "unsupported request method: " << m_request.method;
+    return fail();  // TODO: SHOULD respond "501 Not Implemented"
+}
 
-        return {ParseStatus::OK, m_request, (headerLength + contentLength)};
+RequestParser::ParseResult RequestParser::parseBody(const QByteArray &data, const int offset)
+{
+    const long frameSize = m_headerLength + m_contentLength;
+    if ((data.size() - offset) < frameSize) {
+        qDebug() << Q_FUNC_INFO << "incomplete request";
+        return {ParseStatus::Incomplete, Request(), frameSize};
     }
 
-    qWarning() << Q_FUNC_INFO << "unsupported request method: " << m_request.method;
-    return {ParseStatus::BadRequest, Request(), 0};  // TODO: SHOULD respond "501 Not Implemented"
+    if (m_contentLength > 0) {
+        const QByteArray httpBodyView = QByteArray::fromRawData((data.constData() + offset + m_headerLength), m_contentLength);
+        if (!parsePostMessage(httpBodyView)) {
+            qWarning() << Q_FUNC_INFO << "message body parsing error";
+            return fail();
+        }
+    }
+
+    return finish(frameSize);
 }
 
-bool RequestParser::parseStartLines(const QString &data)
+bool RequestParser::parseStartLines(const char *begin, const char *end)
 {
     // we don't handle malformed request which uses `LF` for newline
-    const QVector<QStringRef> lines = data.splitRef(CRLF, QString::SkipEmptyParts);
+    // lines are kept as views into the receive buffer, only folded lines are copied
 
     // [rfc7230] 3.2.2. Field Order
-    QStringList requestLines;
-    for (const auto &line : lines) {
-        if (line.at(0).isSpace() && !requestLines.isEmpty()) {
-            // continuation of previous line
-            requestLines.last() += line.toString();
-        }
-        else {
-            requestLines += line.toString();
+    QVector<QByteArray> requestLines;
+    const char *lineBegin = begin;
+    while (lineBegin < end) {
+        const char *lineEnd = std::search(lineBegin, end, CRLF, (CRLF + 2));
+        if (lineEnd != lineBegin) {
+            const QByteArray line = QByteArray::fromRawData(lineBegin, (lineEnd - lineBegin));
+            if (isLinearWhiteSpace(line[0]) && !requestLines.isEmpty()) {
+                // continuation of previous line
+                requestLines.last() += line;
+            }
+            else {
+                requestLines += line;
+            }
         }
+
+        lineBegin = (lineEnd == end) ? end : (lineEnd + 2);
     }
 
     if (requestLines.isEmpty())
@@ -156,7 +216,7 @@ bool RequestParser::parseStartLines(const QString &data)
     if (!parseRequestLine(requestLines[0]))
         return false;
 
-    for (auto i = ++(requestLines.begin()); i != requestLines.end(); ++i) {
+    for (auto i = ++(requestLines.cbegin()); i != requestLines.cend(); ++i) {
         if (!parseHeaderLine(*i, m_request.headers))
             return false;
     }
@@ -164,30 +224,53 @@ bool RequestParser::parseStartLines(const QString &data)
     return true;
 }
 
-bool RequestParser::parseRequestLine(const QString &line)
+bool RequestParser::parseRequestLine(const QByteArray &line)
 {
     // [rfc7230] 3.1.1. Request Line
+    // method SP request-target SP HTTP-version
+
+    const char *const begin = line.constData();
+    const char *const end = begin + line.size();
+    const auto isSpace = [](const char c) { return ((c == ' ') || (c == '\t') || (c == '\v') || (c == '\f')); };
+    const auto isDigit = [](const char c) { return ((c >= '0') && (c <= '9')); };
+
+    // Request Methods
+    const char *methodEnd = begin;
+    while ((methodEnd < end) && (*methodEnd >= 'A') && (*methodEnd <= 'Z'))
+        ++methodEnd;
 
-    const QRegularExpression re(QLatin1String("^([A-Z]+)\\s+(\\S+)\\s+HTTP\\/(\\d\\.\\d)$"));
-    const QRegularExpressionMatch match = re.match(line);
+    // Request Target
+    const char *targetBegin = methodEnd;
+    while ((targetBegin < end) && isSpace(*targetBegin))
+        ++targetBegin;
+    const char *targetEnd = targetBegin;
+    while ((targetEnd < end) && !isSpace(*targetEnd))
+        ++targetEnd;
 
-    if (!match.hasMatch()) {
+    // HTTP-version
+    const char *versionBegin = targetEnd;
+    while ((versionBegin < end) && isSpace(*versionBegin))
+        ++versionBegin;
+    const QByteArray version = QByteArray::fromRawData(versionBegin, (end - versionBegin));
+
+    const bool isValid = (methodEnd != begin) && (targetBegin != methodEnd)
+        && (targetEnd != targetBegin) && (versionBegin != targetEnd)
+        && (version.size() == 8) && version.startsWith("HTTP/")
+        && isDigit(version[5]) && (version[6] == '.') && isDigit(version[7]);
+    if (!isValid) {
         qWarning() << Q_FUNC_INFO << "invalid http header:" << line;
         return false;
     }
 
-    // Request Methods
-    m_request.method = match.captured(1);
+    m_request.method = QString::fromLatin1(begin, (methodEnd - begin));
 
-    // Request Target
-    const QByteArray decodedUrl {QByteArray::fromPercentEncoding(match.captured(2).toLatin1())};
+    const QByteArray decodedUrl {QByteArray::fromPercentEncoding(QByteArray::fromRawData(targetBegin, (targetEnd - targetBegin)))};
     const int sepPos = decodedUrl.indexOf('?');
     m_request.path = QString::fromUtf8(decodedUrl.constData(), (sepPos == -1 ? decodedUrl.size() : sepPos));
     if (sepPos >= 0)
         m_request.query = decodedUrl.mid(sepPos + 1);
 
-    // HTTP-version
-    m_request.version = match.captured(3);
+    m_request.version = QString::fromLatin1(version.constData() + 5, 3);
 
     return true;
 }
@@ -260,15 +343,15 @@ bool RequestParser::parseFormData(const QByteArray &data)
         return false;
     }
 
-    const QString headers = QString::fromLatin1(list[0]);
     const QByteArray payload = viewWithoutEndingWith(list[1], CRLF);
 
     QStringMap headersMap;
-    const QVector<QStringRef> headerLines = headers.splitRef(CRLF, QString::SkipEmptyParts);
+    const QList<QByteArray> headerLines = splitToViews(list[0], CRLF, QString::SkipEmptyParts);
     for (const auto &line : headerLines) {
-        if (line.trimmed().startsWith(HEADER_CONTENT_DISPOSITION, Qt::CaseInsensitive)) {
+        if (line.trimmed().toLower().startsWith(HEADER_CONTENT_DISPOSITION)) {
             // extract out filename & name
-            const QVector<QStringRef> directives = line.split(';', QString::SkipEmptyParts);
+            const QString disposition = QString::fromLatin1(line);
+            const QVector<QStringRef> directives = disposition.splitRef(';', QString::SkipEmptyParts);
 
             for (const auto &directive : directives) {
                 const int idx = directive.indexOf('=');
@@ -281,7 +364,7 @@ bool RequestParser::parseFormData(const QByteArray &data)
             }
         }
         else {
-            if (!parseHeaderLine(line.toString(), headersMap))
+            if (!parseHeaderLine(line, headersMap))
                 return false;
         }
     }
@@ -291,7 +374,8 @@ bool RequestParser::parseFormData(const QByteArray &data)
     const QLatin1String name("name");
 
     if (headersMap.contains(filename)) {
-        m_request.files.append({filename, headersMap[HEADER_CONTENT_TYPE], payload});
+        // `payload` is a view into the receive buffer which doesn't outlive the request
+        m_request.files.append({filename, headersMap[HEADER_CONTENT_TYPE], QByteArray(payload.constData(), payload.size())});
     }
     else if (headersMap.contains(name)) {
         m_request.posts[headersMap[name]] = payload;
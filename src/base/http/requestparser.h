@@ -35,6 +35,9 @@
 
 namespace Http
 {
+    // Incremental request parser. A partially received request is not scanned again
+    // from the start on each read: the parser remembers how far it got and, once the
+    // headers are parsed, only waits for the rest of the message body.
     class RequestParser
     {
     public:
@@ -47,26 +50,46 @@ namespace Http
 
         struct ParseResult
         {
-            // when `status != ParseStatus::OK`, `request` & `frameSize` are undefined
+            // when `status != ParseStatus::OK`, `request` is undefined
+            // when `status == ParseStatus::Incomplete`, `frameSize` is the expected frame size if known, otherwise 0
             ParseStatus status;
             Request request;
             long frameSize;  // http request frame size (bytes)
         };
 
-        static ParseResult parse(const QByteArray &data);
+        RequestParser();
+
+        // Parses the request frame starting at `offset` in `data`.
+        // While `Incomplete` is returned the frame must be passed again after more data is
+        // appended to it (the data before the frame may be dropped in the meantime).
+        // Any other result resets the parser so it's ready for the next frame.
+        ParseResult parse(const QByteArray &data, int offset = 0);
+        void reset();
 
         static const long MAX_CONTENT_SIZE = 64 * 1024 * 1024;  // 64 MB
 
     private:
-        RequestParser();
+        enum class State
+        {
+            Header,
+            Body
+        };
+
+        ParseResult parseHeader(const QByteArray &data, int offset);
+        ParseResult parseBody(const QByteArray &data, int offset);
+        ParseResult finish(long frameSize);
+        ParseResult fail();
 
-        ParseResult doParse(const QByteArray &data);
-        bool parseStartLines(const QString &data);
-        bool parseRequestLine(const QString &line);
+        bool parseStartLines(const char *begin, const char *end);
+        bool parseRequestLine(const QByteArray &line);
 
         bool parsePostMessage(const QByteArray &data);
         bool parseFormData(const QByteArray &data);
 
+        State m_state;
+        int m_scannedSize;  // bytes of the frame already searched for the end of headers
+        int m_headerLength;
+        int m_contentLength;
         Request m_request;
     };
 }
@@ -30,13 +30,12 @@
 #include "responsegenerator.h"
 
 #include <QDateTime>
+#include <QStringList>
 
 #include "base/utils/gzip.h"
 
 QByteArray Http::toByteArray(Response response)
 {
-    compressContent(response);
-
     response.headers[HEADER_CONTENT_LENGTH] = QString::number(response.content.length());
     response.headers[HEADER_DATE] = httpDate();
 
@@ -103,3 +102,45 @@ void Http::compressContent(Response &response)
     response.content = compressedData;
     response.headers[HEADER_CONTENT_ENCODING] = QLatin1String("gzip");
 }
+
+bool Http::acceptsGzipEncoding(QString codings)
+{
+    // [rfc7231] 5.3.4. Accept-Encoding
+
+    const auto isCodingAvailable = [](const QStringList &list, const QString &encoding) -> bool
+    {
+        foreach (const QString &str, list) {
+            if (!str.startsWith(encoding))
+                continue;
+
+            // without quality values
+            if (str == encoding)
+                return true;
+
+            // [rfc7231] 5.3.1. Quality Values
+            const QStringRef substr = str.midRef(encoding.size() + 3);  // ex. skip over "gzip;q="
+
+            bool ok = false;
+            const double qvalue = substr.toDouble(&ok);
+            if (!ok || (qvalue <= 0.0))
+                return false;
+
+            return true;
+        }
+        return false;
+    };
+
+    const QStringList list = codings.remove(' ').remove('\t').split(',', QString::SkipEmptyParts);
+    if (list.isEmpty())
+        return false;
+
+    const bool canGzip = isCodingAvailable(list, QLatin1String("gzip"));
+    if (canGzip)
+        return true;
+
+    const bool canAny = isCodingAvailable(list, QLatin1String("*"));
+    if (canAny)
+        return true;
+
+    return false;
+}
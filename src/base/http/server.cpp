@@ -30,60 +30,95 @@
 
 #include "server.h"
 
-#include <QMutableListIterator>
+#include <QMetaObject>
 #include <QNetworkProxy>
 #include <QStringList>
-#include <QTimer>
+#include <QThread>
 #ifndef QT_NO_OPENSSL
 #include <QSslSocket>
 #else
 #include <QTcpSocket>
 #endif
 
+#include "base/global.h"
 #include "connection.h"
+#include "irequesthandler.h"
+#include "serverworker.h"
 
-static const int KEEP_ALIVE_DURATION = 7 * 1000;  // milliseconds
 static const int CONNECTIONS_LIMIT = 500;
-static const int CONNECTIONS_SCAN_INTERVAL = 2;  // seconds
+static const int MAX_WORKER_THREADS = 4;
 
 using namespace Http;
 
 Server::Server(IRequestHandler *requestHandler, QObject *parent)
     : QTcpServer(parent)
     , m_requestHandler(requestHandler)
+    , m_nextWorker(0)
+    , m_connectionCount(0)
 #ifndef QT_NO_OPENSSL
     , m_https(false)
 #endif
 {
+    qRegisterMetaType<Http::Environment>("Http::Environment");
+    qRegisterMetaType<Http::Request>("Http::Request");
+    qRegisterMetaType<Http::Response>("Http::Response");
+
     setProxy(QNetworkProxy::NoProxy);
 #ifndef QT_NO_OPENSSL
     QSslSocket::setDefaultCiphers(safeCipherList());
 #endif
 
-    QTimer *dropConnectionTimer = new QTimer(this);
-    connect(dropConnectionTimer, &QTimer::timeout, this, &Server::dropTimedOutConnection);
-    dropConnectionTimer->start(CONNECTIONS_SCAN_INTERVAL * 1000);
+    const int threadCount = qBound(1, QThread::idealThreadCount(), MAX_WORKER_THREADS);
+    for (int i = 0; i < threadCount; ++i) {
+        QThread *thread = new QThread(this);
+        ServerWorker *worker = new ServerWorker(this);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+        thread->start();
+
+        m_workerThreads.append(thread);
+        m_workers.append(worker);
+    }
 }
 
 Server::~Server()
 {
+    close();
+
+    // workers are destroyed in their own threads once those are finished
+    for (QThread *thread : qAsConst(m_workerThreads))
+        thread->quit();
+    for (QThread *thread : qAsConst(m_workerThreads))
+        thread->wait();
 }
 
 void Server::incomingConnection(qintptr socketDescriptor)
 {
-    if (m_connections.size() >= CONNECTIONS_LIMIT) return;
+    if (m_connectionCount.load() >= CONNECTIONS_LIMIT) return;
+
+    m_connectionCount.ref();
 
+    ServerWorker *worker = m_workers[m_nextWorker];
+    m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+    QMetaObject::invokeMethod(worker, "addConnection", Qt::QueuedConnection
+                              , Q_ARG(qint64, socketDescriptor));
+}
+
+QTcpSocket *Server::createSocket(const qintptr socketDescriptor)
+{
     QTcpSocket *serverSocket;
 #ifndef QT_NO_OPENSSL
+    QMutexLocker locker(&m_httpsMutex);
+
     if (m_https)
-        serverSocket = new QSslSocket(this);
+        serverSocket = new QSslSocket;
     else
 #endif
-        serverSocket = new QTcpSocket(this);
+        serverSocket = new QTcpSocket;
 
     if (!serverSocket->setSocketDescriptor(socketDescriptor)) {
         delete serverSocket;
-        return;
+        return nullptr;
     }
 
 #ifndef QT_NO_OPENSSL
@@ -96,20 +131,16 @@ void Server::incomingConnection(qintptr socketDescriptor)
     }
 #endif
 
-    Connection *c = new Connection(serverSocket, m_requestHandler, this);
-    m_connections.append(c);
+    return serverSocket;
 }
 
-void Server::dropTimedOutConnection()
+void Server::handleRequest(Connection *connection, const Request &request, const Environment &env)
 {
-    QMutableListIterator<Connection *> i(m_connections);
-    while (i.hasNext()) {
-        auto connection = i.next();
-        if (connection->isClosed() || connection->hasExpired(KEEP_ALIVE_DURATION)) {
-            delete connection;
-            i.remove();
-        }
-    }
+    // `connection` lives in a worker thread, it's only used as the target of a queued call here.
+    // Workers don't delete connections while they are waiting for a response.
+    const Response response = m_requestHandler->processRequest(request, env);
+    QMetaObject::invokeMethod(connection, "handleResponse", Qt::QueuedConnection
+                              , Q_ARG(Http::Response, response));
 }
 
 #ifndef QT_NO_OPENSSL
@@ -123,6 +154,7 @@ bool Server::setupHttps(const QByteArray &certificates, const QByteArray &key)
     const bool areCertsValid = !certs.empty() && std::all_of(certs.begin(), certs.end(), [](const QSslCertificate &c) { return !c.isNull(); });
 
     if (!sslKey.isNull() && areCertsValid) {
+        QMutexLocker locker(&m_httpsMutex);
         m_key = sslKey;
         m_certificates = certs;
         m_https = true;
@@ -136,6 +168,7 @@ bool Server::setupHttps(const QByteArray &certificates, const QByteArray &key)
 
 void Server::disableHttps()
 {
+    QMutexLocker locker(&m_httpsMutex);
     m_https = false;
     m_certificates.clear();
     m_key.clear();
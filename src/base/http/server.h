@@ -31,7 +31,10 @@
 #ifndef HTTP_SERVER_H
 #define HTTP_SERVER_H
 
+#include <QAtomicInt>
+#include <QMutex>
 #include <QTcpServer>
+#include <QVector>
 
 #ifndef QT_NO_OPENSSL
 #include <QSslCertificate>
@@ -39,16 +42,26 @@
 #include <QSslKey>
 #endif
 
+#include "types.h"
+
+class QThread;
+
 namespace Http
 {
     class IRequestHandler;
     class Connection;
+    class ServerWorker;
 
+    // Sockets, request parsing, TLS and response encoding are handled by a small
+    // pool of worker threads. Only IRequestHandler::processRequest() is run in the
+    // thread the server lives in, so request handlers don't need to be thread-safe.
     class Server : public QTcpServer
     {
         Q_OBJECT
         Q_DISABLE_COPY(Server)
 
+        friend class ServerWorker;
+
     public:
         Server(IRequestHandler *requestHandler, QObject *parent = nullptr);
         ~Server();
@@ -58,18 +71,23 @@ namespace Http
         void disableHttps();
 #endif
 
-    private slots:
-        void dropTimedOutConnection();
-
     private:
         void incomingConnection(qintptr socketDescriptor);
 
+        // called by workers
+        QTcpSocket *createSocket(qintptr socketDescriptor);
+        void handleRequest(Connection *connection, const Request &request, const Environment &env);
+
         IRequestHandler *m_requestHandler;
-        QList<Connection *> m_connections;  // for tracking persistent connections
+        QVector<QThread *> m_workerThreads;
+        QVector<ServerWorker *> m_workers;
+        int m_nextWorker;
+        QAtomicInt m_connectionCount;
 
 #ifndef QT_NO_OPENSSL
         QList<QSslCipher> safeCipherList() const;
 
+        QMutex m_httpsMutex;  // guards HTTPS settings which are read by workers
         bool m_https;
         QList<QSslCertificate> m_certificates;
         QSslKey m_key;
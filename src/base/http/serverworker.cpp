@@ -0,0 +1,100 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "serverworker.h"
+
+#include <QMutableListIterator>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "base/global.h"
+#include "connection.h"
+#include "server.h"
+
+static const int KEEP_ALIVE_DURATION = 7 * 1000;  // milliseconds
+static const int CONNECTIONS_SCAN_INTERVAL = 2;  // seconds
+
+using namespace Http;
+
+ServerWorker::ServerWorker(Server *server)
+    : m_server(server)
+    , m_dropConnectionTimer(new QTimer(this))
+{
+    m_dropConnectionTimer->setInterval(CONNECTIONS_SCAN_INTERVAL * 1000);
+    connect(m_dropConnectionTimer, &QTimer::timeout, this, &ServerWorker::dropTimedOutConnections);
+}
+
+ServerWorker::~ServerWorker()
+{
+    for (Connection *connection : qAsConst(m_connections)) {
+        delete connection;
+        m_server->m_connectionCount.deref();
+    }
+}
+
+void ServerWorker::addConnection(const qint64 socketDescriptor)
+{
+    QTcpSocket *socket = m_server->createSocket(socketDescriptor);
+    if (!socket) {
+        m_server->m_connectionCount.deref();
+        return;
+    }
+
+    Connection *connection = new Connection(socket, this);
+    Server *server = m_server;
+    // queued since the server lives in another thread
+    connect(connection, &Connection::requestReady, m_server
+            , [server, connection](const Request &request, const Environment &env)
+    {
+        server->handleRequest(connection, request, env);
+    });
+    m_connections.append(connection);
+
+    // the timer has to be started from the thread it lives in
+    if (!m_dropConnectionTimer->isActive())
+        m_dropConnectionTimer->start();
+}
+
+void ServerWorker::dropTimedOutConnections()
+{
+    QMutableListIterator<Connection *> i(m_connections);
+    while (i.hasNext()) {
+        auto connection = i.next();
+        if (connection->isProcessing())
+            continue;
+
+        if (connection->isClosed() || connection->hasExpired(KEEP_ALIVE_DURATION)) {
+            delete connection;
+            i.remove();
+            m_server->m_connectionCount.deref();
+        }
+    }
+
+    if (m_connections.isEmpty())
+        m_dropConnectionTimer->stop();
+}
@@ -31,6 +31,7 @@
 #define HTTP_TYPES_H
 
 #include <QHostAddress>
+#include <QMetaType>
 #include <QString>
 #include <QVector>
 
@@ -41,6 +42,7 @@ namespace Http
     const char METHOD_GET[] = "GET";
     const char METHOD_POST[] = "POST";
 
+    const char HEADER_ACCEPT_ENCODING[] = "accept-encoding";
     const char HEADER_CACHE_CONTROL[] = "cache-control";
     const char HEADER_CONNECTION[] = "connection";
     const char HEADER_CONTENT_DISPOSITION[] = "content-disposition";
@@ -49,10 +51,13 @@ namespace Http
     const char HEADER_CONTENT_SECURITY_POLICY[] = "content-security-policy";
     const char HEADER_CONTENT_TYPE[] = "content-type";
     const char HEADER_DATE[] = "date";
+    const char HEADER_ETAG[] = "etag";
     const char HEADER_HOST[] = "host";
+    const char HEADER_IF_NONE_MATCH[] = "if-none-match";
     const char HEADER_ORIGIN[] = "origin";
     const char HEADER_REFERER[] = "referer";
     const char HEADER_SET_COOKIE[] = "set-cookie";
+    const char HEADER_VARY[] = "vary";
     const char HEADER_X_CONTENT_TYPE_OPTIONS[] = "x-content-type-options";
     const char HEADER_X_FORWARDED_HOST[] = "x-forwarded-host";
     const char HEADER_X_FRAME_OPTIONS[] = "x-frame-options";
@@ -118,4 +123,10 @@ namespace Http
     };
 }
 
+// Requests and responses are passed between the server worker threads
+// and the thread the request handler lives in
+Q_DECLARE_METATYPE(Http::Environment)
+Q_DECLARE_METATYPE(Http::Request)
+Q_DECLARE_METATYPE(Http::Response)
+
 #endif // HTTP_TYPES_H
@@ -71,6 +71,12 @@ QString DownloadHandler::url() const
     return m_url;
 }
 
+// Returns header of the final reply (after redirections)
+QByteArray DownloadHandler::rawHeader(const QByteArray &headerName) const
+{
+    return (m_reply ? m_reply->rawHeader(headerName) : QByteArray());
+}
+
 void DownloadHandler::processFinishedDownload()
 {
     QString url = m_reply->url().toString();
@@ -89,6 +95,11 @@ void DownloadHandler::processFinishedDownload()
             // We should redirect
             handleRedirection(redirection.toUrl());
         }
+        else if (m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+            // Conditional request, the resource wasn't modified since it was fetched last time
+            emit downloadNotModified(m_url);
+            this->deleteLater();
+        }
         else {
             // Success
             QByteArray replyData = m_reply->readAll();
@@ -49,11 +49,13 @@ namespace Net
         ~DownloadHandler();
 
         QString url() const;
+        QByteArray rawHeader(const QByteArray &headerName) const;
 
     signals:
         void downloadFinished(const QString &url, const QByteArray &data);
         void downloadFinished(const QString &url, const QString &filePath);
         void downloadFailed(const QString &url, const QString &reason);
+        void downloadNotModified(const QString &url);
         void redirectedToMagnet(const QString &url, const QString &magnetUri);
 
     private slots:
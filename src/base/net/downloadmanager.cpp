@@ -137,7 +137,8 @@ DownloadManager *DownloadManager::instance()
     return m_instance;
 }
 
-DownloadHandler *DownloadManager::downloadUrl(const QString &url, bool saveToFile, qint64 limit, bool handleRedirectToMagnet, const QString &userAgent)
+DownloadHandler *DownloadManager::downloadUrl(const QString &url, bool saveToFile, qint64 limit, bool handleRedirectToMagnet, const QString &userAgent
+                                              , const QHash<QByteArray, QByteArray> &headers)
 {
     // Update proxy settings
     applyProxySettings();
@@ -159,6 +160,9 @@ DownloadHandler *DownloadManager::downloadUrl(const QString &url, bool saveToFil
     qDebug() << "Cookies:" << m_networkManager.cookieJar()->cookiesForUrl(request.url());
     // accept gzip
     request.setRawHeader("Accept-Encoding", "gzip");
+    // additional headers, e.g. for conditional requests
+    for (auto i = headers.cbegin(); i != headers.cend(); ++i)
+        request.setRawHeader(i.key(), i.value());
     return new DownloadHandler(m_networkManager.get(request), this, saveToFile, limit, handleRedirectToMagnet);
 }
 
@@ -132,6 +132,14 @@ QString GeoIPManager::lookup(const QHostAddress &hostAddr) const
     return QString();
 }
 
+QVector<QString> GeoIPManager::lookup(const QVector<QHostAddress> &hostAddrs) const
+{
+    if (m_enabled && m_geoIPDatabase)
+        return m_geoIPDatabase->lookup(hostAddrs);
+
+    return QVector<QString>(hostAddrs.size());
+}
+
 QString GeoIPManager::CountryName(const QString &countryISOCode)
 {
     static QHash<QString, QString> countries;
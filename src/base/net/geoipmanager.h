@@ -32,6 +32,7 @@
 
 #include <QCache>
 #include <QObject>
+#include <QVector>
 
 class QHostAddress;
 class QString;
@@ -50,6 +51,8 @@ namespace Net
         static GeoIPManager *instance();
 
         QString lookup(const QHostAddress &hostAddr) const;
+        // Resolves many addresses at once, faster than looking them up one by one
+        QVector<QString> lookup(const QVector<QHostAddress> &hostAddrs) const;
 
         static QString CountryName(const QString &countryISOCode);
 
@@ -26,13 +26,18 @@
  * exception statement from your version.
  */
 
+#include <algorithm>
+
 #include <QDateTime>
 #include <QDebug>
 #include <QFile>
 #include <QHash>
 #include <QHostAddress>
+#include <QSet>
 #include <QVariant>
+#include <QtEndian>
 
+#include "base/global.h"
 #include "base/types.h"
 #include "geoipdatabase.h"
 
@@ -65,6 +70,45 @@ namespace
         Boolean = 14,
         Float = 15
     };
+
+    // A node is made of two records (left and right) of RecordSize bits each
+    template <int RecordSize>
+    quint32 readNodeRecord(const uchar *node, bool isRight);
+
+    template <>
+    quint32 readNodeRecord<24>(const uchar *node, const bool isRight)
+    {
+        const uchar *record = node + (isRight ? 3 : 0);
+        return ((record[0] << 16) | (record[1] << 8) | record[2]);
+    }
+
+    template <>
+    quint32 readNodeRecord<28>(const uchar *node, const bool isRight)
+    {
+        // the middle byte holds the most significant bits of both records
+        if (isRight)
+            return (((node[3] & 0x0F) << 24) | (node[4] << 16) | (node[5] << 8) | node[6]);
+        return (((node[3] & 0xF0) << 20) | (node[0] << 16) | (node[1] << 8) | node[2]);
+    }
+
+    template <>
+    quint32 readNodeRecord<32>(const uchar *node, const bool isRight)
+    {
+        return qFromBigEndian<quint32>(node + (isRight ? 4 : 0));
+    }
+
+    // Follows "bitCount" bits of "address" starting from "node",
+    // returns a record which isn't a node or "nodeCount" if the address isn't found
+    template <int RecordSize>
+    quint32 walkTree(const uchar *index, const quint32 nodeCount, quint32 node, const uchar *address, const int bitCount)
+    {
+        for (int i = 0; (i < bitCount) && (node < nodeCount); ++i) {
+            const bool isRight = (((address[i / 8] >> (7 - (i % 8))) & 1) != 0);
+            node = readNodeRecord<RecordSize>((index + (node * (RecordSize / 4))), isRight);
+        }
+
+        return ((node < nodeCount) ? nodeCount : node);
+    }
 }
 
 struct DataFieldDescriptor
@@ -77,40 +121,47 @@ struct DataFieldDescriptor
     };
 };
 
-GeoIPDatabase::GeoIPDatabase(quint32 size)
+GeoIPDatabase::GeoIPDatabase()
     : m_ipVersion(0)
     , m_recordSize(0)
     , m_nodeCount(0)
     , m_nodeSize(0)
     , m_indexSize(0)
-    , m_recordBytes(0)
-    , m_size(size)
-    , m_data(new uchar[size])
+    , m_ipv4StartNode(0)
+    , m_size(0)
+    , m_data(nullptr)
 {
 }
 
 GeoIPDatabase *GeoIPDatabase::load(const QString &filename, QString &error)
 {
-    GeoIPDatabase *db = nullptr;
-    QFile file(filename);
-    if (file.size() > MAX_FILE_SIZE) {
+    GeoIPDatabase *db = new GeoIPDatabase;
+    db->m_file.setFileName(filename);
+    if (db->m_file.size() > MAX_FILE_SIZE) {
         error = tr("Unsupported database file size.");
+        delete db;
         return 0;
     }
 
-    if (!file.open(QFile::ReadOnly)) {
-        error = file.errorString();
-        return 0;
-    }
-
-    db = new GeoIPDatabase(file.size());
-
-    if (file.read(reinterpret_cast<char *>(db->m_data), db->m_size) != db->m_size) {
-        error = file.errorString();
+    if (!db->m_file.open(QFile::ReadOnly)) {
+        error = db->m_file.errorString();
         delete db;
         return 0;
     }
 
+    // The database is only ever read so it is mapped instead of being copied into memory
+    db->m_size = db->m_file.size();
+    db->m_data = db->m_file.map(0, db->m_size);
+    if (!db->m_data) {
+        db->m_buffer = db->m_file.readAll();
+        db->m_file.close();
+        if (db->m_buffer.size() != static_cast<int>(db->m_size)) {
+            error = db->m_file.errorString();
+            delete db;
+            return 0;
+        }
+        db->m_data = reinterpret_cast<const uchar *>(db->m_buffer.constData());
+    }
 
     if (!db->parseMetadata(db->readMetadata(), error) || !db->loadDB(error)) {
         delete db;
@@ -122,15 +173,16 @@ GeoIPDatabase *GeoIPDatabase::load(const QString &filename, QString &error)
 
 GeoIPDatabase *GeoIPDatabase::load(const QByteArray &data, QString &error)
 {
-    GeoIPDatabase *db = nullptr;
     if (data.size() > MAX_FILE_SIZE) {
         error = tr("Unsupported database file size.");
         return 0;
     }
 
-    db = new GeoIPDatabase(data.size());
-
-    memcpy(reinterpret_cast<char *>(db->m_data), data.constData(), db->m_size);
+    // shares the data instead of copying it
+    GeoIPDatabase *db = new GeoIPDatabase;
+    db->m_buffer = data;
+    db->m_size = data.size();
+    db->m_data = reinterpret_cast<const uchar *>(db->m_buffer.constData());
 
     if (!db->parseMetadata(db->readMetadata(), error) || !db->loadDB(error)) {
         delete db;
@@ -142,7 +194,7 @@ GeoIPDatabase *GeoIPDatabase::load(const QByteArray &data, QString &error)
 
 GeoIPDatabase::~GeoIPDatabase()
 {
-    delete [] m_data;
+    // QFile unmaps the database when it gets destroyed
 }
 
 QString GeoIPDatabase::type() const
@@ -162,44 +214,129 @@ QDateTime GeoIPDatabase::buildEpoch() const
 
 QString GeoIPDatabase::lookup(const QHostAddress &hostAddr) const
 {
-    Q_IPV6ADDR addr = hostAddr.toIPv6Address();
+    quint32 record = m_nodeCount;
+    bool isIPv4 = false;
+    const quint32 ipv4 = hostAddr.toIPv4Address(&isIPv4);
+    if (isIPv4) {
+        // IPv4 addresses live in the ::/96 subtree, the walk starts right there
+        uchar address[4];
+        qToBigEndian(ipv4, address);
+        record = findRecord(m_ipv4StartNode, address, 32);
+    }
+    else {
+        const Q_IPV6ADDR address = hostAddr.toIPv6Address();
+        record = findRecord(0, address.c, 128);
+    }
 
-    const uchar *ptr = m_data;
+    // m_countries is never modified after loading, concurrent lookups are safe
+    return m_countries.value(record);
+}
 
-    for (int i = 0; i < 16; ++i) {
-        for (int j = 0; j < 8; ++j) {
-            bool right = static_cast<bool>((addr[i] >> (7 - j)) & 1);
-            // Interpret the left/right record as number
-            if (right)
-                ptr += m_recordBytes;
+QVector<QString> GeoIPDatabase::lookup(const QVector<QHostAddress> &hostAddrs) const
+{
+    QVector<SearchKey> ipv4Keys;
+    QVector<SearchKey> ipv6Keys;
+    for (int i = 0; i < hostAddrs.size(); ++i) {
+        SearchKey key;
+        key.index = i;
+        bool isIPv4 = false;
+        const quint32 ipv4 = hostAddrs[i].toIPv4Address(&isIPv4);
+        if (isIPv4) {
+            qToBigEndian(ipv4, key.address);
+            ipv4Keys.append(key);
+        }
+        else {
+            const Q_IPV6ADDR ipv6 = hostAddrs[i].toIPv6Address();
+            memcpy(key.address, ipv6.c, sizeof(key.address));
+            ipv6Keys.append(key);
+        }
+    }
 
-            quint32 id = 0;
-            uchar *idPtr = reinterpret_cast<uchar *>(&id);
-            memcpy(&idPtr[4 - m_recordBytes], ptr, m_recordBytes);
-            fromBigEndian(idPtr, 4);
+    QVector<quint32> records(hostAddrs.size(), m_nodeCount);
+    findRecords(m_ipv4StartNode, 32, ipv4Keys, records);
+    findRecords(0, 128, ipv6Keys, records);
 
-            if (id == m_nodeCount) {
-                return QString();
-            }
-            else if (id > m_nodeCount) {
-                QString country = m_countries.value(id);
-                if (country.isEmpty()) {
-                    const quint32 offset = id - m_nodeCount - sizeof(DATA_SECTION_SEPARATOR);
-                    quint32 tmp = offset + m_indexSize + sizeof(DATA_SECTION_SEPARATOR);
-                    QVariant val = readDataField(tmp);
-                    if (val.userType() == QMetaType::QVariantHash) {
-                        country = val.toHash()["country"].toHash()["iso_code"].toString();
-                        m_countries[id] = country;
-                    }
-                }
-                return country;
+    QVector<QString> countries;
+    countries.reserve(records.size());
+    for (const quint32 record : qAsConst(records))
+        countries.append(m_countries.value(record));
+    return countries;
+}
+
+// Sorted addresses share the beginning of their tree walk with the previous one,
+// so each lookup only walks the bits that differ
+void GeoIPDatabase::findRecords(const quint32 startNode, const int bitCount, QVector<SearchKey> &keys, QVector<quint32> &records) const
+{
+    const int byteCount = bitCount / 8;
+    std::sort(keys.begin(), keys.end(), [byteCount](const SearchKey &left, const SearchKey &right)
+    {
+        return (memcmp(left.address, right.address, byteCount) < 0);
+    });
+
+    // path[depth] is the node reached after following "depth" bits of the previous address
+    QVector<quint32> path(bitCount + 1);
+    path[0] = startNode;
+    int pathLength = -1; // number of bits followed for the previous address
+    quint32 lastRecord = m_nodeCount;
+    const SearchKey *lastKey = nullptr;
+
+    for (const SearchKey &key : qAsConst(keys)) {
+        int depth = 0;
+        if (lastKey) {
+            // length of the common prefix
+            int byte = 0;
+            while ((byte < byteCount) && (key.address[byte] == lastKey->address[byte]))
+                ++byte;
+            depth = byte * 8;
+            if (byte < byteCount) {
+                const uchar diff = key.address[byte] ^ lastKey->address[byte];
+                for (int bit = 7; ((diff >> bit) & 1) == 0; --bit)
+                    ++depth;
             }
-            else {
-                ptr = m_data + (id * m_nodeSize);
+
+            if (depth >= pathLength) {
+                // the previous walk ended within the common prefix
+                records[key.index] = lastRecord;
+                lastKey = &key;
+                continue;
             }
         }
+
+        quint32 node = path[depth];
+        for (; (depth < bitCount) && (node < m_nodeCount); ++depth) {
+            node = readRecord(node, (((key.address[depth / 8] >> (7 - (depth % 8))) & 1) != 0));
+            path[depth + 1] = node;
+        }
+
+        pathLength = depth;
+        lastRecord = (node < m_nodeCount) ? m_nodeCount : node;
+        lastKey = &key;
+        records[key.index] = lastRecord;
     }
+}
 
+quint32 GeoIPDatabase::findRecord(const quint32 startNode, const uchar *address, const int bitCount) const
+{
+    switch (m_recordSize) {
+    case 24:
+        return walkTree<24>(m_data, m_nodeCount, startNode, address, bitCount);
+    case 28:
+        return walkTree<28>(m_data, m_nodeCount, startNode, address, bitCount);
+    case 32:
+        return walkTree<32>(m_data, m_nodeCount, startNode, address, bitCount);
+    default:
+        Q_ASSERT(false);
+        return m_nodeCount;
+    }
+}
+
+QString GeoIPDatabase::readCountry(const quint32 record) const
+{
+    const quint32 offset = record - m_nodeCount - sizeof(DATA_SECTION_SEPARATOR);
+    quint32 tmp = offset + m_indexSize + sizeof(DATA_SECTION_SEPARATOR);
+    const QVariant val = readDataField(tmp);
+    if (val.userType() == QMetaType::QVariantHash)
+        return val.toHash()["country"].toHash()["iso_code"].toString();
     return QString();
 }
 
@@ -246,12 +383,11 @@ bool GeoIPDatabase::parseMetadata(const QVariantHash &metadata, QString &error)
 
     CHECK_METADATA_REQ(record_size, UShort);
     m_recordSize = metadata.value("record_size").value<quint16>();
-    if (m_recordSize != 24) {
+    if ((m_recordSize != 24) && (m_recordSize != 28) && (m_recordSize != 32)) {
         error = tr("Unsupported record size: %1").arg(m_recordSize);
         return false;
     }
     m_nodeSize = m_recordSize / 4;
-    m_recordBytes = m_nodeSize / 2;
 
     CHECK_METADATA_REQ(node_count, UInt);
     m_nodeCount = metadata.value("node_count").value<quint32>();
@@ -273,7 +409,7 @@ bool GeoIPDatabase::parseMetadata(const QVariantHash &metadata, QString &error)
     return true;
 }
 
-bool GeoIPDatabase::loadDB(QString &error) const
+bool GeoIPDatabase::loadDB(QString &error)
 {
     qDebug() << "Parsing MaxMindDB index tree...";
 
@@ -285,9 +421,52 @@ bool GeoIPDatabase::loadDB(QString &error) const
         return false;
     }
 
+    // Skip the 96 leading zero bits of IPv4 addresses once and for all
+    m_ipv4StartNode = 0;
+    for (int i = 0; (i < 96) && (m_ipv4StartNode < m_nodeCount); ++i)
+        m_ipv4StartNode = readRecord(m_ipv4StartNode, false);
+
+    // The database has only a few hundred distinct data records, decoding them
+    // upfront makes lookups a plain tree walk without any shared mutable state
+    QSet<quint32> dataRecords;
+    quint32 lastRecord = m_nodeCount;
+    for (quint32 node = 0; node < m_nodeCount; ++node) {
+        for (const bool isRight : {false, true}) {
+            const quint32 record = readRecord(node, isRight);
+            if ((record > m_nodeCount) && (record != lastRecord)) {
+                dataRecords.insert(record);
+                lastRecord = record;
+            }
+        }
+    }
+    if (m_ipv4StartNode > m_nodeCount)
+        dataRecords.insert(m_ipv4StartNode);
+
+    for (const quint32 record : qAsConst(dataRecords)) {
+        const QString country = readCountry(record);
+        if (!country.isEmpty())
+            m_countries.insert(record, country);
+    }
+
     return true;
 }
 
+quint32 GeoIPDatabase::readRecord(const quint32 node, const bool isRight) const
+{
+    const uchar *nodePtr = m_data + (node * m_nodeSize);
+    switch (m_recordSize) {
+    case 24:
+        return readNodeRecord<24>(nodePtr, isRight);
+    case 28:
+        return readNodeRecord<28>(nodePtr, isRight);
+    case 32:
+        return readNodeRecord<32>(nodePtr, isRight);
+    default:
+        Q_ASSERT(false);
+        return m_nodeCount;
+    }
+}
+
 QVariantHash GeoIPDatabase::readMetadata() const
 {
     const char *ptr = reinterpret_cast<const char *>(m_data);
@@ -29,10 +29,13 @@
 #ifndef GEOIPDATABASE_H
 #define GEOIPDATABASE_H
 
+#include <QByteArray>
 #include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QVector>
 #include <QtGlobal>
 
-class QByteArray;
 class QDateTime;
 class QHostAddress;
 class QString;
@@ -53,12 +56,23 @@ public:
     quint16 ipVersion() const;
     QDateTime buildEpoch() const;
     QString lookup(const QHostAddress &hostAddr) const;
+    QVector<QString> lookup(const QVector<QHostAddress> &hostAddrs) const;
 
 private:
-    GeoIPDatabase(quint32 size);
+    struct SearchKey
+    {
+        uchar address[16];
+        int index;
+    };
+
+    GeoIPDatabase();
 
     bool parseMetadata(const QVariantHash &metadata, QString &error);
-    bool loadDB(QString &error) const;
+    bool loadDB(QString &error);
+    quint32 readRecord(quint32 node, bool isRight) const;
+    quint32 findRecord(quint32 startNode, const uchar *address, int bitCount) const;
+    void findRecords(quint32 startNode, int bitCount, QVector<SearchKey> &keys, QVector<quint32> &records) const;
+    QString readCountry(quint32 record) const;
     QVariantHash readMetadata() const;
 
     QVariant readDataField(quint32 &offset) const;
@@ -91,12 +105,14 @@ private:
     quint32 m_nodeCount;
     int m_nodeSize;
     int m_indexSize;
-    int m_recordBytes;
     QDateTime m_buildEpoch;
     // Search data
-    mutable QHash<quint32, QString> m_countries;
+    quint32 m_ipv4StartNode;
+    QHash<quint32, QString> m_countries;
+    QFile m_file; // owns the mapping if the database is mapped
+    QByteArray m_buffer;
     quint32 m_size;
-    uchar *m_data;
+    const uchar *m_data;
 };
 
 #endif // GEOIPDATABASE_H
@@ -29,6 +29,8 @@
 
 #include "rss_parser.h"
 
+#include <algorithm>
+
 #include <QDateTime>
 #include <QDebug>
 #include <QGlobalStatic>
@@ -528,6 +530,26 @@ using namespace RSS::Private;
 
 const int ParsingResultTypeId = qRegisterMetaType<ParsingResult>();
 
+QVariantHash ParsedArticle::toVariantHash() const
+{
+    QVariantHash varHash = otherFields;
+    varHash[Article::KeyId] = guid;
+    if (date.isValid())
+        varHash[Article::KeyDate] = date;
+    if (!title.isNull())
+        varHash[Article::KeyTitle] = title;
+    if (!author.isNull())
+        varHash[Article::KeyAuthor] = author;
+    if (!description.isNull())
+        varHash[Article::KeyDescription] = description;
+    if (!torrentURL.isNull())
+        varHash[Article::KeyTorrentURL] = torrentURL;
+    if (!link.isNull())
+        varHash[Article::KeyLink] = link;
+
+    return varHash;
+}
+
 Parser::Parser(QString lastBuildDate)
 {
     m_result.lastBuildDate = lastBuildDate;
@@ -586,10 +608,10 @@ void Parser::parse_impl(const QByteArray &feedData)
         // Sort article list chronologically
         // NOTE: We don't need to sort it here if articles are always
         // sorted in fetched XML in reverse chronological order
-        std::sort(m_result.articles.begin(), m_result.articles.end()
-                  , [](const QVariantHash &a1, const QVariantHash &a2)
+        std::stable_sort(m_result.articles.begin(), m_result.articles.end()
+                         , [](const ParsedArticle &a1, const ParsedArticle &a2)
         {
-            return a1["date"].toDateTime() < a2["date"].toDateTime();
+            return a1.date < a2.date;
         });
     }
 
@@ -599,7 +621,7 @@ void Parser::parse_impl(const QByteArray &feedData)
 
 void Parser::parseRssArticle(QXmlStreamReader &xml)
 {
-    QVariantHash article;
+    ParsedArticle article;
 
     while (!xml.atEnd()) {
         xml.readNext();
@@ -610,38 +632,38 @@ void Parser::parseRssArticle(QXmlStreamReader &xml)
 
         if (xml.isStartElement()) {
             if (name == QLatin1String("title")) {
-                article[Article::KeyTitle] = xml.readElementText().trimmed();
+                article.title = xml.readElementText().trimmed();
             }
             else if (name == QLatin1String("enclosure")) {
                 if (xml.attributes().value("type") == QLatin1String("application/x-bittorrent"))
-                    article[Article::KeyTorrentURL] = xml.attributes().value(QLatin1String("url")).toString();
+                    article.torrentURL = xml.attributes().value(QLatin1String("url")).toString();
             }
             else if (name == QLatin1String("link")) {
                 const QString text {xml.readElementText().trimmed()};
                 if (text.startsWith(QLatin1String("magnet:"), Qt::CaseInsensitive))
-                    article[Article::KeyTorrentURL] = text; // magnet link instead of a news URL
+                    article.torrentURL = text; // magnet link instead of a news URL
                 else
-                    article[Article::KeyLink] = text;
+                    article.link = text;
             }
             else if (name == QLatin1String("description")) {
-                article[Article::KeyDescription] = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                article.description = xml.readElementText(QXmlStreamReader::IncludeChildElements);
             }
             else if (name == QLatin1String("pubDate")) {
-                article[Article::KeyDate] = parseDate(xml.readElementText().trimmed());
+                article.date = parseDate(xml.readElementText().trimmed());
             }
             else if (name == QLatin1String("author")) {
-                article[Article::KeyAuthor] = xml.readElementText().trimmed();
+                article.author = xml.readElementText().trimmed();
             }
             else if (name == QLatin1String("guid")) {
-                article[Article::KeyId] = xml.readElementText().trimmed();
+                article.guid = xml.readElementText().trimmed();
             }
             else {
-                article[name] = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                article.otherFields[name] = xml.readElementText(QXmlStreamReader::IncludeChildElements);
             }
         }
     }
 
-    m_result.articles.prepend(article);
+    addArticle(article);
 }
 
 void Parser::parseRSSChannel(QXmlStreamReader &xml)
@@ -672,7 +694,7 @@ void Parser::parseRSSChannel(QXmlStreamReader &xml)
 
 void Parser::parseAtomArticle(QXmlStreamReader &xml)
 {
-    QVariantHash article;
+    ParsedArticle article;
     bool doubleContent = false;
 
     while (!xml.atEnd()) {
@@ -684,7 +706,7 @@ void Parser::parseAtomArticle(QXmlStreamReader &xml)
 
         if (xml.isStartElement()) {
             if (name == QLatin1String("title")) {
-                article[Article::KeyTitle] = xml.readElementText().trimmed();
+                article.title = xml.readElementText().trimmed();
             }
             else if (name == QLatin1String("link")) {
                 QString link = (xml.attributes().isEmpty()
@@ -692,12 +714,12 @@ void Parser::parseAtomArticle(QXmlStreamReader &xml)
                                 : xml.attributes().value(QLatin1String("href")).toString());
 
                 if (link.startsWith(QLatin1String("magnet:"), Qt::CaseInsensitive))
-                    article[Article::KeyTorrentURL] = link; // magnet link instead of a news URL
+                    article.torrentURL = link; // magnet link instead of a news URL
                 else
                     // Atom feeds can have relative links, work around this and
                     // take the stress of figuring article full URI from UI
                     // Assemble full URI
-                    article[Article::KeyLink] = (m_baseUrl.isEmpty() ? link : m_baseUrl + link);
+                    article.link = (m_baseUrl.isEmpty() ? link : m_baseUrl + link);
 
             }
             else if ((name == QLatin1String("summary")) || (name == QLatin1String("content"))) {
@@ -710,33 +732,33 @@ void Parser::parseAtomArticle(QXmlStreamReader &xml)
                 // Actually works great for non-broken content too
                 QString feedText = xml.readElementText(QXmlStreamReader::IncludeChildElements).trimmed();
                 if (!feedText.isEmpty()) {
-                    article[Article::KeyDescription] = feedText;
+                    article.description = feedText;
                     doubleContent = true;
                 }
             }
             else if (name == QLatin1String("updated")) {
                 // ATOM uses standard compliant date, don't do fancy stuff
                 QDateTime articleDate = QDateTime::fromString(xml.readElementText().trimmed(), Qt::ISODate);
-                article[Article::KeyDate] = (articleDate.isValid() ? articleDate : QDateTime::currentDateTime());
+                article.date = (articleDate.isValid() ? articleDate : QDateTime::currentDateTime());
             }
             else if (name == QLatin1String("author")) {
                 while (xml.readNextStartElement()) {
                     if (xml.name() == QLatin1String("name"))
-                        article[Article::KeyAuthor] = xml.readElementText().trimmed();
+                        article.author = xml.readElementText().trimmed();
                     else
                         xml.skipCurrentElement();
                 }
             }
             else if (name == QLatin1String("id")) {
-                article[Article::KeyId] = xml.readElementText().trimmed();
+                article.guid = xml.readElementText().trimmed();
             }
             else {
-                article[name] = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                article.otherFields[name] = xml.readElementText(QXmlStreamReader::IncludeChildElements);
             }
         }
     }
 
-    m_result.articles.prepend(article);
+    addArticle(article);
 }
 
 void Parser::parseAtomChannel(QXmlStreamReader &xml)
@@ -766,3 +788,18 @@ void Parser::parseAtomChannel(QXmlStreamReader &xml)
         }
     }
 }
+
+void Parser::addArticle(ParsedArticle &article)
+{
+    // If item does not have a guid, fall back to some other identifier
+    if (article.guid.isEmpty())
+        article.guid = article.otherFields.value(Article::KeyId).toString();
+    if (article.guid.isEmpty())
+        article.guid = article.torrentURL;
+    if (article.guid.isEmpty())
+        article.guid = article.title;
+    if (article.guid.isEmpty())
+        return; // Bad RSS Article data
+
+    m_result.articles.prepend(article);
+}
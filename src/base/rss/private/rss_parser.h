@@ -29,6 +29,7 @@
 
 #pragma once
 
+#include <QDateTime>
 #include <QList>
 #include <QObject>
 #include <QString>
@@ -40,12 +41,26 @@ namespace RSS
 {
     namespace Private
     {
+        struct ParsedArticle
+        {
+            QString guid;
+            QDateTime date;
+            QString title;
+            QString author;
+            QString description;
+            QString torrentURL;
+            QString link;
+            QVariantHash otherFields; // elements without a dedicated field
+
+            QVariantHash toVariantHash() const;
+        };
+
         struct ParsingResult
         {
             QString error;
             QString lastBuildDate;
             QString title;
-            QList<QVariantHash> articles;
+            QList<ParsedArticle> articles; // sorted by date, the most recent last
         };
 
         class Parser : public QObject
@@ -65,6 +80,7 @@ namespace RSS
             void parseRSSChannel(QXmlStreamReader &xml);
             void parseAtomArticle(QXmlStreamReader &xml);
             void parseAtomChannel(QXmlStreamReader &xml);
+            void addArticle(ParsedArticle &article);
 
             QString m_baseUrl;
             ParsingResult m_result;
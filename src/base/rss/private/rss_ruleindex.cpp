@@ -0,0 +1,200 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#include "rss_ruleindex.h"
+
+#include <algorithm>
+
+#include "../../global.h"
+#include "../rss_autodownloadrule.h"
+
+using namespace RSS::Private;
+
+int LiteralMatcher::addLiteral(const QString &literal)
+{
+    Q_ASSERT(!literal.isEmpty());
+
+    const auto it = m_literals.constFind(literal);
+    if (it != m_literals.cend())
+        return it.value();
+
+    const int id = m_literals.size();
+    m_literals.insert(literal, id);
+    return id;
+}
+
+int LiteralMatcher::literalCount() const
+{
+    return m_literals.size();
+}
+
+void LiteralMatcher::build()
+{
+    // Only the characters used in literals get a class of their own,
+    // all the other characters share class 0 which always leads back to the root
+    m_charClasses.assign(128, 0);
+    m_classCount = 1;
+    for (auto it = m_literals.cbegin(); it != m_literals.cend(); ++it) {
+        for (const QChar c : it.key()) {
+            Q_ASSERT(c.unicode() < 128);
+            if (m_charClasses[c.unicode()] == 0)
+                m_charClasses[c.unicode()] = m_classCount++;
+        }
+    }
+
+    // Build the trie
+    m_transitions.assign(m_classCount, -1);
+    m_stateLiterals.assign(1, -1);
+    for (auto it = m_literals.cbegin(); it != m_literals.cend(); ++it) {
+        int state = 0;
+        for (const QChar c : it.key()) {
+            const int transition = (state * m_classCount) + m_charClasses[c.unicode()];
+            if (m_transitions[transition] < 0) {
+                m_transitions[transition] = static_cast<int>(m_stateLiterals.size());
+                m_transitions.resize(m_transitions.size() + m_classCount, -1);
+                m_stateLiterals.push_back(-1);
+            }
+            state = m_transitions[transition];
+        }
+        m_stateLiterals[state] = it.value();
+    }
+
+    // Turn it into a DFA by following the failure links breadth first,
+    // so the failure state of each state is complete by the time it's needed
+    const int stateCount = static_cast<int>(m_stateLiterals.size());
+    std::vector<int> failureLinks(stateCount, 0);
+    m_outputLinks.assign(stateCount, -1);
+
+    std::vector<int> queue;
+    queue.reserve(stateCount);
+    for (int charClass = 0; charClass < m_classCount; ++charClass) {
+        int &next = m_transitions[charClass];
+        if (next < 0)
+            next = 0;
+        else
+            queue.push_back(next);
+    }
+
+    for (size_t i = 0; i < queue.size(); ++i) {
+        const int state = queue[i];
+        const int failure = failureLinks[state];
+        m_outputLinks[state] = (m_stateLiterals[failure] >= 0) ? failure : m_outputLinks[failure];
+
+        for (int charClass = 0; charClass < m_classCount; ++charClass) {
+            const int next = m_transitions[(state * m_classCount) + charClass];
+            const int failureNext = m_transitions[(failure * m_classCount) + charClass];
+            if (next < 0) {
+                m_transitions[(state * m_classCount) + charClass] = failureNext;
+            }
+            else {
+                failureLinks[next] = failureNext;
+                queue.push_back(next);
+            }
+        }
+    }
+}
+
+QVector<int> LiteralMatcher::findIn(const QString &text) const
+{
+    QVector<int> found;
+    if (m_transitions.empty()) return found; // not built yet
+
+    int state = 0;
+    for (const QChar c : text) {
+        const ushort charCode = c.unicode();
+        const int charClass = (charCode < 128) ? m_charClasses[charCode] : 0;
+        state = m_transitions[(state * m_classCount) + charClass];
+
+        int output = (m_stateLiterals[state] >= 0) ? state : m_outputLinks[state];
+        while (output >= 0) {
+            found.append(m_stateLiterals[output]);
+            output = m_outputLinks[output];
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+void RuleIndex::rebuild(const QHash<QString, AutoDownloadRule> &rules)
+{
+    m_ruleNames.clear();
+    m_feeds.clear();
+
+    for (auto it = rules.cbegin(); it != rules.cend(); ++it) {
+        const AutoDownloadRule &rule = it.value();
+        if (!rule.isEnabled()) continue;
+
+        const int ruleIndex = m_ruleNames.size();
+        m_ruleNames.append(it.key());
+
+        const QStringList literals = rule.mustContainLiterals();
+        for (const QString &feedURL : copyAsConst(rule.feedURLs())) {
+            FeedRules &feedRules = m_feeds[feedURL];
+            if (literals.isEmpty()) {
+                feedRules.unfilteredRules.append(ruleIndex);
+                continue;
+            }
+
+            for (const QString &literal : literals) {
+                const int literalId = feedRules.matcher.addLiteral(literal);
+                if (literalId >= feedRules.literalRules.size())
+                    feedRules.literalRules.resize(literalId + 1);
+                feedRules.literalRules[literalId].append(ruleIndex);
+            }
+        }
+    }
+
+    for (FeedRules &feedRules : m_feeds)
+        feedRules.matcher.build();
+}
+
+QStringList RuleIndex::candidateRules(const QString &feedURL, const QString &articleTitle) const
+{
+    const auto it = m_feeds.constFind(feedURL);
+    if (it == m_feeds.cend()) return {};
+
+    const FeedRules &feedRules = it.value();
+    QVector<int> candidates = feedRules.unfilteredRules;
+    if (feedRules.matcher.literalCount() > 0) {
+        const QVector<int> foundLiterals = feedRules.matcher.findIn(articleTitle.toCaseFolded());
+        for (const int literalId : foundLiterals)
+            candidates += feedRules.literalRules[literalId];
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    QStringList ruleNames;
+    ruleNames.reserve(candidates.size());
+    for (const int ruleIndex : qAsConst(candidates))
+        ruleNames.append(m_ruleNames[ruleIndex]);
+    return ruleNames;
+}
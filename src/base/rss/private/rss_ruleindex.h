@@ -0,0 +1,89 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace RSS
+{
+    class AutoDownloadRule;
+
+    namespace Private
+    {
+        // Aho-Corasick automaton finding all the literals contained in a text in a single pass.
+        // Literals must consist of ASCII characters and be case folded, text is case folded by caller.
+        class LiteralMatcher
+        {
+        public:
+            int addLiteral(const QString &literal);
+            int literalCount() const;
+            void build();
+
+            // Returns sorted ids of the literals contained in the text
+            QVector<int> findIn(const QString &text) const;
+
+        private:
+            QHash<QString, int> m_literals;
+            int m_classCount = 1;
+            std::vector<int> m_charClasses;
+            // m_transitions[state * m_classCount + class] is the next state
+            std::vector<int> m_transitions;
+            std::vector<int> m_stateLiterals;
+            // Nearest state accepting a shorter literal ending at the same position
+            std::vector<int> m_outputLinks;
+        };
+
+        // Selects the download rules which can match an article of a given feed.
+        // Rules having must contain literals are only selected when the title contains one of them.
+        class RuleIndex
+        {
+        public:
+            void rebuild(const QHash<QString, AutoDownloadRule> &rules);
+            // Returns rule names in the order they were passed to rebuild()
+            QStringList candidateRules(const QString &feedURL, const QString &articleTitle) const;
+
+        private:
+            struct FeedRules
+            {
+                QVector<int> unfilteredRules;
+                QVector<QVector<int>> literalRules; // indexed by literal id
+                LiteralMatcher matcher;
+            };
+
+            QStringList m_ruleNames;
+            QHash<QString, FeedRules> m_feeds;
+        };
+    }
+}
@@ -30,11 +30,13 @@
 
 #include <QDataStream>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonValue>
 #include <QSaveFile>
+#include <QSet>
 #include <QThread>
 #include <QTimer>
 #include <QVariant>
@@ -63,6 +65,7 @@ struct ProcessingJob
 
 const QString ConfFolderName(QStringLiteral("rss"));
 const QString RulesFileName(QStringLiteral("download_rules.json"));
+const int ProcessingBatchTime = 50; // milliseconds
 
 const QString SettingsKey_ProcessingEnabled(QStringLiteral("RSS/AutoDownloader/EnableProcessing"));
 const QString SettingsKey_SmartEpisodeFilter(QStringLiteral("RSS/AutoDownloader/SmartEpisodeFilter"));
@@ -200,6 +203,7 @@ bool AutoDownloader::renameRule(const QString &ruleName, const QString &newRuleN
     if (hasRule(newRuleName)) return false;
 
     m_rules.insert(newRuleName, m_rules.take(ruleName));
+    m_ruleIndexDirty = true;
     m_dirty = true;
     store();
     emit ruleRenamed(newRuleName, ruleName);
@@ -211,6 +215,7 @@ void AutoDownloader::removeRule(const QString &ruleName)
     if (m_rules.contains(ruleName)) {
         emit ruleAboutToBeRemoved(ruleName);
         m_rules.remove(ruleName);
+        m_ruleIndexDirty = true;
         m_dirty = true;
         store();
     }
@@ -312,11 +317,17 @@ void AutoDownloader::setSmartEpisodeFilters(const QStringList &filters)
 
 void AutoDownloader::process()
 {
-    if (m_processingQueue.isEmpty()) return; // processing was disabled
+    // Process as many articles as fit in the time slice, so the event loop isn't blocked for long
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+    while (!m_processingQueue.isEmpty()) { // empty if processing was disabled
+        processJob(m_processingQueue.takeFirst());
+        if (batchTimer.hasExpired(ProcessingBatchTime))
+            break;
+    }
 
-    processJob(m_processingQueue.takeFirst());
     if (!m_processingQueue.isEmpty())
-        // Schedule to process the next torrent (if any)
+        // Schedule to process the remaining articles (if any)
         m_processingTimer->start();
 }
 
@@ -345,6 +356,7 @@ void AutoDownloader::handleNewArticle(Article *article)
 void AutoDownloader::setRule_impl(const AutoDownloadRule &rule)
 {
     m_rules.insert(rule.name(), rule);
+    m_ruleIndexDirty = true;
 }
 
 void AutoDownloader::addJobForArticle(Article *article)
@@ -362,10 +374,19 @@ void AutoDownloader::addJobForArticle(Article *article)
 
 void AutoDownloader::processJob(const QSharedPointer<ProcessingJob> &job)
 {
-    for (AutoDownloadRule &rule: m_rules) {
-        if (!rule.isEnabled()) continue;
-        if (!rule.feedURLs().contains(job->feedURL)) continue;
-        if (!rule.matches(job->articleData.value(Article::KeyTitle).toString())) continue;
+    if (m_ruleIndexDirty) {
+        m_ruleIndex.rebuild(m_rules);
+        m_ruleIndexDirty = false;
+    }
+
+    const QString articleTitle = job->articleData.value(Article::KeyTitle).toString();
+    const QStringList candidateRules = m_ruleIndex.candidateRules(job->feedURL, articleTitle);
+    for (const QString &ruleName : candidateRules) {
+        const auto ruleIt = m_rules.find(ruleName);
+        if (ruleIt == m_rules.end()) continue;
+
+        AutoDownloadRule &rule = ruleIt.value();
+        if (!rule.matches(articleTitle)) continue;
 
         auto articleDate = job->articleData.value(Article::KeyDate).toDateTime();
         // if rule is in ignoring state do nothing with matched torrent
@@ -474,9 +495,22 @@ void AutoDownloader::resetProcessingQueue()
     m_processingQueue.clear();
     if (!m_processingEnabled) return;
 
-    foreach (Article *article, Session::instance()->rootFolder()->articles()) {
-        if (!article->isRead() && !article->torrentUrl().isEmpty())
-            addJobForArticle(article);
+    // only the feeds used by the enabled rules need their articles to be loaded
+    QSet<QString> feedURLs;
+    for (const AutoDownloadRule &rule : qAsConst(m_rules)) {
+        if (rule.isEnabled())
+            feedURLs.unite(rule.feedURLs().toSet());
+    }
+
+    for (const QString &feedURL : qAsConst(feedURLs)) {
+        Feed *feed = Session::instance()->feedByURL(feedURL);
+        if (!feed) continue;
+
+        feed->loadArticles();
+        for (Article *article : copyAsConst(feed->articles())) {
+            if (!article->isRead() && !article->torrentUrl().isEmpty())
+                addJobForArticle(article);
+        }
     }
 }
 
@@ -29,6 +29,8 @@
 
 #include "rss_autodownloadrule.h"
 
+#include <algorithm>
+
 #include <QDebug>
 #include <QDir>
 #include <QHash>
@@ -38,7 +40,9 @@
 #include <QSharedData>
 #include <QString>
 #include <QStringList>
+#include <QVector>
 
+#include "../global.h"
 #include "../preferences.h"
 #include "../tristatebool.h"
 #include "../utils/fs.h"
@@ -86,6 +90,31 @@ namespace
         default: return 0; // default
         }
     }
+
+    // Returns the longest run of plain ASCII characters of the wildcard.
+    // Character sets and everything after them are skipped.
+    QString wildcardLiteral(const QString &wildcard)
+    {
+        int end = wildcard.indexOf('[');
+        if (end < 0)
+            end = wildcard.size();
+
+        int start = 0;
+        QString literal;
+        for (int i = 0; i <= end; ++i) {
+            if (i < end) {
+                const ushort c = wildcard[i].unicode();
+                if ((c < 128) && (c != '*') && (c != '?') && (c != ']') && (c != '\\'))
+                    continue;
+            }
+
+            if ((i - start) > literal.size())
+                literal = wildcard.mid(start, (i - start));
+            start = i + 1;
+        }
+
+        return literal;
+    }
 }
 
 const QString Str_Name(QStringLiteral("name"));
@@ -105,6 +134,21 @@ const QString Str_PreviouslyMatched(QStringLiteral("previouslyMatchedEpisodes"))
 
 namespace RSS
 {
+    struct EpisodeFilterItem
+    {
+        enum Kind
+        {
+            SingleNumber,
+            Range,
+            InfiniteRange
+        };
+
+        Kind kind;
+        int first;
+        int last;
+        QRegularExpression regex; // single number only
+    };
+
     struct AutoDownloadRuleData : public QSharedData
     {
         QString name;
@@ -126,7 +170,15 @@ namespace RSS
         QStringList previouslyMatchedEpisodes;
 
         mutable QString lastComputedEpisode;
-        mutable QHash<QString, QRegularExpression> cachedRegexes;
+
+        // Expressions compiled on first use. They are dropped whenever the regex/wildcard,
+        // must or must not contain fields or episode filter are modified.
+        mutable bool compiled = false;
+        mutable QVector<QVector<QRegularExpression>> mustContainRegexes;
+        mutable QVector<QVector<QRegularExpression>> mustNotContainRegexes;
+        mutable bool episodeFilterValid = false;
+        mutable int episodeFilterSeason = 0;
+        mutable QVector<EpisodeFilterItem> episodeFilterItems;
 
         bool operator==(const AutoDownloadRuleData &other) const
         {
@@ -186,109 +238,47 @@ AutoDownloadRule::AutoDownloadRule(const AutoDownloadRule &other)
 
 AutoDownloadRule::~AutoDownloadRule() {}
 
-QRegularExpression AutoDownloadRule::cachedRegex(const QString &expression, bool isRegex) const
-{
-    // Use a cache of regexes so we don't have to continually recompile - big performance increase.
-    // The cache is cleared whenever the regex/wildcard, must or must not contain fields or
-    // episode filter are modified.
-    Q_ASSERT(!expression.isEmpty());
-    QRegularExpression regex(m_dataPtr->cachedRegexes[expression]);
-
-    if (!regex.pattern().isEmpty())
-        return regex;
-
-    return m_dataPtr->cachedRegexes[expression] = QRegularExpression(isRegex ? expression : Utils::String::wildcardToRegex(expression), QRegularExpression::CaseInsensitiveOption);
-}
-
-bool AutoDownloadRule::matches(const QString &articleTitle, const QString &expression) const
-{
-    static QRegularExpression whitespace("\\s+");
-
-    if (expression.isEmpty()) {
-        // A regex of the form "expr|" will always match, so do the same for wildcards
-        return true;
-    }
-    else if (m_dataPtr->useRegex) {
-        QRegularExpression reg(cachedRegex(expression));
-        return reg.match(articleTitle).hasMatch();
-    }
-    else {
-        // Only match if every wildcard token (separated by spaces) is present in the article name.
-        // Order of wildcard tokens is unimportant (if order is important, they should have used *).
-        foreach (const QString &wildcard, expression.split(whitespace, QString::SplitBehavior::SkipEmptyParts)) {
-            QRegularExpression reg(cachedRegex(wildcard, false));
-
-            if (!reg.match(articleTitle).hasMatch())
-                return false;
-        }
-    }
-
-    return true;
-}
-
-bool AutoDownloadRule::matches(const QString &articleTitle) const
+void AutoDownloadRule::compileExpressions() const
 {
-    // Reset the lastComputedEpisode, we don't want to leak it between matches
-    m_dataPtr->lastComputedEpisode.clear();
-
-    if (!m_dataPtr->mustContain.empty()) {
-        bool logged = false;
-        bool foundMustContain = false;
-
-        // Each expression is either a regex, or a set of wildcards separated by whitespace.
-        // Accept if any complete expression matches.
-        foreach (const QString &expression, m_dataPtr->mustContain) {
-            if (!logged) {
-//                qDebug() << "Checking matching" << (m_dataPtr->useRegex ? "regex:" : "wildcard expressions:") << m_dataPtr->mustContain.join("|");
-                logged = true;
-            }
+    // Compile all the expressions at once so we don't have to split and recompile them
+    // for every article - big performance increase.
+    static const QRegularExpression whitespace("\\s+");
+    static const QRegularExpression episodeFilterRegex("(^\\d{1,4})x(.*;$)", QRegularExpression::CaseInsensitiveOption);
 
+    const auto compileExpression = [this](const QString &expression)
+    {
+        QVector<QRegularExpression> regexes;
+        if (expression.isEmpty()) {
             // A regex of the form "expr|" will always match, so do the same for wildcards
-            foundMustContain = matches(articleTitle, expression);
-
-            if (foundMustContain) {
-//                qDebug() << "Found matching" << (m_dataPtr->useRegex ? "regex:" : "wildcard expression:") << expression;
-                break;
-            }
         }
-
-        if (!foundMustContain)
-            return false;
-    }
-
-    if (!m_dataPtr->mustNotContain.empty()) {
-        bool logged = false;
-
-        // Each expression is either a regex, or a set of wildcards separated by whitespace.
-        // Reject if any complete expression matches.
-        foreach (const QString &expression, m_dataPtr->mustNotContain) {
-            if (!logged) {
-//                qDebug() << "Checking not matching" << (m_dataPtr->useRegex ? "regex:" : "wildcard expressions:") << m_dataPtr->mustNotContain.join("|");
-                logged = true;
-            }
-
-            // A regex of the form "expr|" will always match, so do the same for wildcards
-            if (matches(articleTitle, expression)) {
-//                qDebug() << "Found not matching" << (m_dataPtr->useRegex ? "regex:" : "wildcard expression:") << expression;
-                return false;
-            }
+        else if (m_dataPtr->useRegex) {
+            regexes.append(QRegularExpression(expression, QRegularExpression::CaseInsensitiveOption));
         }
-    }
+        else {
+            // Only match if every wildcard token (separated by spaces) is present in the article name.
+            // Order of wildcard tokens is unimportant (if order is important, they should have used *).
+            for (const QString &wildcard : expression.split(whitespace, QString::SplitBehavior::SkipEmptyParts))
+                regexes.append(QRegularExpression(Utils::String::wildcardToRegex(wildcard), QRegularExpression::CaseInsensitiveOption));
+        }
+        return regexes;
+    };
 
-    if (!m_dataPtr->episodeFilter.isEmpty()) {
-//        qDebug() << "Checking episode filter:" << m_dataPtr->episodeFilter;
-        QRegularExpression f(cachedRegex("(^\\d{1,4})x(.*;$)"));
-        QRegularExpressionMatch matcher = f.match(m_dataPtr->episodeFilter);
-        bool matched = matcher.hasMatch();
+    m_dataPtr->mustContainRegexes.clear();
+    for (const QString &expression : qAsConst(m_dataPtr->mustContain))
+        m_dataPtr->mustContainRegexes.append(compileExpression(expression));
 
-        if (!matched)
-            return false;
+    m_dataPtr->mustNotContainRegexes.clear();
+    for (const QString &expression : qAsConst(m_dataPtr->mustNotContain))
+        m_dataPtr->mustNotContainRegexes.append(compileExpression(expression));
 
-        QString s = matcher.captured(1);
-        QStringList eps = matcher.captured(2).split(";");
-        int sOurs = s.toInt();
+    m_dataPtr->episodeFilterItems.clear();
+    const QRegularExpressionMatch matcher = episodeFilterRegex.match(m_dataPtr->episodeFilter);
+    m_dataPtr->episodeFilterValid = matcher.hasMatch();
+    if (m_dataPtr->episodeFilterValid) {
+        const QString s = matcher.captured(1);
+        m_dataPtr->episodeFilterSeason = s.toInt();
 
-        foreach (QString ep, eps) {
+        for (QString ep : matcher.captured(2).split(";")) {
             if (ep.isEmpty())
                 continue;
 
@@ -297,77 +287,117 @@ bool AutoDownloadRule::matches(const QString &articleTitle) const
                 ep = ep.right(ep.size() - 1);
 
             if (ep.indexOf('-') != -1) { // Range detected
-                QString partialPattern1 = "\\bs0?(\\d{1,4})[ -_\\.]?e(0?\\d{1,4})(?:\\D|\\b)";
-                QString partialPattern2 = "\\b(\\d{1,4})x(0?\\d{1,4})(?:\\D|\\b)";
-                QRegularExpression reg(cachedRegex(partialPattern1));
-
                 if (ep.endsWith('-')) { // Infinite range
-                    int epOurs = ep.leftRef(ep.size() - 1).toInt();
-
-                    // Extract partial match from article and compare as digits
-                    matcher = reg.match(articleTitle);
-                    matched = matcher.hasMatch();
-
-                    if (!matched) {
-                        reg = QRegularExpression(cachedRegex(partialPattern2));
-                        matcher = reg.match(articleTitle);
-                        matched = matcher.hasMatch();
-                    }
-
-                    if (matched) {
-                        int sTheirs = matcher.captured(1).toInt();
-                        int epTheirs = matcher.captured(2).toInt();
-                        if (((sTheirs == sOurs) && (epTheirs >= epOurs)) || (sTheirs > sOurs)) {
-//                            qDebug() << "Matched episode:" << ep;
-//                            qDebug() << "Matched article:" << articleTitle;
-                            return true;
-                        }
-                    }
+                    const int epOurs = ep.leftRef(ep.size() - 1).toInt();
+                    m_dataPtr->episodeFilterItems.append(EpisodeFilterItem {EpisodeFilterItem::InfiniteRange, epOurs, epOurs, QRegularExpression()});
                 }
                 else { // Normal range
-                    QStringList range = ep.split('-');
+                    const QStringList range = ep.split('-');
                     Q_ASSERT(range.size() == 2);
-                    if (range.first().toInt() > range.last().toInt())
+                    const int epOursFirst = range.first().toInt();
+                    const int epOursLast = range.last().toInt();
+                    if (epOursFirst > epOursLast)
                         continue; // Ignore this subrule completely
 
-                    int epOursFirst = range.first().toInt();
-                    int epOursLast = range.last().toInt();
-
-                    // Extract partial match from article and compare as digits
-                    matcher = reg.match(articleTitle);
-                    matched = matcher.hasMatch();
-
-                    if (!matched) {
-                        reg = QRegularExpression(cachedRegex(partialPattern2));
-                        matcher = reg.match(articleTitle);
-                        matched = matcher.hasMatch();
-                    }
-
-                    if (matched) {
-                        int sTheirs = matcher.captured(1).toInt();
-                        int epTheirs = matcher.captured(2).toInt();
-                        if ((sTheirs == sOurs) && ((epOursFirst <= epTheirs) && (epOursLast >= epTheirs))) {
-//                            qDebug() << "Matched episode:" << ep;
-//                            qDebug() << "Matched article:" << articleTitle;
-                            return true;
-                        }
-                    }
+                    m_dataPtr->episodeFilterItems.append(EpisodeFilterItem {EpisodeFilterItem::Range, epOursFirst, epOursLast, QRegularExpression()});
                 }
             }
             else { // Single number
-                QString expStr("\\b(?:s0?" + s + "[ -_\\.]?" + "e0?" + ep + "|" + s + "x" + "0?" + ep + ")(?:\\D|\\b)");
-                QRegularExpression reg(cachedRegex(expStr));
-                if (reg.match(articleTitle).hasMatch()) {
-//                    qDebug() << "Matched episode:" << ep;
-//                    qDebug() << "Matched article:" << articleTitle;
-                    return true;
-                }
+                const QString expStr("\\b(?:s0?" + s + "[ -_\\.]?" + "e0?" + ep + "|" + s + "x" + "0?" + ep + ")(?:\\D|\\b)");
+                m_dataPtr->episodeFilterItems.append(EpisodeFilterItem {EpisodeFilterItem::SingleNumber, 0, 0
+                                                      , QRegularExpression(expStr, QRegularExpression::CaseInsensitiveOption)});
             }
         }
+    }
+
+    m_dataPtr->compiled = true;
+}
+
+bool AutoDownloadRule::matchesEpisodeFilter(const QString &articleTitle) const
+{
+    static const QRegularExpression partialRegex1("\\bs0?(\\d{1,4})[ -_\\.]?e(0?\\d{1,4})(?:\\D|\\b)", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression partialRegex2("\\b(\\d{1,4})x(0?\\d{1,4})(?:\\D|\\b)", QRegularExpression::CaseInsensitiveOption);
 
+    if (!m_dataPtr->episodeFilterValid)
         return false;
+
+    // Partial match is extracted from article only once and compared as digits against every range
+    bool partialMatchDone = false;
+    bool partialMatched = false;
+    int sTheirs = 0;
+    int epTheirs = 0;
+
+    for (const EpisodeFilterItem &item : qAsConst(m_dataPtr->episodeFilterItems)) {
+        if (item.kind == EpisodeFilterItem::SingleNumber) {
+            if (item.regex.match(articleTitle).hasMatch()) {
+//                qDebug() << "Matched article:" << articleTitle;
+                return true;
+            }
+            continue;
+        }
+
+        if (!partialMatchDone) {
+            QRegularExpressionMatch matcher = partialRegex1.match(articleTitle);
+            if (!matcher.hasMatch())
+                matcher = partialRegex2.match(articleTitle);
+
+            partialMatchDone = true;
+            partialMatched = matcher.hasMatch();
+            if (partialMatched) {
+                sTheirs = matcher.captured(1).toInt();
+                epTheirs = matcher.captured(2).toInt();
+            }
+        }
+
+        if (!partialMatched)
+            continue;
+
+        const int sOurs = m_dataPtr->episodeFilterSeason;
+        if (item.kind == EpisodeFilterItem::InfiniteRange) {
+            if (((sTheirs == sOurs) && (epTheirs >= item.first)) || (sTheirs > sOurs))
+                return true;
+        }
+        else if ((sTheirs == sOurs) && ((item.first <= epTheirs) && (item.last >= epTheirs))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool AutoDownloadRule::matches(const QString &articleTitle) const
+{
+    // Reset the lastComputedEpisode, we don't want to leak it between matches
+    m_dataPtr->lastComputedEpisode.clear();
+
+    if (!m_dataPtr->compiled)
+        compileExpressions();
+
+    const auto matchesExpression = [&articleTitle](const QVector<QRegularExpression> &regexes)
+    {
+        for (const QRegularExpression &regex : regexes) {
+            if (!regex.match(articleTitle).hasMatch())
+                return false;
+        }
+        return true;
+    };
+
+    if (!m_dataPtr->mustContainRegexes.empty()) {
+        // Each expression is either a regex, or a set of wildcards separated by whitespace.
+        // Accept if any complete expression matches.
+        const bool foundMustContain = std::any_of(m_dataPtr->mustContainRegexes.cbegin()
+                                                  , m_dataPtr->mustContainRegexes.cend(), matchesExpression);
+        if (!foundMustContain)
+            return false;
     }
 
+    // Reject if any complete expression matches.
+    if (std::any_of(m_dataPtr->mustNotContainRegexes.cbegin(), m_dataPtr->mustNotContainRegexes.cend(), matchesExpression))
+        return false;
+
+    if (!m_dataPtr->episodeFilter.isEmpty())
+        return matchesEpisodeFilter(articleTitle);
+
     if (useSmartFilter()) {
         // now see if this episode has been downloaded before
         const QString episodeStr = computeEpisodeName(articleTitle);
@@ -386,6 +416,35 @@ bool AutoDownloadRule::matches(const QString &articleTitle) const
     return true;
 }
 
+QStringList AutoDownloadRule::mustContainLiterals() const
+{
+    // Every wildcard token is a plain substring search, so any matching title contains
+    // the literal parts of all the tokens of one of the must contain expressions.
+    static const QRegularExpression whitespace("\\s+");
+
+    if (m_dataPtr->useRegex || m_dataPtr->mustContain.isEmpty())
+        return {};
+
+    QStringList literals;
+    for (const QString &expression : qAsConst(m_dataPtr->mustContain)) {
+        QString longestLiteral;
+        for (const QString &wildcard : expression.split(whitespace, QString::SplitBehavior::SkipEmptyParts)) {
+            const QString literal = wildcardLiteral(wildcard);
+            if (literal.size() > longestLiteral.size())
+                longestLiteral = literal;
+        }
+
+        // The expression accepts titles without any known substring
+        if (longestLiteral.isEmpty())
+            return {};
+
+        literals.append(longestLiteral.toCaseFolded());
+    }
+
+    literals.removeDuplicates();
+    return literals;
+}
+
 AutoDownloadRule &AutoDownloadRule::operator=(const AutoDownloadRule &other)
 {
     m_dataPtr = other.m_dataPtr;
@@ -495,7 +554,7 @@ AutoDownloadRule AutoDownloadRule::fromLegacyDict(const QVariantHash &dict)
 
 void AutoDownloadRule::setMustContain(const QString &tokens)
 {
-    m_dataPtr->cachedRegexes.clear();
+    m_dataPtr->compiled = false;
 
     if (m_dataPtr->useRegex)
         m_dataPtr->mustContain = QStringList() << tokens;
@@ -509,7 +568,7 @@ void AutoDownloadRule::setMustContain(const QString &tokens)
 
 void AutoDownloadRule::setMustNotContain(const QString &tokens)
 {
-    m_dataPtr->cachedRegexes.clear();
+    m_dataPtr->compiled = false;
 
     if (m_dataPtr->useRegex)
         m_dataPtr->mustNotContain = QStringList() << tokens;
@@ -629,7 +688,7 @@ bool AutoDownloadRule::useRegex() const
 void AutoDownloadRule::setUseRegex(bool enabled)
 {
     m_dataPtr->useRegex = enabled;
-    m_dataPtr->cachedRegexes.clear();
+    m_dataPtr->compiled = false;
 }
 
 QStringList AutoDownloadRule::previouslyMatchedEpisodes() const
@@ -659,5 +718,5 @@ QString AutoDownloadRule::episodeFilter() const
 void AutoDownloadRule::setEpisodeFilter(const QString &e)
 {
     m_dataPtr->episodeFilter = e;
-    m_dataPtr->cachedRegexes.clear();
+    m_dataPtr->compiled = false;
 }
@@ -34,7 +34,6 @@
 #include <QVariant>
 
 class QJsonObject;
-class QRegularExpression;
 class TriStateBool;
 
 namespace RSS
@@ -83,6 +82,7 @@ namespace RSS
         void setCategory(const QString &category);
 
         bool matches(const QString &articleTitle) const;
+        QStringList mustContainLiterals() const;
 
         AutoDownloadRule &operator=(const AutoDownloadRule &other);
         bool operator==(const AutoDownloadRule &other) const;
@@ -95,8 +95,8 @@ namespace RSS
         static AutoDownloadRule fromLegacyDict(const QVariantHash &dict);
 
     private:
-        bool matches(const QString &articleTitle, const QString &expression) const;
-        QRegularExpression cachedRegex(const QString &expression, bool isRegex = true) const;
+        void compileExpressions() const;
+        bool matchesEpisodeFilter(const QString &articleTitle) const;
 
         QSharedDataPointer<AutoDownloadRuleData> m_dataPtr;
     };
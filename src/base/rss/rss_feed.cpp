@@ -33,6 +33,7 @@
 #include <QCryptographicHash>
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -57,6 +58,49 @@ const QString Str_IsLoading(QStringLiteral("isLoading"));
 const QString Str_HasError(QStringLiteral("hasError"));
 const QString Str_Articles(QStringLiteral("articles"));
 
+namespace
+{
+    // Article changes are appended to a log, one record per line:
+    //   <JSON object>\t<unread count after the change>
+    // The log is folded into the data file once it grows too long.
+    const QString LogKey_Type(QStringLiteral("type"));
+    const QString LogKey_Article(QStringLiteral("article"));
+    const QString LogKey_GUID(QStringLiteral("guid"));
+    const QString LogKey_Generation(QStringLiteral("generation"));
+    const QString LogType_State(QStringLiteral("state"));
+    const QString LogType_Add(QStringLiteral("add"));
+    const QString LogType_Read(QStringLiteral("read"));
+    const QString LogType_ReadAll(QStringLiteral("readAll"));
+
+    const int MIN_LOG_RECORDS_TO_COMPACT = 100;
+
+    // The data file ends with a marker object which isn't an article (so older versions skip it)
+    // holding the generation of the data file
+    const QString DataKey_Generation(QStringLiteral("generation"));
+
+    // HTTP validators and update statistics are kept in a small separate file
+    const QString FetchKey_ETag(QStringLiteral("etag"));
+    const QString FetchKey_LastModified(QStringLiteral("lastModified"));
+    const QString FetchKey_LastChange(QStringLiteral("lastChange"));
+    const QString FetchKey_ChangeInterval(QStringLiteral("changeInterval"));
+
+    // the periodic refresh skips a rarely updated feed for up to this many refresh intervals
+    const int MAX_REFRESH_DELAY_FACTOR = 8;
+    // the refresh timer may fire a bit earlier than the feed is due
+    const int REFRESH_TOLERANCE = 30; // seconds
+
+    QByteArray logRecord(const QString &type, const int unreadCount, const QString &key = QString(), const QJsonValue &value = QJsonValue())
+    {
+        QJsonObject jsonObj;
+        jsonObj.insert(LogKey_Type, type);
+        if (!key.isEmpty())
+            jsonObj.insert(key, value);
+
+        return QJsonDocument(jsonObj).toJson(QJsonDocument::Compact)
+                + '\t' + QByteArray::number(unreadCount) + '\n';
+    }
+}
+
 using namespace RSS;
 
 Feed::Feed(const QString &url, const QString &path, Session *session)
@@ -65,9 +109,11 @@ Feed::Feed(const QString &url, const QString &path, Session *session)
     , m_url(url)
 {
     m_dataFileName = QString("%1.json").arg(Utils::Fs::toValidFileSystemName(m_url, false, QLatin1String("_")));
+    m_logFileName = QString("%1.log").arg(Utils::Fs::toValidFileSystemName(m_url, false, QLatin1String("_")));
+    m_fetchStateFileName = QString("%1.fetch.json").arg(Utils::Fs::toValidFileSystemName(m_url, false, QLatin1String("_")));
 
     m_parser = new Private::Parser(m_lastBuildDate);
-    m_parser->moveToThread(m_session->workingThread());
+    m_parser->moveToThread(m_session->parsingThread());
     connect(this, &Feed::destroyed, m_parser, &Private::Parser::deleteLater);
     connect(m_parser, &Private::Parser::finished, this, &Feed::handleParsingFinished);
 
@@ -104,9 +150,12 @@ void Feed::markAsRead()
         }
     }
 
+    // articles which aren't loaded yet are marked by the log replay
+    if (!m_articlesLoaded)
+        m_unreadCount = 0;
+
     if (m_unreadCount != oldUnreadCount) {
-        m_dirty = true;
-        store();
+        appendToLog(logRecord(LogType_ReadAll, m_unreadCount), 1);
         emit unreadCountChanged(this);
     }
 }
@@ -117,11 +166,25 @@ void Feed::refresh()
 
     // NOTE: Should we allow manually refreshing for disabled session?
 
-    Net::DownloadHandler *handler = Net::DownloadManager::instance()->downloadUrl(m_url);
+    // send the validators of the last response so the server can reply with "304 Not Modified"
+    QHash<QByteArray, QByteArray> headers;
+    if (!m_eTag.isEmpty())
+        headers.insert("If-None-Match", m_eTag);
+    if (!m_lastModified.isEmpty())
+        headers.insert("If-Modified-Since", m_lastModified);
+
+    Net::DownloadHandler *handler = Net::DownloadManager::instance()->downloadUrl(m_url, false, 0, false, "", headers);
     connect(handler
             , static_cast<void (Net::DownloadHandler::*)(const QString &, const QByteArray &)>(&Net::DownloadHandler::downloadFinished)
-            , this, &Feed::handleDownloadFinished);
+            , this, [this, handler](const QString &url, const QByteArray &data)
+    {
+        // the validators are applied once the data is successfully parsed
+        m_newETag = handler->rawHeader("ETag");
+        m_newLastModified = handler->rawHeader("Last-Modified");
+        handleDownloadFinished(url, data);
+    });
     connect(handler, &Net::DownloadHandler::downloadFailed, this, &Feed::handleDownloadFailed);
+    connect(handler, &Net::DownloadHandler::downloadNotModified, this, &Feed::handleDownloadNotModified);
 
     m_isLoading = true;
     emit stateChanged(this);
@@ -159,9 +222,15 @@ Article *Feed::articleByGUID(const QString &guid) const
 
 void Feed::handleMaxArticlesPerFeedChanged(int n)
 {
+    // not loaded articles are trimmed when loading
+    if (!m_articlesLoaded) return;
+
+    const int oldUnreadCount = m_unreadCount;
     while (m_articlesByDate.size() > n)
         removeOldestArticle();
-    // We don't need store articles here
+    // We don't need store articles here, only the unread count
+    if (m_unreadCount != oldUnreadCount)
+        appendToLog(logRecord(LogType_State, m_unreadCount), 1);
 }
 
 void Feed::handleIconDownloadFinished(const QString &url, const QString &filePath)
@@ -192,6 +261,20 @@ void Feed::handleDownloadFailed(const QString &url, const QString &error)
     LogMsg(tr("Failed to download RSS feed at '%1'. Reason: %2").arg(url, error)
            , Log::WARNING);
 
+    // try again on the next periodic refresh
+    m_nextRefreshTime = QDateTime();
+
+    emit stateChanged(this);
+}
+
+void Feed::handleDownloadNotModified(const QString &url)
+{
+    qDebug() << "RSS feed at" << url << "is not modified";
+
+    m_isLoading = false;
+    m_hasError = false;
+    updateRefreshSchedule(false);
+
     emit stateChanged(this);
 }
 
@@ -211,20 +294,43 @@ void Feed::handleParsingFinished(const RSS::Private::ParsingResult &result)
 
         m_lastBuildDate = result.lastBuildDate;
 
+        // the existing articles are needed to find out which ones are new
+        loadArticles();
+
         int newArticlesCount = 0;
-        for (const QVariantHash &varHash : result.articles) {
+        QByteArray logRecords;
+        for (const Private::ParsedArticle &parsedArticle : result.articles) {
+            // skip the known articles before building an Article object for them
+            if (m_articles.contains(parsedArticle.guid))
+                continue;
+
             try {
-                auto article = new Article(this, varHash);
-                if (addArticle(article))
+                auto article = new Article(this, parsedArticle.toVariantHash());
+                if (addArticle(article)) {
                     ++newArticlesCount;
-                else
+                    logRecords += logRecord(LogType_Add, m_unreadCount, LogKey_Article, article->toJsonObject());
+                }
+                else {
                     delete article;
+                }
             }
             catch (const std::runtime_error&) {}
         }
 
-        m_dirty = (newArticlesCount > 0);
-        store();
+        if (newArticlesCount > 0)
+            appendToLog(logRecords, newArticlesCount);
+
+        updateRefreshSchedule(newArticlesCount > 0);
+        if (m_hasError) {
+            // partially parsed feed should be downloaded unconditionally next time
+            m_newETag.clear();
+            m_newLastModified.clear();
+        }
+        if ((newArticlesCount > 0) || (m_newETag != m_eTag) || (m_newLastModified != m_lastModified)) {
+            m_eTag = m_newETag;
+            m_lastModified = m_newLastModified;
+            storeFetchState();
+        }
 
         LogMsg(tr("RSS feed at '%1' updated. Added %2 new articles.")
                .arg(m_url, QString::number(newArticlesCount)));
@@ -233,6 +339,8 @@ void Feed::handleParsingFinished(const RSS::Private::ParsingResult &result)
     if (m_hasError) {
         LogMsg(tr("Failed to parse RSS feed at '%1'. Reason: %2").arg(m_url, result.error)
                , Log::WARNING);
+        if (result.articles.isEmpty())
+            m_nextRefreshTime = QDateTime();
     }
 
     m_isLoading = false;
@@ -241,25 +349,53 @@ void Feed::handleParsingFinished(const RSS::Private::ParsingResult &result)
 
 void Feed::load()
 {
+    loadFetchState();
+
     QFile file(m_session->dataFileStorage()->storageDir().absoluteFilePath(m_dataFileName));
 
     if (!file.exists()) {
         loadArticlesLegacy();
+        m_articlesLoaded = true;
         m_dirty = true;
         store(); // convert to new format
     }
-    else if (file.open(QFile::ReadOnly)) {
-        loadArticles(file.readAll());
-        file.close();
+    else if (!readUnreadCountFromLog()) {
+        // data stored by an older version or an incomplete log,
+        // load everything once and start a new log
+        loadArticles();
+        m_dirty = true;
+        store();
     }
-    else {
-        LogMsg(tr("Couldn't read RSS Session data from %1. Error: %2")
-               .arg(m_dataFileName, file.errorString())
-               , Log::WARNING);
+}
+
+void Feed::loadArticles()
+{
+    if (m_articlesLoaded) return;
+
+    m_articlesLoaded = true;
+    const int oldUnreadCount = m_unreadCount;
+    m_unreadCount = 0;
+
+    // the files are read by the storage thread once the changes queued so far are written
+    AsyncFileStorage *const storage = m_session->dataFileStorage();
+    const QByteArray data = storage->read(m_dataFileName);
+    if (!data.isEmpty())
+        readArticles(data);
+    else if (QFileInfo(storage->storageDir().absoluteFilePath(m_dataFileName)).size() > 0)
+        LogMsg(tr("Couldn't read RSS Session data from %1.").arg(m_dataFileName), Log::WARNING);
+
+    const bool isLogValid = replayLog(storage->read(m_logFileName));
+
+    if (m_unreadCount != oldUnreadCount)
+        emit unreadCountChanged(this);
+
+    if (!isLogValid || (m_logRecordCount > qMax(MIN_LOG_RECORDS_TO_COMPACT, m_articles.size()))) {
+        m_dirty = true;
+        storeDeferred();
     }
 }
 
-void Feed::loadArticles(const QByteArray &data)
+void Feed::readArticles(const QByteArray &data)
 {
     QJsonParseError jsonError;
     QJsonDocument jsonDoc = QJsonDocument::fromJson(data, &jsonError);
@@ -284,15 +420,104 @@ void Feed::loadArticles(const QByteArray &data)
             continue;
         }
 
+        const QJsonObject jsonObj = jsonVal.toObject();
+        if (jsonObj.contains(DataKey_Generation)) {
+            m_generation = jsonObj.value(DataKey_Generation).toInt();
+            continue;
+        }
+
         try {
-            auto article = new Article(this, jsonVal.toObject());
-            if (!addArticle(article))
+            auto article = new Article(this, jsonObj);
+            if (!addArticle(article, false))
                 delete article;
         }
         catch (const std::runtime_error&) {}
     }
 }
 
+// Returns false if the log doesn't belong to the data file
+bool Feed::replayLog(const QByteArray &data)
+{
+    m_logRecordCount = 0;
+    bool isFirstRecord = true;
+    int lineStart = 0;
+    while (lineStart < data.size()) {
+        const int lineEnd = data.indexOf('\n', lineStart);
+        if (lineEnd < 0)
+            break; // the last record was not completely written
+
+        const int separator = data.lastIndexOf('\t', lineEnd);
+        const int recordStart = lineStart;
+        lineStart = lineEnd + 1;
+        ++m_logRecordCount;
+        if (separator < recordStart)
+            continue;
+
+        const QJsonObject jsonObj = QJsonDocument::fromJson(
+                    data.mid(recordStart, (separator - recordStart))).object();
+
+        // The log is replaced right after the data file. If that didn't happen (e.g. a crash
+        // in between) its records are already in the data file, and replaying a stale "readAll"
+        // would mark the articles added after it as read.
+        if (isFirstRecord) {
+            isFirstRecord = false;
+            if (jsonObj.value(LogKey_Generation).toInt() != m_generation) {
+                LogMsg(tr("Outdated RSS article log of '%1' was ignored.").arg(m_url), Log::WARNING);
+                return false;
+            }
+        }
+
+        const QString type = jsonObj.value(LogKey_Type).toString();
+        if (type == LogType_Add) {
+            try {
+                auto article = new Article(this, jsonObj.value(LogKey_Article).toObject());
+                if (!addArticle(article, false))
+                    delete article;
+            }
+            catch (const std::runtime_error&) {}
+        }
+        else if ((type == LogType_Read) || (type == LogType_ReadAll)) {
+            const QList<Article *> articles = (type == LogType_Read)
+                    ? QList<Article *> {m_articles.value(jsonObj.value(LogKey_GUID).toString())}
+                    : m_articlesByDate;
+            for (Article *article : articles) {
+                if (article && !article->isRead()) {
+                    article->disconnect(this);
+                    article->markAsRead();
+                    --m_unreadCount;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Feed::readUnreadCountFromLog()
+{
+    // the unread count is at the end of the last record
+    QFile file(m_session->dataFileStorage()->storageDir().absoluteFilePath(m_logFileName));
+    if (!file.open(QFile::ReadOnly) || (file.size() < 2))
+        return false;
+
+    file.seek(qMax<qint64>(0, (file.size() - 32)));
+    const QByteArray tail = file.readAll();
+    if (!tail.endsWith('\n'))
+        return false;
+
+    const int separator = tail.lastIndexOf('\t');
+    if (separator < 0)
+        return false;
+
+    bool ok = false;
+    const int unreadCount = tail.mid(separator + 1, (tail.size() - separator - 2)).toInt(&ok);
+    if (!ok || (unreadCount < 0))
+        return false;
+
+    m_unreadCount = unreadCount;
+    return true;
+}
+
 void Feed::loadArticlesLegacy()
 {
     SettingsPtr qBTRSSFeeds = Profile::instance().applicationSettings(QStringLiteral("qBittorrent-rss-feeds"));
@@ -306,13 +531,14 @@ void Feed::loadArticlesLegacy()
         hash[Article::KeyIsRead] = hash.take(QLatin1String("read"));
         try {
             auto article = new Article(this, hash);
-            if (!addArticle(article))
+            if (!addArticle(article, false))
                 delete article;
         }
         catch (const std::runtime_error&) {}
     }
 }
 
+// Writes all the articles to the data file and starts a new log
 void Feed::store()
 {
     if (!m_dirty) return;
@@ -320,11 +546,21 @@ void Feed::store()
     m_dirty = false;
     m_savingTimer.stop();
 
+    if (!m_articlesLoaded) return;
+
+    ++m_generation;
+
     QJsonArray jsonArr;
     foreach (Article *article, m_articles)
         jsonArr << article->toJsonObject();
+    jsonArr << QJsonObject {{DataKey_Generation, m_generation}};
 
+    // both are written by the storage thread in this order so the log
+    // is replaced only after the data file which contains its changes
     m_session->dataFileStorage()->store(m_dataFileName, QJsonDocument(jsonArr).toJson());
+    m_session->dataFileStorage()->store(m_logFileName
+        , logRecord(LogType_State, m_unreadCount, LogKey_Generation, m_generation));
+    m_logRecordCount = 1;
 }
 
 void Feed::storeDeferred()
@@ -333,7 +569,77 @@ void Feed::storeDeferred()
         m_savingTimer.start(5 * 1000, this);
 }
 
-bool Feed::addArticle(Article *article)
+void Feed::appendToLog(const QByteArray &records, const int recordCount)
+{
+    m_session->dataFileStorage()->append(m_logFileName, records);
+    m_logRecordCount += recordCount;
+
+    // compact the log in the storage thread when it gets longer than the data itself
+    if (m_articlesLoaded && (m_logRecordCount > qMax(MIN_LOG_RECORDS_TO_COMPACT, m_articles.size()))) {
+        m_dirty = true;
+        storeDeferred();
+    }
+}
+
+void Feed::loadFetchState()
+{
+    QFile file(m_session->dataFileStorage()->storageDir().absoluteFilePath(m_fetchStateFileName));
+    if (!file.open(QFile::ReadOnly))
+        return;
+
+    const QJsonObject jsonObj = QJsonDocument::fromJson(file.readAll()).object();
+    m_eTag = jsonObj.value(FetchKey_ETag).toString().toLatin1();
+    m_lastModified = jsonObj.value(FetchKey_LastModified).toString().toLatin1();
+    m_lastChangeTime = QDateTime::fromString(jsonObj.value(FetchKey_LastChange).toString(), Qt::ISODate);
+    m_changeInterval = qMax<qint64>(0, jsonObj.value(FetchKey_ChangeInterval).toDouble());
+}
+
+void Feed::storeFetchState()
+{
+    QJsonObject jsonObj;
+    if (!m_eTag.isEmpty())
+        jsonObj.insert(FetchKey_ETag, QString::fromLatin1(m_eTag));
+    if (!m_lastModified.isEmpty())
+        jsonObj.insert(FetchKey_LastModified, QString::fromLatin1(m_lastModified));
+    if (m_lastChangeTime.isValid())
+        jsonObj.insert(FetchKey_LastChange, m_lastChangeTime.toString(Qt::ISODate));
+    if (m_changeInterval > 0)
+        jsonObj.insert(FetchKey_ChangeInterval, static_cast<double>(m_changeInterval));
+
+    m_session->dataFileStorage()->store(m_fetchStateFileName, QJsonDocument(jsonObj).toJson());
+}
+
+void Feed::updateRefreshSchedule(const bool hasNewArticles)
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    if (hasNewArticles) {
+        if (m_lastChangeTime.isValid()) {
+            const qint64 observedInterval = m_lastChangeTime.secsTo(now);
+            m_changeInterval = ((m_changeInterval > 0)
+                                ? ((3 * m_changeInterval + observedInterval) / 4)
+                                : observedInterval);
+        }
+        m_lastChangeTime = now;
+    }
+
+    // The feed is checked about twice per its expected update interval.
+    // A feed which hasn't been updated for longer than usual is checked even less often.
+    qint64 interval = m_changeInterval;
+    if (m_lastChangeTime.isValid())
+        interval = qMax(interval, m_lastChangeTime.secsTo(now));
+
+    const qint64 minDelay = m_session->refreshInterval() * 60;
+    const qint64 delay = qBound(minDelay, (interval / 2), (MAX_REFRESH_DELAY_FACTOR * minDelay));
+    m_nextRefreshTime = now.addSecs(delay);
+}
+
+bool Feed::isRefreshDue() const
+{
+    return (!m_nextRefreshTime.isValid()
+            || (QDateTime::currentDateTime().secsTo(m_nextRefreshTime) < REFRESH_TOLERANCE));
+}
+
+bool Feed::addArticle(Article *article, const bool notify)
 {
     Q_ASSERT(article);
 
@@ -350,29 +656,38 @@ bool Feed::addArticle(Article *article)
     m_articles[article->guid()] = article;
     m_articlesByDate.insert(lowerBound, article);
     if (!article->isRead()) {
-        increaseUnreadCount();
+        if (notify)
+            increaseUnreadCount();
+        else
+            ++m_unreadCount;
         connect(article, &Article::read, this, &Feed::handleArticleRead);
     }
-    emit newArticle(article);
+    if (notify)
+        emit newArticle(article);
 
     if (m_articlesByDate.size() > maxArticles)
-        removeOldestArticle();
+        removeOldestArticle(notify);
 
     return true;
 }
 
-void Feed::removeOldestArticle()
+void Feed::removeOldestArticle(const bool notify)
 {
     auto oldestArticle = m_articlesByDate.last();
-    emit articleAboutToBeRemoved(oldestArticle);
+    if (notify)
+        emit articleAboutToBeRemoved(oldestArticle);
 
     m_articles.remove(oldestArticle->guid());
     m_articlesByDate.removeLast();
     bool isRead = oldestArticle->isRead();
     delete oldestArticle;
 
-    if (!isRead)
-        decreaseUnreadCount();
+    if (!isRead) {
+        if (notify)
+            decreaseUnreadCount();
+        else
+            --m_unreadCount;
+    }
 }
 
 void Feed::increaseUnreadCount()
@@ -417,7 +732,7 @@ QJsonValue Feed::toJsonValue(bool withData) const
     }
 
     QJsonArray jsonArr;
-    foreach (Article *article, m_articles)
+    foreach (Article *article, articles())
         jsonArr << article->toJsonObject();
 
     QJsonObject jsonObj;
@@ -445,14 +760,14 @@ void Feed::handleArticleRead(Article *article)
     article->disconnect(this);
     decreaseUnreadCount();
     emit articleRead(article);
-    // will be stored deferred
-    m_dirty = true;
-    storeDeferred();
+    appendToLog(logRecord(LogType_Read, m_unreadCount, LogKey_GUID, article->guid()), 1);
 }
 
 void Feed::cleanup()
 {
     Utils::Fs::forceRemove(m_session->dataFileStorage()->storageDir().absoluteFilePath(m_dataFileName));
+    Utils::Fs::forceRemove(m_session->dataFileStorage()->storageDir().absoluteFilePath(m_logFileName));
+    Utils::Fs::forceRemove(m_session->dataFileStorage()->storageDir().absoluteFilePath(m_fetchStateFileName));
 }
 
 void Feed::timerEvent(QTimerEvent *event)
@@ -31,6 +31,7 @@
 #pragma once
 
 #include <QBasicTimer>
+#include <QDateTime>
 #include <QHash>
 #include <QList>
 
@@ -60,6 +61,7 @@ namespace RSS
         ~Feed() override;
 
     public:
+        void loadArticles() override;
         QList<Article *> articles() const override;
         int unreadCount() const override;
         void markAsRead() override;
@@ -86,6 +88,7 @@ namespace RSS
         void handleIconDownloadFinished(const QString &url, const QString &filePath);
         void handleDownloadFinished(const QString &url, const QByteArray &data);
         void handleDownloadFailed(const QString &url, const QString &error);
+        void handleDownloadNotModified(const QString &url);
         void handleParsingFinished(const Private::ParsingResult &result);
         void handleArticleRead(Article *article);
 
@@ -93,15 +96,22 @@ namespace RSS
         void timerEvent(QTimerEvent *event) override;
         void cleanup() override;
         void load();
-        void loadArticles(const QByteArray &data);
+        void readArticles(const QByteArray &data);
         void loadArticlesLegacy();
+        bool replayLog(const QByteArray &data);
+        bool readUnreadCountFromLog();
         void store();
         void storeDeferred();
-        bool addArticle(Article *article);
-        void removeOldestArticle();
+        void appendToLog(const QByteArray &records, int recordCount);
+        bool addArticle(Article *article, bool notify = true);
+        void removeOldestArticle(bool notify = true);
         void increaseUnreadCount();
         void decreaseUnreadCount();
         void downloadIcon();
+        void loadFetchState();
+        void storeFetchState();
+        void updateRefreshSchedule(bool hasNewArticles);
+        bool isRefreshDue() const;
 
         Session *m_session;
         Private::Parser *m_parser;
@@ -115,6 +125,19 @@ namespace RSS
         int m_unreadCount = 0;
         QString m_iconPath;
         QString m_dataFileName;
+        QString m_logFileName;
+        bool m_articlesLoaded = false;
+        int m_logRecordCount = 0;
+        // bumped by every compaction, the log must belong to the same generation as the data file
+        int m_generation = 0;
+        QString m_fetchStateFileName;
+        QByteArray m_eTag;
+        QByteArray m_lastModified;
+        QByteArray m_newETag;
+        QByteArray m_newLastModified;
+        QDateTime m_lastChangeTime;
+        qint64 m_changeInterval = 0; // estimated time between feed updates (in seconds)
+        QDateTime m_nextRefreshTime;
         QBasicTimer m_savingTimer;
         bool m_dirty = false;
     };
@@ -67,6 +67,12 @@ QList<Article *> Folder::articles() const
     return news;
 }
 
+void Folder::loadArticles()
+{
+    foreach (Item *item, items())
+        item->loadArticles();
+}
+
 int Folder::unreadCount() const
 {
     int count = 0;
@@ -48,6 +48,7 @@ namespace RSS
         ~Folder() override;
 
     public:
+        void loadArticles() override;
         QList<Article *> articles() const override;
         int unreadCount() const override;
         void markAsRead() override;
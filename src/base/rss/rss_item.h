@@ -48,6 +48,8 @@ namespace RSS
         friend class Session;
 
     public:
+        // Articles are read from disk on demand, articles() only returns the loaded ones
+        virtual void loadArticles() = 0;
         virtual QList<Article *> articles() const = 0;
         virtual int unreadCount() const = 0;
         virtual void markAsRead() = 0;
@@ -41,6 +41,7 @@
 #include <QVariantHash>
 
 #include "../asyncfilestorage.h"
+#include "../global.h"
 #include "../logger.h"
 #include "../profile.h"
 #include "../settingsstorage.h"
@@ -66,6 +67,7 @@ QPointer<Session> Session::m_instance = nullptr;
 Session::Session()
     : m_processingEnabled(SettingsStorage::instance()->loadValue(SettingsKey_ProcessingEnabled, false).toBool())
     , m_workingThread(new QThread(this))
+    , m_nextParsingThread(0)
     , m_refreshInterval(SettingsStorage::instance()->loadValue(SettingsKey_RefreshInterval, 30).toUInt())
     , m_maxArticlesPerFeed(SettingsStorage::instance()->loadValue(SettingsKey_MaxArticlesPerFeed, 50).toInt())
 {
@@ -95,9 +97,18 @@ Session::Session()
     m_itemsByPath.insert("", new Folder); // root folder
 
     m_workingThread->start();
+
+    const int parsingThreadCount = qMax(1, QThread::idealThreadCount());
+    m_parsingThreads.reserve(parsingThreadCount);
+    for (int i = 0; i < parsingThreadCount; ++i) {
+        auto parsingThread = new QThread(this);
+        parsingThread->start();
+        m_parsingThreads.append(parsingThread);
+    }
+
     load();
 
-    connect(&m_refreshTimer, &QTimer::timeout, this, &Session::refresh);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &Session::handleRefreshTimerTimeout);
     if (m_processingEnabled) {
         m_refreshTimer.start(m_refreshInterval * MsecsPerMin);
         refresh();
@@ -130,7 +141,11 @@ Session::~Session()
     qDebug() << "Deleting RSS Session...";
 
     m_workingThread->quit();
+    for (QThread *parsingThread : qAsConst(m_parsingThreads))
+        parsingThread->quit();
     m_workingThread->wait();
+    for (QThread *parsingThread : qAsConst(m_parsingThreads))
+        parsingThread->wait();
 
     //store();
     delete m_itemsByPath[""]; // deleting root folder
@@ -469,6 +484,13 @@ QThread *Session::workingThread() const
     return m_workingThread;
 }
 
+QThread *Session::parsingThread()
+{
+    QThread *parsingThread = m_parsingThreads[m_nextParsingThread];
+    m_nextParsingThread = (m_nextParsingThread + 1) % m_parsingThreads.size();
+    return parsingThread;
+}
+
 void Session::handleItemAboutToBeDestroyed(Item *item)
 {
     m_itemsByPath.remove(item->path());
@@ -477,6 +499,15 @@ void Session::handleItemAboutToBeDestroyed(Item *item)
         m_feedsByURL.remove(feed->url());
 }
 
+void Session::handleRefreshTimerTimeout()
+{
+    // feeds which are rarely updated are refreshed less often, see Feed::isRefreshDue()
+    foreach (Feed *feed, feeds()) {
+        if (feed->isRefreshDue())
+            feed->refresh();
+    }
+}
+
 void Session::handleFeedTitleChanged(Feed *feed)
 {
     if (feed->name() == feed->url())
@@ -62,6 +62,7 @@
 #include <QPointer>
 #include <QStringList>
 #include <QTimer>
+#include <QVector>
 
 class QThread;
 class Application;
@@ -90,6 +91,9 @@ namespace RSS
         void setProcessingEnabled(bool enabled);
 
         QThread *workingThread() const;
+        // Feeds are spread over a fixed set of threads. Each feed always gets its
+        // articles parsed by the same thread, so its results arrive in order.
+        QThread *parsingThread();
         AsyncFileStorage *confFileStorage() const;
         AsyncFileStorage *dataFileStorage() const;
 
@@ -128,6 +132,7 @@ namespace RSS
     private slots:
         void handleItemAboutToBeDestroyed(Item *item);
         void handleFeedTitleChanged(Feed *feed);
+        void handleRefreshTimerTimeout();
 
     private:
         void load();
@@ -143,6 +148,8 @@ namespace RSS
 
         bool m_processingEnabled;
         QThread *m_workingThread;
+        QVector<QThread *> m_parsingThreads;
+        int m_nextParsingThread;
         AsyncFileStorage *m_confFileStorage;
         AsyncFileStorage *m_dataFileStorage;
         QTimer m_refreshTimer;
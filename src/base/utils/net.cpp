@@ -28,9 +28,185 @@
 
 #include "net.h"
 
+#include <cstring>
+
 #include <QHostAddress>
 #include <QString>
 #include <QStringList>
+#include <QtEndian>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define QBT_IP_PARSER_SSE41
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <smmintrin.h>
+#endif
+
+#if defined(QBT_IP_PARSER_SSE41) && !defined(_MSC_VER)
+#define QBT_TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define QBT_TARGET_SSE41
+#endif
+
+namespace
+{
+    const int MIN_IPV4_LENGTH = 7; // "0.0.0.0"
+    const int MAX_IPV4_LENGTH = 15; // "255.255.255.255"
+    const int MAX_IPV6_LENGTH = 45; // "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255"
+
+    bool parseIPv4Scalar(const char *begin, const char *end, quint32 &address)
+    {
+        quint32 result = 0;
+        const char *i = begin;
+        for (int octetIndex = 0; octetIndex < 4; ++octetIndex) {
+            if ((octetIndex > 0) && ((i == end) || (*(i++) != '.')))
+                return false;
+
+            const char *octetStart = i;
+            uint octet = 0;
+            for (; (i < end) && (*i >= '0') && (*i <= '9'); ++i) {
+                if ((i - octetStart) == 3)
+                    return false;
+                octet = (octet * 10) + (*i - '0');
+            }
+            if ((i == octetStart) || (octet > 255))
+                return false;
+
+            result = (result << 8) | octet;
+        }
+
+        if (i != end)
+            return false;
+
+        address = result;
+        return true;
+    }
+
+#ifdef QBT_IP_PARSER_SSE41
+    bool isSSE41Supported()
+    {
+#ifdef _MSC_VER
+        int cpuInfo[4];
+        __cpuid(cpuInfo, 1);
+        return ((cpuInfo[2] & (1 << 19)) != 0);
+#else
+        __builtin_cpu_init();
+        return (__builtin_cpu_supports("sse4.1") != 0);
+#endif
+    }
+
+    // "value" must not be 0
+    int countTrailingZeros(const uint value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    // pshufb patterns for every combination of octet lengths (1 to 3 digits each).
+    // Lane (4 * octet + n) receives the hundreds (n = 0), tens (n = 1) and ones (n = 2) digit,
+    // lanes without a digit are zeroed.
+    struct ShufflePatterns
+    {
+        ShufflePatterns()
+        {
+            for (int patternIndex = 0; patternIndex < 81; ++patternIndex) {
+                qint8 *pattern = patterns[patternIndex];
+                memset(pattern, -1, 16);
+
+                int octetStart = 0;
+                for (int octetIndex = 0; octetIndex < 4; ++octetIndex) {
+                    int power = 1;
+                    for (int i = octetIndex; i < 3; ++i)
+                        power *= 3;
+                    const int digitCount = ((patternIndex / power) % 3) + 1;
+                    for (int i = 0; i < digitCount; ++i)
+                        pattern[(4 * octetIndex) + (3 - digitCount) + i] = static_cast<qint8>(octetStart + i);
+                    octetStart += digitCount + 1;
+                }
+            }
+        }
+
+        alignas(16) qint8 patterns[81][16];
+    };
+
+    const ShufflePatterns &shufflePatterns()
+    {
+        static const ShufflePatterns instance;
+        return instance;
+    }
+
+    // Classifies all characters at once, gathers the digits of each octet into
+    // its own 32 bit lane with a single shuffle and computes the four octets
+    // with two multiply-adds
+    QBT_TARGET_SSE41 bool parseIPv4SSE41(const char *begin, const int length, const char *bufferEnd, quint32 &address)
+    {
+        __m128i input;
+        if (bufferEnd && ((bufferEnd - begin) >= 16)) {
+            // the bytes past the address are masked out below
+            input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        }
+        else {
+            alignas(16) char buffer[16] = {};
+            memcpy(buffer, begin, length);
+            input = _mm_load_si128(reinterpret_cast<const __m128i *>(buffer));
+        }
+        const __m128i digits = _mm_sub_epi8(input, _mm_set1_epi8('0'));
+
+        const uint lengthMask = (1u << length) - 1;
+        const uint dotMask = static_cast<uint>(_mm_movemask_epi8(_mm_cmpeq_epi8(input, _mm_set1_epi8('.')))) & lengthMask;
+        const uint digitMask = static_cast<uint>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits))) & lengthMask;
+        if ((dotMask | digitMask) != lengthMask)
+            return false;
+
+        // exactly three dots
+        const uint lastDots = dotMask & (dotMask - 1);
+        const uint lastDot = lastDots & (lastDots - 1);
+        if ((lastDot == 0) || ((lastDot & (lastDot - 1)) != 0))
+            return false;
+
+        const int firstDot = countTrailingZeros(dotMask);
+        const int secondDot = countTrailingZeros(lastDots);
+        const int thirdDot = countTrailingZeros(lastDot);
+        const int digitCounts[4] = {firstDot, (secondDot - firstDot - 1), (thirdDot - secondDot - 1), (length - thirdDot - 1)};
+        int patternIndex = 0;
+        for (const int digitCount : digitCounts) {
+            if ((digitCount < 1) || (digitCount > 3))
+                return false;
+            patternIndex = (patternIndex * 3) + (digitCount - 1);
+        }
+
+        const __m128i gathered = _mm_shuffle_epi8(digits
+            , _mm_load_si128(reinterpret_cast<const __m128i *>(shufflePatterns().patterns[patternIndex])));
+        const __m128i weights = _mm_setr_epi8(100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0);
+        const __m128i values = _mm_madd_epi16(_mm_maddubs_epi16(gathered, weights), _mm_set1_epi16(1));
+        if (_mm_movemask_epi8(_mm_cmpgt_epi32(values, _mm_set1_epi32(255))) != 0)
+            return false;
+
+        const __m128i words = _mm_packus_epi32(values, values);
+        const quint32 octets = static_cast<quint32>(_mm_cvtsi128_si32(_mm_packus_epi16(words, words)));
+        address = qFromBigEndian(octets);
+        return true;
+    }
+#endif
+
+    int hexValue(const char c)
+    {
+        if ((c >= '0') && (c <= '9'))
+            return (c - '0');
+        if ((c >= 'a') && (c <= 'f'))
+            return (c - 'a' + 10);
+        if ((c >= 'A') && (c <= 'F'))
+            return (c - 'A' + 10);
+        return -1;
+    }
+}
 
 namespace Utils
 {
@@ -41,6 +217,90 @@ namespace Utils
             return !QHostAddress(ip).isNull();
         }
 
+        bool parseIPv4(const char *begin, const char *end, quint32 &address, const char *bufferEnd)
+        {
+            const int length = static_cast<int>(end - begin);
+            if ((length < MIN_IPV4_LENGTH) || (length > MAX_IPV4_LENGTH))
+                return false;
+
+#ifdef QBT_IP_PARSER_SSE41
+            static const bool useSSE41 = isSSE41Supported();
+            if (useSSE41)
+                return parseIPv4SSE41(begin, length, bufferEnd, address);
+#endif
+            return parseIPv4Scalar(begin, end, address);
+        }
+
+        bool parseIPv6(const char *begin, const char *end, QIPv6Address &address)
+        {
+            const int length = static_cast<int>(end - begin);
+            if ((length < 2) || (length > MAX_IPV6_LENGTH))
+                return false;
+
+            quint8 bytes[16] = {};
+            int byteCount = 0;
+            int gapIndex = -1; // where "::" was found
+            const char *i = begin;
+            if (*i == ':') {
+                if (*(i + 1) != ':')
+                    return false;
+                gapIndex = 0;
+                i += 2;
+            }
+
+            while (i < end) {
+                const char *groupEnd = i;
+                int group = 0;
+                for (; (groupEnd < end) && ((groupEnd - i) < 4); ++groupEnd) {
+                    const int digit = hexValue(*groupEnd);
+                    if (digit < 0) break;
+                    group = (group << 4) | digit;
+                }
+
+                if ((groupEnd < end) && (*groupEnd == '.')) {
+                    // embedded IPv4 address, always the last part
+                    quint32 ipv4 = 0;
+                    if ((byteCount > 12) || !parseIPv4(i, end, ipv4))
+                        return false;
+                    qToBigEndian(ipv4, &bytes[byteCount]);
+                    byteCount += 4;
+                    break;
+                }
+
+                if ((groupEnd == i) || (byteCount == 16))
+                    return false;
+                bytes[byteCount++] = static_cast<quint8>(group >> 8);
+                bytes[byteCount++] = static_cast<quint8>(group & 0xFF);
+
+                i = groupEnd;
+                if (i == end) break;
+                if ((*i != ':') || (++i == end))
+                    return false;
+                if (*i == ':') {
+                    if (gapIndex >= 0)
+                        return false;
+                    gapIndex = byteCount;
+                    ++i;
+                }
+            }
+
+            if (gapIndex < 0) {
+                if (byteCount != 16)
+                    return false;
+            }
+            else {
+                // "::" stands for at least one group
+                if (byteCount > 14)
+                    return false;
+                const int tailSize = byteCount - gapIndex;
+                memmove(&bytes[16 - tailSize], &bytes[gapIndex], tailSize);
+                memset(&bytes[gapIndex], 0, (16 - tailSize - gapIndex));
+            }
+
+            memcpy(address.c, bytes, sizeof(bytes));
+            return true;
+        }
+
         Subnet parseSubnet(const QString &subnetStr, bool *ok)
         {
             const Subnet invalid = qMakePair(QHostAddress(), -1);
@@ -33,6 +33,7 @@
 #include <QPair>
 
 class QHostAddress;
+class QIPv6Address;
 class QString;
 class QStringList;
 
@@ -43,6 +44,13 @@ namespace Utils
         using Subnet = QPair<QHostAddress, int>;
 
         bool isValidIP(const QString &ip);
+        // Fast parsers for textual addresses, IPv4 addresses are returned in host byte order.
+        // Unlike QHostAddress they don't accept scope ids or shortened IPv4 notations,
+        // octets may have leading zeros though ("001.002.003.004").
+        // "bufferEnd" is the end of the readable memory, the IPv4 parser reads
+        // past "end" when there is enough of it which saves a copy.
+        bool parseIPv4(const char *begin, const char *end, quint32 &address, const char *bufferEnd = nullptr);
+        bool parseIPv6(const char *begin, const char *end, QIPv6Address &address);
         Subnet parseSubnet(const QString &subnetStr, bool *ok = nullptr);
         bool canParseSubnet(const QString &subnetStr);
         bool isLoopbackAddress(const QHostAddress &addr);
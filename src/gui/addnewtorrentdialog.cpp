@@ -750,7 +750,7 @@ void AddNewTorrentDialog::setupTreeview()
         connect(m_ui->contentTreeView, &QWidget::customContextMenuRequested, this, &AddNewTorrentDialog::displayContentTreeMenu);
 
         // List files in torrent
-        m_contentModel->model()->setupModelData(m_torrentInfo);
+        m_contentModel->model()->setupModelData(BitTorrent::FileTree(m_torrentInfo));
         if (!m_headerState.isEmpty())
             m_ui->contentTreeView->header()->restoreState(m_headerState);
 
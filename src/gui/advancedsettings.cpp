@@ -57,6 +57,7 @@ enum AdvSettingsRows
     NETWORK_LISTEN_IPV6,
     // behavior
     SAVE_RESUME_DATA_INTERVAL,
+    RESUME_DATA_DATABASE,
     CONFIRM_RECHECK_TORRENT,
     RECHECK_COMPLETED,
 #if defined(Q_OS_WIN) || defined(Q_OS_MAC)
@@ -157,6 +158,8 @@ void AdvancedSettings::saveAdvancedSettings()
     session->setSendBufferWatermarkFactor(spinSendBufferWatermarkFactor.value());
     // Save resume data interval
     session->setSaveResumeDataInterval(spin_save_resume_data_interval.value());
+    // Resume data storage
+    session->setResumeDataDatabaseEnabled(cbResumeDataDatabase.isChecked());
     // Outgoing ports
     session->setOutgoingPortsMin(outgoing_ports_min.value());
     session->setOutgoingPortsMax(outgoing_ports_max.value());
@@ -351,6 +354,9 @@ void AdvancedSettings::loadAdvancedSettings()
     spin_save_resume_data_interval.setValue(session->saveResumeDataInterval());
     spin_save_resume_data_interval.setSuffix(tr(" m", " minutes"));
     addRow(SAVE_RESUME_DATA_INTERVAL, tr("Save resume data interval", "How often the fastresume file is saved."), &spin_save_resume_data_interval);
+    // Resume data storage
+    cbResumeDataDatabase.setChecked(session->isResumeDataDatabaseEnabled());
+    addRow(RESUME_DATA_DATABASE, tr("Store resume data in a single file (requires restart)"), &cbResumeDataDatabase);
     // Outgoing port Min
     outgoing_ports_min.setMinimum(0);
     outgoing_ports_min.setMaximum(65535);
@@ -342,7 +342,7 @@ void PropertiesWidget::loadTorrentInfos(BitTorrent::TorrentHandle *const torrent
         m_ui->labelCreatedByVal->setText(m_torrent->creator().toHtmlEscaped());
 
         // List files in torrent
-        m_propListModel->model()->setupModelData(m_torrent->info());
+        m_propListModel->model()->setupModelData(m_torrent->fileTree());
         if (m_propListModel->model()->rowCount() == 1)
             m_ui->filesList->setExpanded(m_propListModel->index(0, 0), true);
 
@@ -478,7 +478,7 @@ void PropertiesWidget::loadDynamicData()
                 // Progress
                 qreal progress = m_torrent->progress() * 100.;
                 m_ui->labelProgressVal->setText(Utils::String::fromDouble(progress, 1) + "%");
-                m_downloadedPieces->setProgress(m_torrent->pieces(), m_torrent->downloadingPieces());
+                m_downloadedPieces->setProgress(m_torrent->pieces().toBitArray(), m_torrent->downloadingPieces());
             }
             else {
                 showPiecesAvailability(false);
@@ -68,6 +68,7 @@ void ArticleListWidget::setRSSItem(RSS::Item *rssItem, bool unreadOnly)
         connect(m_rssItem, &RSS::Item::articleRead, this, &ArticleListWidget::handleArticleRead);
         connect(m_rssItem, &RSS::Item::articleAboutToBeRemoved, this, &ArticleListWidget::handleArticleAboutToBeRemoved);
 
+        rssItem->loadArticles();
         foreach (auto article, rssItem->articles()) {
             if (!(m_unreadOnly && article->isRead())) {
                 auto item = createItem(article);
@@ -580,6 +580,7 @@ void AutomatedRssDownloader::updateMatchingArticles()
             if (!feed) continue; // feed doesn't exists
 
             QStringList matchingArticles;
+            feed->loadArticles();
             foreach (auto article, feed->articles())
                 if (rule.matches(article->title()))
                     matchingArticles << article->title();
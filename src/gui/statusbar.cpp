@@ -148,6 +148,8 @@ StatusBar::StatusBar(QWidget *parent)
     m_DHTLbl->setVisible(session->isDHTEnabled());
     refresh();
     connect(session, &BitTorrent::Session::statsUpdated, this, &StatusBar::refresh);
+    connect(session, &BitTorrent::Session::torrentsLoadingProgress, this, &StatusBar::showTorrentsLoadingProgress);
+    connect(session, &BitTorrent::Session::torrentsLoaded, this, &QStatusBar::clearMessage);
 }
 
 StatusBar::~StatusBar()
@@ -220,6 +222,11 @@ void StatusBar::updateSpeedLabels()
     m_upSpeedLbl->setText(speedLbl);
 }
 
+void StatusBar::showTorrentsLoadingProgress(int loaded, int total)
+{
+    showMessage(tr("Loading torrents: %1/%2").arg(loaded).arg(total));
+}
+
 void StatusBar::refresh()
 {
     updateConnectionStatus();
@@ -57,6 +57,7 @@ public slots:
 
 private slots:
     void refresh();
+    void showTorrentsLoadingProgress(int loaded, int total);
     void updateAltSpeedsBtn(bool alternative);
     void capDownloadSpeed();
     void capUploadSpeed();
@@ -257,8 +257,8 @@ void TorrentContentModel::updateFilesAvailability(const QVector<qreal> &fa)
     emit layoutAboutToBeChanged();
     for (int i = 0; i < fa.size(); ++i)
         m_filesIndex[i]->setAvailability(fa[i]);
-    // Update folders progress in the tree
-    m_rootItem->recalculateProgress();
+    // Update folders availability in the tree
+    m_rootItem->recalculateAvailability();
     emit dataChanged(index(0, 0), index(rowCount(), columnCount()));
 }
 
@@ -456,10 +456,10 @@ void TorrentContentModel::clear()
     endResetModel();
 }
 
-void TorrentContentModel::setupModelData(const BitTorrent::TorrentInfo &info)
+void TorrentContentModel::setupModelData(const BitTorrent::FileTree &files)
 {
     qDebug("setup model data called");
-    const int filesCount = info.filesCount();
+    const int filesCount = files.filesCount();
     if (filesCount <= 0)
         return;
 
@@ -468,26 +468,47 @@ void TorrentContentModel::setupModelData(const BitTorrent::TorrentInfo &info)
     qDebug("Torrent contains %d files", filesCount);
     m_filesIndex.reserve(filesCount);
 
-    TorrentContentModelFolder* currentParent;
-    // Iterate over files
-    for (int i = 0; i < filesCount; ++i) {
-        currentParent = m_rootItem;
-        QString path = Utils::Fs::fromNativePath(info.filePath(i));
-        // Iterate of parts of the path to create necessary folders
-        QStringList pathFolders = path.split("/", QString::SkipEmptyParts);
-        pathFolders.removeLast();
-        foreach (const QString& pathPart, pathFolders) {
-            if (pathPart == ".unwanted")
+    // Folders are created when their first file is added to keep the original order of items.
+    // Parent folders always precede their subfolders in the file tree.
+    QVector<TorrentContentModelFolder *> folderItems(files.foldersCount(), nullptr);
+    folderItems[0] = m_rootItem;
+    bool hasUnwantedFolder = false;
+    const auto folderItem = [&files, &folderItems, &hasUnwantedFolder](const int folder)
+    {
+        QVector<int> missingFolders;
+        int existing = folder;
+        while (!folderItems[existing]) {
+            missingFolders.append(existing);
+            existing = files.folderParent(existing);
+        }
+
+        for (int i = missingFolders.size() - 1; i >= 0; --i) {
+            const int missing = missingFolders[i];
+            TorrentContentModelFolder *parent = folderItems[files.folderParent(missing)];
+            const QString name = files.folderName(missing);
+            if (name == ".unwanted") {
+                folderItems[missing] = parent;
+                hasUnwantedFolder = true;
                 continue;
-            TorrentContentModelFolder* newParent = currentParent->childFolderWithName(pathPart);
-            if (!newParent) {
-                newParent = new TorrentContentModelFolder(pathPart, currentParent);
-                currentParent->appendChild(newParent);
             }
-            currentParent = newParent;
+
+            // contents of ".unwanted" folder are merged into its parent folder
+            TorrentContentModelFolder *newFolder = (hasUnwantedFolder ? parent->childFolderWithName(name) : nullptr);
+            if (!newFolder) {
+                newFolder = new TorrentContentModelFolder(name, parent);
+                parent->appendChild(newFolder);
+            }
+            folderItems[missing] = newFolder;
         }
+
+        return folderItems[folder];
+    };
+
+    // Iterate over files
+    for (int i = 0; i < filesCount; ++i) {
+        TorrentContentModelFolder *currentParent = folderItem(files.fileFolder(i));
         // Actually create the file
-        TorrentContentModelFile* fileItem = new TorrentContentModelFile(info.fileName(i), info.fileSize(i), currentParent, i);
+        TorrentContentModelFile* fileItem = new TorrentContentModelFile(files.fileName(i), files.fileSize(i), currentParent, i);
         currentParent->appendChild(fileItem);
         m_filesIndex.push_back(fileItem);
     }
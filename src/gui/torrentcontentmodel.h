@@ -36,7 +36,7 @@
 #include <QVector>
 #include <QVariant>
 
-#include "base/bittorrent/torrentinfo.h"
+#include "base/bittorrent/filetree.h"
 #include "torrentcontentmodelitem.h"
 
 class QFileIconProvider;
@@ -66,7 +66,7 @@ public:
     QModelIndex parent(const QModelIndex& index) const override;
     int rowCount(const QModelIndex& parent = QModelIndex()) const override;
     void clear();
-    void setupModelData(const BitTorrent::TorrentInfo &info);
+    void setupModelData(const BitTorrent::FileTree &files);
 
 signals:
     void filteredFilesChanged();
@@ -62,6 +62,7 @@ void TorrentContentModelFile::setPriority(int newPriority, bool updateParent)
         return;
 
     m_priority = newPriority;
+    m_parentItem->invalidateStats();
 
     // Update parent
     if (updateParent)
@@ -70,6 +71,9 @@ void TorrentContentModelFile::setPriority(int newPriority, bool updateParent)
 
 void TorrentContentModelFile::setProgress(qreal progress)
 {
+    if (m_progress != progress)
+        m_parentItem->invalidateStats();
+
     m_progress = progress;
     m_remaining = static_cast<qulonglong>(m_size * (1.0 - m_progress));
     Q_ASSERT(m_progress <= 1.);
@@ -77,6 +81,9 @@ void TorrentContentModelFile::setProgress(qreal progress)
 
 void TorrentContentModelFile::setAvailability(qreal availability)
 {
+    if (m_availability != availability)
+        m_parentItem->invalidateStats();
+
     m_availability = availability;
     Q_ASSERT(m_availability <= 1.);
 }
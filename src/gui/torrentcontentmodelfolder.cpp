@@ -75,6 +75,7 @@ void TorrentContentModelFolder::appendChild(TorrentContentModelItem *item)
 {
     Q_ASSERT(item);
     m_childItems.append(item);
+    invalidateStats();
     // Update own size
     if (item->itemType() == FileType)
         increaseSize(item->size());
@@ -127,6 +128,7 @@ void TorrentContentModelFolder::setPriority(int newPriority, bool updateParent)
         return;
 
     m_priority = newPriority;
+    invalidateStats();
 
     // Update parent priority
     if (updateParent)
@@ -138,8 +140,19 @@ void TorrentContentModelFolder::setPriority(int newPriority, bool updateParent)
             child->setPriority(m_priority, false);
 }
 
+void TorrentContentModelFolder::invalidateStats()
+{
+    m_progressValid = false;
+    m_availabilityValid = false;
+    if (!isRootItem())
+        m_parentItem->invalidateStats();
+}
+
 void TorrentContentModelFolder::recalculateProgress()
 {
+    if (m_progressValid)
+        return;
+
     qreal tProgress = 0;
     qulonglong tSize = 0;
     qulonglong tRemaining = 0;
@@ -158,10 +171,15 @@ void TorrentContentModelFolder::recalculateProgress()
         m_remaining = tRemaining;
         Q_ASSERT(m_progress <= 1.);
     }
+
+    m_progressValid = true;
 }
 
 void TorrentContentModelFolder::recalculateAvailability()
 {
+    if (m_availabilityValid)
+        return;
+
     qreal tAvailability = 0;
     qulonglong tSize = 0;
     bool foundAnyData = false;
@@ -186,6 +204,8 @@ void TorrentContentModelFolder::recalculateAvailability()
     else {
         m_availability = -1.;
     }
+
+    m_availabilityValid = true;
 }
 
 void TorrentContentModelFolder::increaseSize(qulonglong delta)
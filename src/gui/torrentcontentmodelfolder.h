@@ -47,6 +47,9 @@ public:
     ItemType itemType() const override;
 
     void increaseSize(qulonglong delta);
+    // Marks the folder and its parents to be recalculated
+    void invalidateStats();
+    // Only invalidated folders are recalculated
     void recalculateProgress();
     void recalculateAvailability();
     void updatePriority();
@@ -62,6 +65,8 @@ public:
 
 private:
     QList<TorrentContentModelItem*> m_childItems;
+    bool m_progressValid = false;
+    bool m_availabilityValid = false;
 };
 
 #endif // TORRENTCONTENTMODELFOLDER_H
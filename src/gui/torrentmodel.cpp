@@ -31,6 +31,8 @@
 
 #include <QDebug>
 #include <QApplication>
+#include <QDateTime>
+#include <QMap>
 #include <QPalette>
 #include <QIcon>
 
@@ -55,6 +57,11 @@ static QIcon getErrorIcon();
 
 static bool isDarkTheme();
 
+static QVariant comparableValue(const QVariant &value);
+
+static_assert(TorrentModel::NB_COLUMNS <= 32, "Column set must fit in a 32-bit mask");
+static const quint32 ALL_COLUMNS = (static_cast<quint64>(1) << TorrentModel::NB_COLUMNS) - 1;
+
 // TorrentModel
 
 TorrentModel::TorrentModel(QObject *parent)
@@ -75,6 +82,14 @@ TorrentModel::TorrentModel(QObject *parent)
     connect(Session::instance(), &Session::torrentResumed, this, &TorrentModel::handleTorrentStatusUpdated);
     connect(Session::instance(), &Session::torrentPaused, this, &TorrentModel::handleTorrentStatusUpdated);
     connect(Session::instance(), &Session::torrentFinishedChecking, this, &TorrentModel::handleTorrentStatusUpdated);
+
+    connect(Session::instance(), &Session::torrentSavePathChanged, this, &TorrentModel::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentCategoryChanged, this, &TorrentModel::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentTagAdded, this, &TorrentModel::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentTagRemoved, this, &TorrentModel::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentShareLimitChanged, this, &TorrentModel::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentNameChanged, this, &TorrentModel::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentSpeedLimitChanged, this, &TorrentModel::handleTorrentChanged);
 }
 
 int TorrentModel::rowCount(const QModelIndex &index) const
@@ -274,10 +289,12 @@ bool TorrentModel::setData(const QModelIndex &index, const QVariant &value, int
 
 void TorrentModel::addTorrent(BitTorrent::TorrentHandle *const torrent)
 {
-    if (m_torrents.indexOf(torrent) == -1) {
+    if (!m_rowByHash.contains(torrent->hash())) {
         const int row = m_torrents.size();
         beginInsertRows(QModelIndex(), row, row);
         m_torrents << torrent;
+        m_rowByHash.insert(torrent->hash(), row);
+        m_columnValues << columnValues(row);
         endInsertRows();
     }
 }
@@ -299,28 +316,124 @@ BitTorrent::TorrentHandle *TorrentModel::torrentHandle(const QModelIndex &index)
 
 void TorrentModel::handleTorrentAboutToBeRemoved(BitTorrent::TorrentHandle *const torrent)
 {
-    const int row = m_torrents.indexOf(torrent);
+    const int row = m_rowByHash.value(torrent->hash(), -1);
     if (row >= 0) {
         beginRemoveRows(QModelIndex(), row, row);
         m_torrents.removeAt(row);
+        m_columnValues.removeAt(row);
+        m_rowByHash.remove(torrent->hash());
+        for (int i = row; i < m_torrents.size(); ++i)
+            m_rowByHash[m_torrents[i]->hash()] = i;
         endRemoveRows();
     }
 }
 
 void TorrentModel::handleTorrentStatusUpdated(BitTorrent::TorrentHandle *const torrent)
 {
-    const int row = m_torrents.indexOf(torrent);
-    if (row >= 0)
+    const int row = m_rowByHash.value(torrent->hash(), -1);
+    if (row >= 0) {
+        m_columnValues[row] = columnValues(row);
         emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+    }
+}
+
+void TorrentModel::handleTorrentChanged(BitTorrent::TorrentHandle *const torrent)
+{
+    handleTorrentsUpdated({torrent});
+}
+
+void TorrentModel::handleTorrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents)
+{
+    QMap<int, quint32> changedRows;
+    for (BitTorrent::TorrentHandle *const torrent : torrents) {
+        const int row = m_rowByHash.value(torrent->hash(), -1);
+        if (row < 0) continue;
+
+        const quint32 changedColumns = updateColumnValues(row);
+        if (changedColumns != 0)
+            changedRows.insert(row, changedColumns);
+    }
+
+    // Adjacent rows that changed in the same columns are reported at once
+    auto it = changedRows.cbegin();
+    while (it != changedRows.cend()) {
+        const int firstRow = it.key();
+        const quint32 columns = it.value();
+        int lastRow = firstRow;
+        while ((++it != changedRows.cend()) && (it.key() == (lastRow + 1)) && (it.value() == columns))
+            ++lastRow;
+
+        emitRowsChanged(firstRow, lastRow, columns);
+    }
+}
+
+TorrentModel::ColumnValues TorrentModel::columnValues(int row) const
+{
+    ColumnValues values(NB_COLUMNS);
+    for (int column = 0; column < NB_COLUMNS; ++column) {
+        const QModelIndex idx = index(row, column);
+        const QVariant value = comparableValue(data(idx, Qt::DisplayRole));
+        // These columns are sorted by a value that differs from the displayed one
+        if ((column == TR_SEEDS) || (column == TR_PEERS) || (column == TR_TIME_ELAPSED))
+            values[column] = QVariantList {value, comparableValue(data(idx, Qt::UserRole))};
+        else
+            values[column] = value;
+    }
+
+    return values;
+}
+
+quint32 TorrentModel::updateColumnValues(int row)
+{
+    const ColumnValues values = columnValues(row);
+    ColumnValues &oldValues = m_columnValues[row];
+
+    quint32 changedColumns = 0;
+    if (values[TR_STATUS] != oldValues[TR_STATUS]) {
+        // Icon and text color of the whole row depend on the state
+        changedColumns = ALL_COLUMNS;
+    }
+    else {
+        for (int column = 0; column < NB_COLUMNS; ++column) {
+            if (values[column] != oldValues[column])
+                changedColumns |= (1u << column);
+        }
+    }
+
+    oldValues = values;
+    return changedColumns;
 }
 
-void TorrentModel::handleTorrentsUpdated()
+void TorrentModel::emitRowsChanged(int firstRow, int lastRow, quint32 columns)
 {
-    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+    // Emit one range per run of changed columns so that the sort model
+    // doesn't re-sort unless the sort column itself has changed
+    int column = 0;
+    while (column < NB_COLUMNS) {
+        if (!(columns & (1u << column))) {
+            ++column;
+            continue;
+        }
+
+        const int firstColumn = column;
+        while (((column + 1) < NB_COLUMNS) && (columns & (1u << (column + 1))))
+            ++column;
+
+        emit dataChanged(index(firstRow, firstColumn), index(lastRow, column));
+        ++column;
+    }
 }
 
 // Static functions
 
+// QVariant can't compare the custom types which don't register comparators
+QVariant comparableValue(const QVariant &value)
+{
+    if (value.userType() == qMetaTypeId<BitTorrent::TorrentState>())
+        return static_cast<int>(value.value<BitTorrent::TorrentState>());
+    return value;
+}
+
 QIcon getIconByState(BitTorrent::TorrentState state)
 {
     switch (state) {
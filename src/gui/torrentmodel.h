@@ -33,11 +33,15 @@
 #define TORRENTMODEL_H
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QList>
+#include <QVariant>
+#include <QVector>
+
+#include "base/bittorrent/infohash.h"
 
 namespace BitTorrent
 {
-    class InfoHash;
     class TorrentHandle;
 }
 
@@ -98,10 +102,20 @@ private slots:
     void addTorrent(BitTorrent::TorrentHandle *const torrent);
     void handleTorrentAboutToBeRemoved(BitTorrent::TorrentHandle *const torrent);
     void handleTorrentStatusUpdated(BitTorrent::TorrentHandle *const torrent);
-    void handleTorrentsUpdated();
+    void handleTorrentChanged(BitTorrent::TorrentHandle *const torrent);
+    void handleTorrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents);
 
 private:
+    typedef QVector<QVariant> ColumnValues;
+
+    ColumnValues columnValues(int row) const;
+    quint32 updateColumnValues(int row);
+    void emitRowsChanged(int firstRow, int lastRow, quint32 columns);
+
     QList<BitTorrent::TorrentHandle *> m_torrents;
+    // Parallel to m_torrents, used to find out which columns really changed
+    QVector<ColumnValues> m_columnValues;
+    QHash<BitTorrent::InfoHash, int> m_rowByHash;
 };
 
 #endif // TORRENTMODEL_H
@@ -89,3 +89,8 @@ void APIController::setResult(const QJsonObject &result)
 {
     m_result = QJsonDocument(result);
 }
+
+void APIController::setJsonResult(const QByteArray &result)
+{
+    m_result = result;
+}
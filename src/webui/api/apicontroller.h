@@ -63,6 +63,8 @@ protected:
     void setResult(const QString &result);
     void setResult(const QJsonArray &result);
     void setResult(const QJsonObject &result);
+    // For JSON text that is already serialized
+    void setJsonResult(const QByteArray &result);
 
 private:
     ISessionManager *m_sessionManager;
@@ -0,0 +1,112 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "changejournal.h"
+
+namespace
+{
+    const int MAX_REMOVED_KEYS = 100;
+}
+
+ChangeJournal::ChangeJournal()
+    : m_version(0)
+    , m_oldestVersion(0)
+{
+}
+
+void ChangeJournal::update(const QVariantMap &data)
+{
+    const quint64 newVersion = m_version + 1;
+    bool changed = false;
+
+    for (auto i = m_entries.begin(); i != m_entries.end();) {
+        if (!data.contains(i.key())) {
+            m_removedKeys.append(qMakePair(newVersion, i.key()));
+            i = m_entries.erase(i);
+            changed = true;
+        }
+        else {
+            ++i;
+        }
+    }
+
+    for (auto i = data.cbegin(); i != data.cend(); ++i) {
+        auto entry = m_entries.find(i.key());
+        if (entry == m_entries.end()) {
+            m_entries.insert(i.key(), {i.value(), newVersion});
+            changed = true;
+        }
+        else if (entry->value != i.value()) {
+            entry->value = i.value();
+            entry->version = newVersion;
+            changed = true;
+        }
+    }
+
+    if (m_removedKeys.size() > MAX_REMOVED_KEYS) {
+        const int count = m_removedKeys.size() - (MAX_REMOVED_KEYS / 2);
+        m_oldestVersion = m_removedKeys[count - 1].first;
+        m_removedKeys.remove(0, count);
+    }
+
+    if (changed)
+        m_version = newVersion;
+}
+
+quint64 ChangeJournal::version() const
+{
+    return m_version;
+}
+
+bool ChangeJournal::isTracked(const quint64 version) const
+{
+    return ((version >= m_oldestVersion) && (version <= m_version));
+}
+
+QVariantMap ChangeJournal::changedSince(const quint64 version) const
+{
+    QVariantMap changes;
+    for (auto i = m_entries.cbegin(); i != m_entries.cend(); ++i) {
+        if (i->version > version)
+            changes[i.key()] = i->value;
+    }
+
+    return changes;
+}
+
+QStringList ChangeJournal::removedSince(const quint64 version) const
+{
+    QStringList keys;
+    for (const auto &removedKey : m_removedKeys) {
+        // Keys added back since then are reported as changed ones
+        if ((removedKey.first > version) && !m_entries.contains(removedKey.second))
+            keys << removedKey.second;
+    }
+
+    return keys;
+}
@@ -0,0 +1,66 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantMap>
+#include <QVector>
+
+// Keeps a flat key/value map along with the version of the last change of each key,
+// so that changes since any recent version can be retrieved without keeping old copies.
+class ChangeJournal
+{
+public:
+    ChangeJournal();
+
+    // Replaces the whole content. Changed, added and removed keys get a new version.
+    void update(const QVariantMap &data);
+    quint64 version() const;
+    // Returns false if removals since the given version are already forgotten
+    bool isTracked(quint64 version) const;
+
+    QVariantMap changedSince(quint64 version) const;
+    QStringList removedSince(quint64 version) const;
+
+private:
+    struct Entry
+    {
+        QVariant value;
+        quint64 version;
+    };
+
+    QHash<QString, Entry> m_entries;
+    quint64 m_version;
+    quint64 m_oldestVersion;
+    // Ordered by version
+    QVector<QPair<quint64, QString>> m_removedKeys;
+};
@@ -0,0 +1,94 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#include "piecestatejournal.h"
+
+PieceStateJournal::PieceStateJournal()
+    : m_version(0)
+    , m_oldestVersion(0)
+{
+}
+
+bool PieceStateJournal::update(const QByteArray &states, const quint64 newVersion)
+{
+    if (states.size() != m_states.size()) {
+        m_states = states;
+        m_pieceVersions.fill(newVersion, states.size());
+        m_version = newVersion;
+        m_oldestVersion = newVersion;
+        return true;
+    }
+
+    bool changed = false;
+    for (int i = 0; i < states.size(); ++i) {
+        if (states[i] != m_states[i]) {
+            m_states[i] = states[i];
+            m_pieceVersions[i] = newVersion;
+            changed = true;
+        }
+    }
+
+    if (changed)
+        m_version = newVersion;
+    return changed;
+}
+
+quint64 PieceStateJournal::version() const
+{
+    return m_version;
+}
+
+bool PieceStateJournal::isTracked(const quint64 version) const
+{
+    return ((version >= m_oldestVersion) && (version <= m_version));
+}
+
+const QByteArray &PieceStateJournal::states() const
+{
+    return m_states;
+}
+
+QVector<QPair<int, int>> PieceStateJournal::changedSince(const quint64 version) const
+{
+    QVector<QPair<int, int>> ranges;
+    int i = 0;
+    while (i < m_pieceVersions.size()) {
+        if (m_pieceVersions[i] <= version) {
+            ++i;
+            continue;
+        }
+
+        const int start = i;
+        while ((i < m_pieceVersions.size()) && (m_pieceVersions[i] > version))
+            ++i;
+        ranges.append(qMakePair(start, (i - start)));
+    }
+
+    return ranges;
+}
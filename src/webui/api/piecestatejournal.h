@@ -0,0 +1,59 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+
+#pragma once
+
+#include <QByteArray>
+#include <QPair>
+#include <QVector>
+
+// Keeps the states of torrent pieces (one byte per piece) along with the version
+// each piece was last changed in, so the pieces changed since any version
+// starting from the first update can be retrieved.
+class PieceStateJournal
+{
+public:
+    PieceStateJournal();
+
+    // Returns true if any piece state changed, then the given version becomes the current one.
+    // A different number of pieces (e.g. metadata was received) resets the journal.
+    bool update(const QByteArray &states, quint64 newVersion);
+    quint64 version() const;
+    bool isTracked(quint64 version) const;
+
+    const QByteArray &states() const;
+    // Returns ranges (start, count) of pieces changed since the given version
+    QVector<QPair<int, int>> changedSince(quint64 version) const;
+
+private:
+    QByteArray m_states;
+    QVector<quint64> m_pieceVersions;
+    quint64 m_version;
+    quint64 m_oldestVersion;
+};
@@ -86,6 +86,8 @@ void RSSController::moveItemAction()
 void RSSController::itemsAction()
 {
     const bool withData {parseBool(params()["withData"], false)};
+    if (withData)
+        RSS::Session::instance()->rootFolder()->loadArticles();
 
     const auto jsonVal = RSS::Session::instance()->rootFolder()->toJsonValue(withData);
     setResult(jsonVal.toObject());
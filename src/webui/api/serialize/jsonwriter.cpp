@@ -0,0 +1,335 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "jsonwriter.h"
+
+#include <cmath>
+
+#include <QLocale>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+namespace
+{
+    const char HEX_DIGITS[] = "0123456789abcdef";
+
+    void appendEscaped(QByteArray &buffer, const uchar c)
+    {
+        switch (c) {
+        case '"':
+            buffer.append("\\\"", 2);
+            break;
+        case '\\':
+            buffer.append("\\\\", 2);
+            break;
+        case '\b':
+            buffer.append("\\b", 2);
+            break;
+        case '\f':
+            buffer.append("\\f", 2);
+            break;
+        case '\n':
+            buffer.append("\\n", 2);
+            break;
+        case '\r':
+            buffer.append("\\r", 2);
+            break;
+        case '\t':
+            buffer.append("\\t", 2);
+            break;
+        default:
+            if (c < 0x20) {
+                const char escaped[] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xF]};
+                buffer.append(escaped, sizeof(escaped));
+            }
+            else {
+                buffer.append(static_cast<char>(c));
+            }
+        }
+    }
+}
+
+JsonWriter::JsonWriter(QByteArray &buffer)
+    : m_buffer(buffer)
+    , m_needComma(false)
+{
+}
+
+void JsonWriter::beginObject()
+{
+    beginValue();
+    m_buffer.append('{');
+    m_needComma = false;
+}
+
+void JsonWriter::endObject()
+{
+    m_buffer.append('}');
+    m_needComma = true;
+}
+
+void JsonWriter::beginArray()
+{
+    beginValue();
+    m_buffer.append('[');
+    m_needComma = false;
+}
+
+void JsonWriter::endArray()
+{
+    m_buffer.append(']');
+    m_needComma = true;
+}
+
+void JsonWriter::writeKey(const char *key)
+{
+    beginValue();
+    appendString(key);
+    m_buffer.append(':');
+    m_needComma = false;
+}
+
+void JsonWriter::writeKey(const QString &key)
+{
+    beginValue();
+    appendString(key);
+    m_buffer.append(':');
+    m_needComma = false;
+}
+
+void JsonWriter::writeNull()
+{
+    beginValue();
+    m_buffer.append("null", 4);
+    m_needComma = true;
+}
+
+void JsonWriter::writeValue(bool value)
+{
+    beginValue();
+    if (value)
+        m_buffer.append("true", 4);
+    else
+        m_buffer.append("false", 5);
+    m_needComma = true;
+}
+
+void JsonWriter::writeValue(int value)
+{
+    writeValue(static_cast<qlonglong>(value));
+}
+
+void JsonWriter::writeValue(uint value)
+{
+    writeValue(static_cast<qulonglong>(value));
+}
+
+void JsonWriter::writeValue(qlonglong value)
+{
+    beginValue();
+    // Negate in unsigned arithmetic so that the minimal value doesn't overflow
+    if (value < 0)
+        appendNumber(0 - static_cast<qulonglong>(value), true);
+    else
+        appendNumber(static_cast<qulonglong>(value), false);
+    m_needComma = true;
+}
+
+void JsonWriter::writeValue(qulonglong value)
+{
+    beginValue();
+    appendNumber(value, false);
+    m_needComma = true;
+}
+
+void JsonWriter::writeValue(double value)
+{
+    // JSON has no representation for NaN and infinity
+    if (!std::isfinite(value)) {
+        writeNull();
+        return;
+    }
+
+    beginValue();
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 7, 0))
+    m_buffer.append(QByteArray::number(value, 'g', QLocale::FloatingPointShortest));
+#else
+    m_buffer.append(QByteArray::number(value, 'g', 17));
+#endif
+    m_needComma = true;
+}
+
+void JsonWriter::writeValue(const char *value)
+{
+    beginValue();
+    appendString(value);
+    m_needComma = true;
+}
+
+void JsonWriter::writeValue(const QString &value)
+{
+    beginValue();
+    appendString(value);
+    m_needComma = true;
+}
+
+void JsonWriter::writeValue(const QVariant &value)
+{
+    switch (static_cast<QMetaType::Type>(value.type())) {
+    case QMetaType::UnknownType:
+        writeNull();
+        break;
+    case QMetaType::Bool:
+        writeValue(value.toBool());
+        break;
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+        writeValue(value.toLongLong());
+        break;
+    case QMetaType::UInt:
+    case QMetaType::ULongLong:
+        writeValue(value.toULongLong());
+        break;
+    case QMetaType::Float:
+    case QMetaType::Double:
+        writeValue(value.toDouble());
+        break;
+    case QMetaType::QVariantMap: {
+            const QVariantMap map = value.toMap();
+            beginObject();
+            for (auto i = map.cbegin(); i != map.cend(); ++i) {
+                writeKey(i.key());
+                writeValue(i.value());
+            }
+            endObject();
+        }
+        break;
+    case QMetaType::QVariantHash: {
+            const QVariantHash hash = value.toHash();
+            beginObject();
+            for (auto i = hash.cbegin(); i != hash.cend(); ++i) {
+                writeKey(i.key());
+                writeValue(i.value());
+            }
+            endObject();
+        }
+        break;
+    case QMetaType::QVariantList:
+    case QMetaType::QStringList: {
+            const QVariantList list = value.toList();
+            beginArray();
+            for (const QVariant &item : list)
+                writeValue(item);
+            endArray();
+        }
+        break;
+    default:
+        writeValue(value.toString());
+        break;
+    }
+}
+
+JsonWriter::Mark JsonWriter::mark() const
+{
+    return {m_buffer.size(), m_needComma};
+}
+
+void JsonWriter::rollback(const Mark &mark)
+{
+    m_buffer.truncate(mark.size);
+    m_needComma = mark.needComma;
+}
+
+void JsonWriter::beginValue()
+{
+    if (m_needComma)
+        m_buffer.append(',');
+}
+
+void JsonWriter::appendString(const QString &value)
+{
+    m_buffer.append('"');
+
+    const int size = value.size();
+    const ushort *data = value.utf16();
+    for (int i = 0; i < size; ++i) {
+        uint c = data[i];
+        if (c < 0x80) {
+            appendEscaped(m_buffer, static_cast<uchar>(c));
+            continue;
+        }
+
+        if (QChar::isSurrogate(c)) {
+            if (QChar::isHighSurrogate(c) && ((i + 1) < size) && QChar::isLowSurrogate(data[i + 1]))
+                c = QChar::surrogateToUcs4(c, data[++i]);
+            else
+                c = QChar::ReplacementCharacter;
+        }
+
+        if (c < 0x800) {
+            m_buffer.append(static_cast<char>(0xC0 | (c >> 6)));
+        }
+        else if (c < 0x10000) {
+            m_buffer.append(static_cast<char>(0xE0 | (c >> 12)));
+            m_buffer.append(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+        }
+        else {
+            m_buffer.append(static_cast<char>(0xF0 | (c >> 18)));
+            m_buffer.append(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+            m_buffer.append(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+        }
+        m_buffer.append(static_cast<char>(0x80 | (c & 0x3F)));
+    }
+
+    m_buffer.append('"');
+}
+
+void JsonWriter::appendString(const char *value)
+{
+    // Used for keys and constant values, which are plain ASCII
+    m_buffer.append('"');
+    for (const char *c = value; *c; ++c)
+        appendEscaped(m_buffer, static_cast<uchar>(*c));
+    m_buffer.append('"');
+}
+
+void JsonWriter::appendNumber(qulonglong value, const bool negative)
+{
+    char digits[21];
+    int pos = sizeof(digits);
+    do {
+        digits[--pos] = static_cast<char>('0' + (value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    if (negative)
+        digits[--pos] = '-';
+
+    m_buffer.append(digits + pos, sizeof(digits) - pos);
+}
@@ -0,0 +1,80 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QByteArray>
+
+class QString;
+class QVariant;
+
+// Appends compact JSON text to a buffer without building an intermediate
+// document. The caller is responsible for producing well-formed nesting.
+class JsonWriter
+{
+public:
+    struct Mark
+    {
+        int size;
+        bool needComma;
+    };
+
+    explicit JsonWriter(QByteArray &buffer);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    void writeKey(const char *key);
+    void writeKey(const QString &key);
+
+    void writeNull();
+    void writeValue(bool value);
+    void writeValue(int value);
+    void writeValue(uint value);
+    void writeValue(qlonglong value);
+    void writeValue(qulonglong value);
+    void writeValue(double value);
+    void writeValue(const char *value);
+    void writeValue(const QString &value);
+    void writeValue(const QVariant &value);
+
+    // Allows to drop things already written, e.g. an object which turned out to be empty
+    Mark mark() const;
+    void rollback(const Mark &mark);
+
+private:
+    void beginValue();
+    void appendString(const QString &value);
+    void appendString(const char *value);
+    void appendNumber(qulonglong value, bool negative);
+
+    QByteArray &m_buffer;
+    bool m_needComma;
+};
@@ -28,116 +28,279 @@
 
 #include "serialize_torrent.h"
 
+#include <QDateTime>
+
 #include "base/bittorrent/session.h"
-#include "base/bittorrent/torrenthandle.h"
 #include "base/utils/fs.h"
 #include "base/utils/string.h"
+#include "jsonwriter.h"
 
 namespace
 {
-    QString torrentStateToString(const BitTorrent::TorrentState state)
+    const char *torrentStateToString(const BitTorrent::TorrentState state)
     {
         switch (state) {
         case BitTorrent::TorrentState::Error:
-            return QLatin1String("error");
+            return "error";
         case BitTorrent::TorrentState::MissingFiles:
-            return QLatin1String("missingFiles");
+            return "missingFiles";
         case BitTorrent::TorrentState::Uploading:
-            return QLatin1String("uploading");
+            return "uploading";
         case BitTorrent::TorrentState::PausedUploading:
-            return QLatin1String("pausedUP");
+            return "pausedUP";
         case BitTorrent::TorrentState::QueuedUploading:
-            return QLatin1String("queuedUP");
+            return "queuedUP";
         case BitTorrent::TorrentState::StalledUploading:
-            return QLatin1String("stalledUP");
+            return "stalledUP";
         case BitTorrent::TorrentState::CheckingUploading:
-            return QLatin1String("checkingUP");
+            return "checkingUP";
         case BitTorrent::TorrentState::ForcedUploading:
-            return QLatin1String("forcedUP");
+            return "forcedUP";
         case BitTorrent::TorrentState::Allocating:
-            return QLatin1String("allocating");
+            return "allocating";
         case BitTorrent::TorrentState::Downloading:
-            return QLatin1String("downloading");
+            return "downloading";
         case BitTorrent::TorrentState::DownloadingMetadata:
-            return QLatin1String("metaDL");
+            return "metaDL";
         case BitTorrent::TorrentState::PausedDownloading:
-            return QLatin1String("pausedDL");
+            return "pausedDL";
         case BitTorrent::TorrentState::QueuedDownloading:
-            return QLatin1String("queuedDL");
+            return "queuedDL";
         case BitTorrent::TorrentState::StalledDownloading:
-            return QLatin1String("stalledDL");
+            return "stalledDL";
         case BitTorrent::TorrentState::CheckingDownloading:
-            return QLatin1String("checkingDL");
+            return "checkingDL";
         case BitTorrent::TorrentState::ForcedDownloading:
-            return QLatin1String("forcedDL");
+            return "forcedDL";
 #if LIBTORRENT_VERSION_NUM < 10100
         case BitTorrent::TorrentState::QueuedForChecking:
-            return QLatin1String("queuedForChecking");
+            return "queuedForChecking";
 #endif
         case BitTorrent::TorrentState::CheckingResumeData:
-            return QLatin1String("checkingResumeData");
+            return "checkingResumeData";
         default:
-            return QLatin1String("unknown");
+            return "unknown";
+        }
+    }
+
+    struct TorrentField
+    {
+        const char *key;
+        TorrentLessThan lessThan;
+        bool (*equals)(const TorrentSnapshot &left, const TorrentSnapshot &right);
+        void (*write)(JsonWriter &writer, const char *key, const TorrentSnapshot &torrent);
+    };
+
+    template <typename T, T TorrentSnapshot::*field>
+    bool fieldLessThan(const TorrentSnapshot &left, const TorrentSnapshot &right)
+    {
+        return (left.*field < right.*field);
+    }
+
+    template <typename T, T TorrentSnapshot::*field>
+    bool fieldEquals(const TorrentSnapshot &left, const TorrentSnapshot &right)
+    {
+        return (left.*field == right.*field);
+    }
+
+    template <typename T, T TorrentSnapshot::*field>
+    void writeField(JsonWriter &writer, const char *key, const TorrentSnapshot &torrent)
+    {
+        writer.writeKey(key);
+        writer.writeValue(torrent.*field);
+    }
+
+    template <typename T, T TorrentSnapshot::*field>
+    TorrentField makeField(const char *key)
+    {
+        return {key, &fieldLessThan<T, field>, &fieldEquals<T, field>, &writeField<T, field>};
+    }
+
+    // State is sorted by its string representation, as exposed to the clients
+    bool stateLessThan(const TorrentSnapshot &left, const TorrentSnapshot &right)
+    {
+        return (qstrcmp(torrentStateToString(left.state), torrentStateToString(right.state)) < 0);
+    }
+
+    void writeState(JsonWriter &writer, const char *key, const TorrentSnapshot &torrent)
+    {
+        writer.writeKey(key);
+        writer.writeValue(torrentStateToString(torrent.state));
+    }
+
+    // First/last piece priority is meaningless until metadata is received
+    bool firstLastPiecePrioEquals(const TorrentSnapshot &left, const TorrentSnapshot &right)
+    {
+        return (left.hasMetadata == right.hasMetadata)
+                && (left.firstLastPiecePrio == right.firstLastPiecePrio);
+    }
+
+    void writeFirstLastPiecePrio(JsonWriter &writer, const char *key, const TorrentSnapshot &torrent)
+    {
+        if (torrent.hasMetadata) {
+            writer.writeKey(key);
+            writer.writeValue(torrent.firstLastPiecePrio);
         }
     }
+
+    using Snapshot = TorrentSnapshot;
+
+    // Hash is handled separately since it is used as a key in the sync API
+    const TorrentField TORRENT_FIELDS[] = {
+        makeField<QString, &Snapshot::name>(KEY_TORRENT_NAME),
+        makeField<QString, &Snapshot::magnetUri>(KEY_TORRENT_MAGNET_URI),
+        makeField<qlonglong, &Snapshot::size>(KEY_TORRENT_SIZE),
+        makeField<qreal, &Snapshot::progress>(KEY_TORRENT_PROGRESS),
+        makeField<int, &Snapshot::dlSpeed>(KEY_TORRENT_DLSPEED),
+        makeField<int, &Snapshot::upSpeed>(KEY_TORRENT_UPSPEED),
+        makeField<int, &Snapshot::priority>(KEY_TORRENT_PRIORITY),
+        makeField<int, &Snapshot::numSeeds>(KEY_TORRENT_SEEDS),
+        makeField<int, &Snapshot::numComplete>(KEY_TORRENT_NUM_COMPLETE),
+        makeField<int, &Snapshot::numLeechs>(KEY_TORRENT_LEECHS),
+        makeField<int, &Snapshot::numIncomplete>(KEY_TORRENT_NUM_INCOMPLETE),
+        makeField<qreal, &Snapshot::ratio>(KEY_TORRENT_RATIO),
+        makeField<qulonglong, &Snapshot::eta>(KEY_TORRENT_ETA),
+        {KEY_TORRENT_STATE, &stateLessThan, &fieldEquals<BitTorrent::TorrentState, &Snapshot::state>, &writeState},
+        makeField<bool, &Snapshot::sequentialDownload>(KEY_TORRENT_SEQUENTIAL_DOWNLOAD),
+        {KEY_TORRENT_FIRST_LAST_PIECE_PRIO, &fieldLessThan<bool, &Snapshot::firstLastPiecePrio>, &firstLastPiecePrioEquals, &writeFirstLastPiecePrio},
+        makeField<QString, &Snapshot::category>(KEY_TORRENT_CATEGORY),
+        makeField<QString, &Snapshot::tags>(KEY_TORRENT_TAGS),
+        makeField<bool, &Snapshot::superSeeding>(KEY_TORRENT_SUPER_SEEDING),
+        makeField<bool, &Snapshot::forceStart>(KEY_TORRENT_FORCE_START),
+        makeField<QString, &Snapshot::savePath>(KEY_TORRENT_SAVE_PATH),
+        makeField<uint, &Snapshot::addedOn>(KEY_TORRENT_ADDED_ON),
+        makeField<uint, &Snapshot::completionOn>(KEY_TORRENT_COMPLETION_ON),
+        makeField<QString, &Snapshot::tracker>(KEY_TORRENT_TRACKER),
+        makeField<int, &Snapshot::dlLimit>(KEY_TORRENT_DL_LIMIT),
+        makeField<int, &Snapshot::upLimit>(KEY_TORRENT_UP_LIMIT),
+        makeField<qlonglong, &Snapshot::downloaded>(KEY_TORRENT_AMOUNT_DOWNLOADED),
+        makeField<qlonglong, &Snapshot::uploaded>(KEY_TORRENT_AMOUNT_UPLOADED),
+        makeField<qlonglong, &Snapshot::downloadedSession>(KEY_TORRENT_AMOUNT_DOWNLOADED_SESSION),
+        makeField<qlonglong, &Snapshot::uploadedSession>(KEY_TORRENT_AMOUNT_UPLOADED_SESSION),
+        makeField<qlonglong, &Snapshot::amountLeft>(KEY_TORRENT_AMOUNT_LEFT),
+        makeField<qlonglong, &Snapshot::completed>(KEY_TORRENT_AMOUNT_COMPLETED),
+        makeField<qreal, &Snapshot::maxRatio>(KEY_TORRENT_MAX_RATIO),
+        makeField<int, &Snapshot::maxSeedingTime>(KEY_TORRENT_MAX_SEEDING_TIME),
+        makeField<qreal, &Snapshot::ratioLimit>(KEY_TORRENT_RATIO_LIMIT),
+        makeField<int, &Snapshot::seedingTimeLimit>(KEY_TORRENT_SEEDING_TIME_LIMIT),
+        makeField<uint, &Snapshot::seenComplete>(KEY_TORRENT_LAST_SEEN_COMPLETE_TIME),
+        makeField<uint, &Snapshot::lastActivity>(KEY_TORRENT_LAST_ACTIVITY_TIME),
+        makeField<qlonglong, &Snapshot::totalSize>(KEY_TORRENT_TOTAL_SIZE),
+        makeField<bool, &Snapshot::autoTMM>(KEY_TORRENT_AUTO_TORRENT_MANAGEMENT),
+        makeField<int, &Snapshot::timeActive>(KEY_TORRENT_TIME_ACTIVE)
+    };
+
+    static_assert((sizeof(TORRENT_FIELDS) / sizeof(TORRENT_FIELDS[0])) == TORRENT_FIELD_COUNT
+                  , "TORRENT_FIELD_COUNT doesn't match the fields table");
 }
 
-QVariantMap serialize(const BitTorrent::TorrentHandle &torrent)
+TorrentSnapshot takeSnapshot(const BitTorrent::TorrentHandle &torrent)
 {
-    QVariantMap ret;
-    ret[KEY_TORRENT_HASH] = QString(torrent.hash());
-    ret[KEY_TORRENT_NAME] = torrent.name();
-    ret[KEY_TORRENT_MAGNET_URI] = torrent.toMagnetUri();
-    ret[KEY_TORRENT_SIZE] = torrent.wantedSize();
-    ret[KEY_TORRENT_PROGRESS] = torrent.progress();
-    ret[KEY_TORRENT_DLSPEED] = torrent.downloadPayloadRate();
-    ret[KEY_TORRENT_UPSPEED] = torrent.uploadPayloadRate();
-    ret[KEY_TORRENT_PRIORITY] = torrent.queuePosition();
-    ret[KEY_TORRENT_SEEDS] = torrent.seedsCount();
-    ret[KEY_TORRENT_NUM_COMPLETE] = torrent.totalSeedsCount();
-    ret[KEY_TORRENT_LEECHS] = torrent.leechsCount();
-    ret[KEY_TORRENT_NUM_INCOMPLETE] = torrent.totalLeechersCount();
+    TorrentSnapshot ret;
+    ret.hash = QString(torrent.hash());
+    ret.name = torrent.name();
+    ret.magnetUri = torrent.toMagnetUri();
+    ret.size = torrent.wantedSize();
+    ret.progress = torrent.progress();
+    ret.dlSpeed = torrent.downloadPayloadRate();
+    ret.upSpeed = torrent.uploadPayloadRate();
+    ret.priority = torrent.queuePosition();
+    ret.numSeeds = torrent.seedsCount();
+    ret.numComplete = torrent.totalSeedsCount();
+    ret.numLeechs = torrent.leechsCount();
+    ret.numIncomplete = torrent.totalLeechersCount();
     const qreal ratio = torrent.realRatio();
-    ret[KEY_TORRENT_RATIO] = (ratio > BitTorrent::TorrentHandle::MAX_RATIO) ? -1 : ratio;
-    ret[KEY_TORRENT_STATE] = torrentStateToString(torrent.state());
-    ret[KEY_TORRENT_ETA] = torrent.eta();
-    ret[KEY_TORRENT_SEQUENTIAL_DOWNLOAD] = torrent.isSequentialDownload();
-    if (torrent.hasMetadata())
-        ret[KEY_TORRENT_FIRST_LAST_PIECE_PRIO] = torrent.hasFirstLastPiecePriority();
-    ret[KEY_TORRENT_CATEGORY] = torrent.category();
-    ret[KEY_TORRENT_TAGS] = torrent.tags().toList().join(", ");
-    ret[KEY_TORRENT_SUPER_SEEDING] = torrent.superSeeding();
-    ret[KEY_TORRENT_FORCE_START] = torrent.isForced();
-    ret[KEY_TORRENT_SAVE_PATH] = Utils::Fs::toNativePath(torrent.savePath());
-    ret[KEY_TORRENT_ADDED_ON] = torrent.addedTime().toTime_t();
-    ret[KEY_TORRENT_COMPLETION_ON] = torrent.completedTime().toTime_t();
-    ret[KEY_TORRENT_TRACKER] = torrent.currentTracker();
-    ret[KEY_TORRENT_DL_LIMIT] = torrent.downloadLimit();
-    ret[KEY_TORRENT_UP_LIMIT] = torrent.uploadLimit();
-    ret[KEY_TORRENT_AMOUNT_DOWNLOADED] = torrent.totalDownload();
-    ret[KEY_TORRENT_AMOUNT_UPLOADED] = torrent.totalUpload();
-    ret[KEY_TORRENT_AMOUNT_DOWNLOADED_SESSION] = torrent.totalPayloadDownload();
-    ret[KEY_TORRENT_AMOUNT_UPLOADED_SESSION] = torrent.totalPayloadUpload();
-    ret[KEY_TORRENT_AMOUNT_LEFT] = torrent.incompletedSize();
-    ret[KEY_TORRENT_AMOUNT_COMPLETED] = torrent.completedSize();
-    ret[KEY_TORRENT_MAX_RATIO] = torrent.maxRatio();
-    ret[KEY_TORRENT_MAX_SEEDING_TIME] = torrent.maxSeedingTime();
-    ret[KEY_TORRENT_RATIO_LIMIT] = torrent.ratioLimit();
-    ret[KEY_TORRENT_SEEDING_TIME_LIMIT] = torrent.seedingTimeLimit();
-    ret[KEY_TORRENT_LAST_SEEN_COMPLETE_TIME] = torrent.lastSeenComplete().toTime_t();
-    ret[KEY_TORRENT_AUTO_TORRENT_MANAGEMENT] = torrent.isAutoTMMEnabled();
-    ret[KEY_TORRENT_TIME_ACTIVE] = torrent.activeTime();
+    ret.ratio = (ratio > BitTorrent::TorrentHandle::MAX_RATIO) ? -1 : ratio;
+    ret.state = torrent.state();
+    ret.eta = torrent.eta();
+    ret.sequentialDownload = torrent.isSequentialDownload();
+    ret.hasMetadata = torrent.hasMetadata();
+    if (ret.hasMetadata)
+        ret.firstLastPiecePrio = torrent.hasFirstLastPiecePriority();
+    ret.category = torrent.category();
+    ret.tags = torrent.tags().toList().join(", ");
+    ret.superSeeding = torrent.superSeeding();
+    ret.forceStart = torrent.isForced();
+    ret.savePath = Utils::Fs::toNativePath(torrent.savePath());
+    ret.addedOn = torrent.addedTime().toTime_t();
+    ret.completionOn = torrent.completedTime().toTime_t();
+    ret.tracker = torrent.currentTracker();
+    ret.dlLimit = torrent.downloadLimit();
+    ret.upLimit = torrent.uploadLimit();
+    ret.downloaded = torrent.totalDownload();
+    ret.uploaded = torrent.totalUpload();
+    ret.downloadedSession = torrent.totalPayloadDownload();
+    ret.uploadedSession = torrent.totalPayloadUpload();
+    ret.amountLeft = torrent.incompletedSize();
+    ret.completed = torrent.completedSize();
+    ret.maxRatio = torrent.maxRatio();
+    ret.maxSeedingTime = torrent.maxSeedingTime();
+    ret.ratioLimit = torrent.ratioLimit();
+    ret.seedingTimeLimit = torrent.seedingTimeLimit();
+    ret.seenComplete = torrent.lastSeenComplete().toTime_t();
+    ret.autoTMM = torrent.isAutoTMMEnabled();
+    ret.timeActive = torrent.activeTime();
 
     if (torrent.isPaused() || torrent.isChecking()) {
-        ret[KEY_TORRENT_LAST_ACTIVITY_TIME] = 0;
+        ret.lastActivity = 0;
     }
     else {
         QDateTime dt = QDateTime::currentDateTime();
         dt = dt.addSecs(-torrent.timeSinceActivity());
-        ret[KEY_TORRENT_LAST_ACTIVITY_TIME] = dt.toTime_t();
+        ret.lastActivity = dt.toTime_t();
     }
 
-    ret[KEY_TORRENT_TOTAL_SIZE] = torrent.totalSize();
+    ret.totalSize = torrent.totalSize();
 
     return ret;
 }
+
+void serialize(JsonWriter &writer, const TorrentSnapshot &torrent, const bool includeHash)
+{
+    if (includeHash) {
+        writer.writeKey(KEY_TORRENT_HASH);
+        writer.writeValue(torrent.hash);
+    }
+
+    for (const TorrentField &field : TORRENT_FIELDS)
+        field.write(writer, field.key, torrent);
+}
+
+int serializeChangedSince(JsonWriter &writer, const TorrentSnapshot &torrent, const TorrentFieldVersions &versions, const quint64 version)
+{
+    int count = 0;
+    for (int i = 0; i < TORRENT_FIELD_COUNT; ++i) {
+        if (versions[i] > version) {
+            TORRENT_FIELDS[i].write(writer, TORRENT_FIELDS[i].key, torrent);
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+bool updateFieldVersions(TorrentFieldVersions &versions, const TorrentSnapshot &torrent, const TorrentSnapshot &prevTorrent, const quint64 version)
+{
+    bool changed = false;
+    for (int i = 0; i < TORRENT_FIELD_COUNT; ++i) {
+        if (!TORRENT_FIELDS[i].equals(torrent, prevTorrent)) {
+            versions[i] = version;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+TorrentLessThan torrentLessThan(const QString &key)
+{
+    if (key == QLatin1String(KEY_TORRENT_HASH))
+        return &fieldLessThan<QString, &Snapshot::hash>;
+
+    for (const TorrentField &field : TORRENT_FIELDS) {
+        if (key == QLatin1String(field.key))
+            return field.lessThan;
+    }
+
+    return nullptr;
+}
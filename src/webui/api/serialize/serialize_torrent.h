@@ -28,12 +28,13 @@
 
 #pragma once
 
-#include <QVariantMap>
+#include <array>
 
-namespace BitTorrent
-{
-    class TorrentHandle;
-}
+#include <QString>
+
+#include "base/bittorrent/torrenthandle.h"
+
+class JsonWriter;
 
 // Torrent keys
 const char KEY_TORRENT_HASH[] = "hash";
@@ -79,4 +80,70 @@ const char KEY_TORRENT_TOTAL_SIZE[] = "total_size";
 const char KEY_TORRENT_AUTO_TORRENT_MANAGEMENT[] = "auto_tmm";
 const char KEY_TORRENT_TIME_ACTIVE[] = "time_active";
 
-QVariantMap serialize(const BitTorrent::TorrentHandle &torrent);
+// Plain copy of the torrent properties exposed by the Web API
+struct TorrentSnapshot
+{
+    QString hash;
+    QString name;
+    QString magnetUri;
+    qlonglong size = 0;
+    qreal progress = 0;
+    int dlSpeed = 0;
+    int upSpeed = 0;
+    int priority = 0;
+    int numSeeds = 0;
+    int numComplete = 0;
+    int numLeechs = 0;
+    int numIncomplete = 0;
+    qreal ratio = 0;
+    qulonglong eta = 0;
+    BitTorrent::TorrentState state = BitTorrent::TorrentState::Unknown;
+    bool sequentialDownload = false;
+    bool hasMetadata = false;
+    bool firstLastPiecePrio = false;
+    QString category;
+    QString tags;
+    bool superSeeding = false;
+    bool forceStart = false;
+    QString savePath;
+    uint addedOn = 0;
+    uint completionOn = 0;
+    QString tracker;
+    int dlLimit = 0;
+    int upLimit = 0;
+    qlonglong downloaded = 0;
+    qlonglong uploaded = 0;
+    qlonglong downloadedSession = 0;
+    qlonglong uploadedSession = 0;
+    qlonglong amountLeft = 0;
+    qlonglong completed = 0;
+    qreal maxRatio = 0;
+    int maxSeedingTime = 0;
+    qreal ratioLimit = 0;
+    int seedingTimeLimit = 0;
+    uint seenComplete = 0;
+    uint lastActivity = 0;
+    qlonglong totalSize = 0;
+    bool autoTMM = false;
+    int timeActive = 0;
+};
+
+// Number of fields written by serialize(), not counting the hash
+const int TORRENT_FIELD_COUNT = 41;
+
+// Version of the last change of every field, in serialization order
+using TorrentFieldVersions = std::array<quint64, TORRENT_FIELD_COUNT>;
+using TorrentLessThan = bool (*)(const TorrentSnapshot &left, const TorrentSnapshot &right);
+
+TorrentSnapshot takeSnapshot(const BitTorrent::TorrentHandle &torrent);
+
+// Write the torrent fields as members of the current JSON object
+void serialize(JsonWriter &writer, const TorrentSnapshot &torrent, bool includeHash = true);
+// Same as above but only the fields changed after the given version are written.
+// Returns the number of written fields.
+int serializeChangedSince(JsonWriter &writer, const TorrentSnapshot &torrent, const TorrentFieldVersions &versions, quint64 version);
+// Sets the version of the fields that differ from prevTorrent.
+// Returns false if there are no such fields.
+bool updateFieldVersions(TorrentFieldVersions &versions, const TorrentSnapshot &torrent, const TorrentSnapshot &prevTorrent, quint64 version);
+// Returns nullptr if there is no field with such key
+TorrentLessThan torrentLessThan(const QString &key);
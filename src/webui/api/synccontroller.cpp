@@ -28,7 +28,11 @@
 
 #include "synccontroller.h"
 
+#include <algorithm>
+
+#include <QHostAddress>
 #include <QJsonObject>
+#include <QVector>
 
 #include "base/bittorrent/peerinfo.h"
 #include "base/bittorrent/session.h"
@@ -39,9 +43,14 @@
 #include "base/utils/string.h"
 #include "apierror.h"
 #include "isessionmanager.h"
+#include "serialize/jsonwriter.h"
 #include "serialize/serialize_torrent.h"
+#include "torrentsnapshotcache.h"
 
 // Sync main data keys
+const char KEY_SYNC_MAINDATA_TORRENTS[] = "torrents";
+const char KEY_SYNC_MAINDATA_CATEGORIES[] = "categories";
+const char KEY_SYNC_MAINDATA_SERVER_STATE[] = "server_state";
 const char KEY_SYNC_MAINDATA_QUEUEING[] = "queueing";
 const char KEY_SYNC_MAINDATA_USE_ALT_SPEED_LIMITS[] = "use_alt_speed_limits";
 const char KEY_SYNC_MAINDATA_REFRESH_INTERVAL[] = "refresh_interval";
@@ -310,6 +319,63 @@ namespace
 
         return syncData;
     }
+
+    void writeKeys(JsonWriter &writer, const char *key, const QStringList &keys)
+    {
+        writer.writeKey(key);
+        writer.beginArray();
+        for (const QString &item : keys)
+            writer.writeValue(item);
+        writer.endArray();
+    }
+
+    // Writes torrents changed after the given version. There is no version on full update.
+    void writeTorrents(JsonWriter &writer, const TorrentSnapshotCache &cache, const quint64 *sinceVersion)
+    {
+        const JsonWriter::Mark torrentsMark = writer.mark();
+        bool hasChangedTorrents = false;
+
+        writer.writeKey(KEY_SYNC_MAINDATA_TORRENTS);
+        writer.beginObject();
+        const QVector<TorrentSnapshot> &torrents = cache.snapshots();
+        for (int i = 0; i < torrents.size(); ++i) {
+            const TorrentSnapshot &torrent = torrents[i];
+            if (!sinceVersion) {
+                writer.writeKey(torrent.hash);
+                writer.beginObject();
+                serialize(writer, torrent, false);
+                writer.endObject();
+                continue;
+            }
+
+            const TorrentFieldVersions &versions = cache.fieldVersions(i);
+            if (std::none_of(versions.cbegin(), versions.cend()
+                             , [sinceVersion](const quint64 version) { return (version > *sinceVersion); }))
+                continue;
+
+            writer.writeKey(torrent.hash);
+            writer.beginObject();
+            serializeChangedSince(writer, torrent, versions, *sinceVersion);
+            writer.endObject();
+            hasChangedTorrents = true;
+        }
+        writer.endObject();
+
+        if (!sinceVersion) return;
+
+        if (!hasChangedTorrents)
+            writer.rollback(torrentsMark);
+
+        const QStringList removedTorrents = cache.removedSince(*sinceVersion);
+        if (!removedTorrents.isEmpty())
+            writeKeys(writer, "torrents_removed", removedTorrents);
+    }
+}
+
+SyncController::SyncController(ISessionManager *sessionManager, TorrentSnapshotCache *torrentSnapshots, QObject *parent)
+    : APIController(sessionManager, parent)
+    , m_torrentSnapshots(torrentSnapshots)
+{
 }
 
 // The function returns the changed data from the server to synchronize with the web client.
@@ -373,46 +439,83 @@ namespace
 //   - rid (int): last response id
 void SyncController::maindataAction()
 {
+    // Every response remembers the versions of the data it was built from.
+    // A client is then sent only the data changed since the versions of the last
+    // response it has accepted, or everything if those are already forgotten.
     auto lastResponse = sessionManager()->session()->getData(QLatin1String("syncMainDataLastResponse")).toMap();
     auto lastAcceptedResponse = sessionManager()->session()->getData(QLatin1String("syncMainDataLastAcceptedResponse")).toMap();
 
-    QVariantMap data;
-    QVariantHash torrents;
+    const int acceptedResponseId {params()["rid"].toInt()};
+    int lastResponseId = lastResponse.value(KEY_RESPONSE_ID).toInt();
+    if ((acceptedResponseId > 0) && (lastResponseId == acceptedResponseId))
+        lastAcceptedResponse = lastResponse;
 
     BitTorrent::Session *const session = BitTorrent::Session::instance();
 
-    foreach (BitTorrent::TorrentHandle *const torrent, session->torrents()) {
-        QVariantMap map = serialize(*torrent);
-        map.remove(KEY_TORRENT_HASH);
-
-        // Calculated last activity time can differ from actual value by up to 10 seconds (this is a libtorrent issue).
-        // So we don't need unnecessary updates of last activity time in response.
-        if (lastResponse.contains("torrents") && lastResponse["torrents"].toHash().contains(torrent->hash()) &&
-                lastResponse["torrents"].toHash()[torrent->hash()].toMap().contains(KEY_TORRENT_LAST_ACTIVITY_TIME)) {
-            uint lastValue = lastResponse["torrents"].toHash()[torrent->hash()].toMap()[KEY_TORRENT_LAST_ACTIVITY_TIME].toUInt();
-            if (qAbs(static_cast<int>(lastValue - map[KEY_TORRENT_LAST_ACTIVITY_TIME].toUInt())) < 15)
-                map[KEY_TORRENT_LAST_ACTIVITY_TIME] = lastValue;
-        }
-
-        torrents[torrent->hash()] = map;
-    }
-
-    data["torrents"] = torrents;
-
-    QVariantList categories;
+    QVariantMap categories;
     for (auto i = session->categories().cbegin(); i != session->categories().cend(); ++i)
-        categories << i.key();
-
-    data["categories"] = categories;
+        categories[i.key()] = true;
+    m_categories.update(categories);
 
     QVariantMap serverState = getTranserInfo();
     serverState[KEY_SYNC_MAINDATA_QUEUEING] = session->isQueueingSystemEnabled();
     serverState[KEY_SYNC_MAINDATA_USE_ALT_SPEED_LIMITS] = session->isAltGlobalSpeedLimitEnabled();
     serverState[KEY_SYNC_MAINDATA_REFRESH_INTERVAL] = session->refreshInterval();
-    data["server_state"] = serverState;
+    m_serverState.update(serverState);
+
+    m_torrentSnapshots->refresh();
+
+    const quint64 torrentsVersion = lastAcceptedResponse.value(KEY_SYNC_MAINDATA_TORRENTS).toULongLong();
+    const quint64 categoriesVersion = lastAcceptedResponse.value(KEY_SYNC_MAINDATA_CATEGORIES).toULongLong();
+    const quint64 serverStateVersion = lastAcceptedResponse.value(KEY_SYNC_MAINDATA_SERVER_STATE).toULongLong();
+    const bool fullUpdate = (acceptedResponseId <= 0)
+            || (lastAcceptedResponse.value(KEY_RESPONSE_ID).toInt() != acceptedResponseId)
+            || !m_torrentSnapshots->isTracked(torrentsVersion)
+            || !m_categories.isTracked(categoriesVersion)
+            || !m_serverState.isTracked(serverStateVersion);
+
+    lastResponseId = lastResponseId % 1000000 + 1;  // cycle between 1 and 1000000
+
+    QByteArray json;
+    JsonWriter writer(json);
+    writer.beginObject();
+    writer.writeKey(KEY_RESPONSE_ID);
+    writer.writeValue(lastResponseId);
+    if (fullUpdate) {
+        writer.writeKey(KEY_FULL_UPDATE);
+        writer.writeValue(true);
+
+        writeTorrents(writer, *m_torrentSnapshots, nullptr);
+        writeKeys(writer, KEY_SYNC_MAINDATA_CATEGORIES, m_categories.changedSince(0).keys());
+        writer.writeKey(KEY_SYNC_MAINDATA_SERVER_STATE);
+        writer.writeValue(m_serverState.changedSince(0));
+    }
+    else {
+        writeTorrents(writer, *m_torrentSnapshots, &torrentsVersion);
+
+        const QStringList changedCategories = m_categories.changedSince(categoriesVersion).keys();
+        if (!changedCategories.isEmpty())
+            writeKeys(writer, KEY_SYNC_MAINDATA_CATEGORIES, changedCategories);
+        const QStringList removedCategories = m_categories.removedSince(categoriesVersion);
+        if (!removedCategories.isEmpty())
+            writeKeys(writer, "categories_removed", removedCategories);
+
+        const QVariantMap changedServerState = m_serverState.changedSince(serverStateVersion);
+        if (!changedServerState.isEmpty()) {
+            writer.writeKey(KEY_SYNC_MAINDATA_SERVER_STATE);
+            writer.writeValue(changedServerState);
+        }
+    }
+    writer.endObject();
 
-    const int acceptedResponseId {params()["rid"].toInt()};
-    setResult(QJsonObject::fromVariantMap(generateSyncData(acceptedResponseId, data, lastAcceptedResponse, lastResponse)));
+    setJsonResult(json);
+
+    if (fullUpdate)
+        lastAcceptedResponse.clear();
+    lastResponse[KEY_RESPONSE_ID] = lastResponseId;
+    lastResponse[KEY_SYNC_MAINDATA_TORRENTS] = m_torrentSnapshots->version();
+    lastResponse[KEY_SYNC_MAINDATA_CATEGORIES] = m_categories.version();
+    lastResponse[KEY_SYNC_MAINDATA_SERVER_STATE] = m_serverState.version();
 
     sessionManager()->session()->setData(QLatin1String("syncMainDataLastResponse"), lastResponse);
     sessionManager()->session()->setData(QLatin1String("syncMainDataLastAcceptedResponse"), lastAcceptedResponse);
@@ -433,7 +536,7 @@ void SyncController::torrentPeersAction()
 
     QVariantMap data;
     QVariantHash peers;
-    QList<BitTorrent::PeerInfo> peersList = torrent->peers();
+    const QList<BitTorrent::PeerInfo> peersList = torrent->peers();
 #ifndef DISABLE_COUNTRIES_RESOLUTION
     bool resolvePeerCountries = Preferences::instance()->resolvePeerCountries();
 #else
@@ -442,13 +545,56 @@ void SyncController::torrentPeersAction()
 
     data[KEY_SYNC_TORRENT_PEERS_SHOW_FLAGS] = resolvePeerCountries;
 
-    foreach (const BitTorrent::PeerInfo &pi, peersList) {
+    QVector<QString> peerKeys;
+    peerKeys.reserve(peersList.size());
+    for (const BitTorrent::PeerInfo &pi : peersList)
+        peerKeys.append(pi.address().ip.toString() + ":" + QString::number(pi.address().port));
+
+#ifndef DISABLE_COUNTRIES_RESOLUTION
+    // Peers keep the country of the previous response,
+    // the new ones are resolved all at once
+    const QVariantHash lastPeers = lastResponse.value(QLatin1String("peers")).toHash();
+    QVector<QString> countries(peersList.size());
+    if (resolvePeerCountries) {
+        QVector<QHostAddress> newAddresses;
+        QVector<int> newPeerIndexes;
+        for (int i = 0; i < peersList.size(); ++i) {
+            if (!lastPeers.value(peerKeys[i]).toMap().contains(KEY_PEER_COUNTRY_CODE)) {
+                newAddresses.append(peersList[i].address().ip);
+                newPeerIndexes.append(i);
+            }
+        }
+
+        const QVector<QString> newCountries = Net::GeoIPManager::instance()->lookup(newAddresses);
+        for (int i = 0; i < newPeerIndexes.size(); ++i)
+            countries[newPeerIndexes[i]] = newCountries[i];
+    }
+    QHash<QString, QString> countryNames;
+#endif
+
+    // Many peers download the same pieces
+    const BitTorrent::TorrentInfo torrentInfo = torrent->info();
+    QHash<int, QString> pieceFiles;
+
+    for (int i = 0; i < peersList.size(); ++i) {
+        const BitTorrent::PeerInfo &pi = peersList[i];
         if (pi.address().ip.isNull()) continue;
         QVariantMap peer;
 #ifndef DISABLE_COUNTRIES_RESOLUTION
         if (resolvePeerCountries) {
-            peer[KEY_PEER_COUNTRY_CODE] = pi.country().toLower();
-            peer[KEY_PEER_COUNTRY] = Net::GeoIPManager::CountryName(pi.country());
+            const QVariantMap lastPeer = lastPeers.value(peerKeys[i]).toMap();
+            if (lastPeer.contains(KEY_PEER_COUNTRY_CODE)) {
+                peer[KEY_PEER_COUNTRY_CODE] = lastPeer[KEY_PEER_COUNTRY_CODE];
+                peer[KEY_PEER_COUNTRY] = lastPeer[KEY_PEER_COUNTRY];
+            }
+            else {
+                const QString &country = countries[i];
+                auto countryName = countryNames.find(country);
+                if (countryName == countryNames.end())
+                    countryName = countryNames.insert(country, Net::GeoIPManager::CountryName(country));
+                peer[KEY_PEER_COUNTRY_CODE] = country.toLower();
+                peer[KEY_PEER_COUNTRY] = countryName.value();
+            }
         }
 #endif
         peer[KEY_PEER_IP] = pi.address().ip.toString();
@@ -463,9 +609,14 @@ void SyncController::torrentPeersAction()
         peer[KEY_PEER_FLAGS] = pi.flags();
         peer[KEY_PEER_FLAGS_DESCRIPTION] = pi.flagsDescription();
         peer[KEY_PEER_RELEVANCE] = pi.relevance();
-        peer[KEY_PEER_FILES] = torrent->info().filesForPiece(pi.downloadingPieceIndex()).join(QLatin1String("\n"));
 
-        peers[pi.address().ip.toString() + ":" + QString::number(pi.address().port)] = peer;
+        const int pieceIndex = pi.downloadingPieceIndex();
+        auto files = pieceFiles.find(pieceIndex);
+        if (files == pieceFiles.end())
+            files = pieceFiles.insert(pieceIndex, torrentInfo.filesForPiece(pieceIndex).join(QLatin1String("\n")));
+        peer[KEY_PEER_FILES] = files.value();
+
+        peers[peerKeys[i]] = peer;
     }
 
     data["peers"] = peers;
@@ -29,6 +29,9 @@
 #pragma once
 
 #include "apicontroller.h"
+#include "changejournal.h"
+
+class TorrentSnapshotCache;
 
 class SyncController : public APIController
 {
@@ -36,9 +39,14 @@ class SyncController : public APIController
     Q_DISABLE_COPY(SyncController)
 
 public:
-    using APIController::APIController;
+    SyncController(ISessionManager *sessionManager, TorrentSnapshotCache *torrentSnapshots, QObject *parent = nullptr);
 
 private slots:
     void maindataAction();
     void torrentPeersAction();
+
+private:
+    TorrentSnapshotCache *m_torrentSnapshots;
+    ChangeJournal m_categories;
+    ChangeJournal m_serverState;
 };
@@ -49,8 +49,10 @@
 #include "base/torrentfilter.h"
 #include "base/utils/fs.h"
 #include "base/utils/string.h"
+#include "serialize/jsonwriter.h"
 #include "serialize/serialize_torrent.h"
 #include "apierror.h"
+#include "torrentsnapshotcache.h"
 
 // Tracker keys
 const char KEY_TRACKER_URL[] = "url";
@@ -105,11 +107,61 @@ const char KEY_FILE_IS_SEED[] = "is_seed";
 const char KEY_FILE_PIECE_RANGE[] = "piece_range";
 const char KEY_FILE_AVAILABILITY[] = "availability";
 
+// Packed piece states keys
+const char KEY_PIECES_VERSION[] = "version";
+const char KEY_PIECES_COUNT[] = "count";
+const char KEY_PIECES_FULL[] = "full";
+const char KEY_PIECES_STATES[] = "states";
+const char KEY_PIECES_CHANGES[] = "changes";
+
 namespace
 {
     using Utils::String::parseBool;
     using Utils::String::parseTriStateBool;
 
+    const int MAX_TRACKED_PIECE_STATES = 16;
+
+    enum PieceState : char
+    {
+        PieceMissing = 0,
+        PieceDownloading = 1,
+        PieceDownloaded = 2
+    };
+
+    // Returns the state of each piece in a byte
+    QByteArray collectPieceStates(const BitTorrent::TorrentHandle *torrent)
+    {
+        const BitTorrent::Bitfield pieces = torrent->pieces();
+        QByteArray states(pieces.size(), PieceMissing);
+        for (int i = 0; i < pieces.size(); ++i) {
+            if (pieces[i])
+                states[i] = PieceDownloaded;
+        }
+
+        // The download queue is requested from libtorrent synchronously,
+        // there is no need to do it if all the pieces are already downloaded.
+        if (pieces.count() < pieces.size()) {
+            const QBitArray dlstates = torrent->downloadingPieces();
+            const int count = qMin(states.size(), dlstates.size());
+            for (int i = 0; i < count; ++i) {
+                if (dlstates[i])
+                    states[i] = PieceDownloading;
+            }
+        }
+
+        return states;
+    }
+
+    // Packs 2 bits per piece, the first piece goes to the most significant bits
+    QByteArray packPieceStates(const char *states, const int count)
+    {
+        QByteArray packed(((count + 3) / 4), 0);
+        for (int i = 0; i < count; ++i)
+            packed[i / 4] = packed[i / 4] | static_cast<char>((states[i] & 0x3) << (6 - ((i % 4) * 2)));
+
+        return packed;
+    }
+
     void applyToTorrents(const QStringList &hashes, const std::function<void (BitTorrent::TorrentHandle *torrent)> &func)
     {
         if ((hashes.size() == 1) && (hashes[0] == QLatin1String("all"))) {
@@ -126,6 +178,13 @@ namespace
     }
 }
 
+TorrentsController::TorrentsController(ISessionManager *sessionManager, TorrentSnapshotCache *torrentSnapshots, QObject *parent)
+    : APIController(sessionManager, parent)
+    , m_torrentSnapshots(torrentSnapshots)
+    , m_pieceStatesVersion(0)
+{
+}
+
 // Returns all the torrents in JSON format.
 // The return value is a JSON-formatted list of dictionaries.
 // The dictionary keys are:
@@ -163,20 +222,26 @@ void TorrentsController::infoAction()
     int limit {params()["limit"].toInt()};
     int offset {params()["offset"].toInt()};
 
-    QVariantList torrentList;
+    m_torrentSnapshots->refresh();
+    QVector<const TorrentSnapshot *> torrentList;
+    torrentList.reserve(m_torrentSnapshots->snapshots().size());
     TorrentFilter torrentFilter(filter, TorrentFilter::AnyHash, category);
     foreach (BitTorrent::TorrentHandle *const torrent, BitTorrent::Session::instance()->torrents()) {
-        if (torrentFilter.match(torrent))
-            torrentList.append(serialize(*torrent));
+        if (torrentFilter.match(torrent)) {
+            const TorrentSnapshot *snapshot = m_torrentSnapshots->find(torrent->hash());
+            if (snapshot)
+                torrentList.append(snapshot);
+        }
     }
 
-    std::sort(torrentList.begin(), torrentList.end()
-              , [sortedColumn, reverse](const QVariant &torrent1, const QVariant &torrent2)
-    {
-        return reverse
-                ? (torrent1.toMap().value(sortedColumn) > torrent2.toMap().value(sortedColumn))
-                : (torrent1.toMap().value(sortedColumn) < torrent2.toMap().value(sortedColumn));
-    });
+    const TorrentLessThan lessThan = torrentLessThan(sortedColumn);
+    if (lessThan) {
+        std::sort(torrentList.begin(), torrentList.end()
+                  , [lessThan, reverse](const TorrentSnapshot *torrent1, const TorrentSnapshot *torrent2)
+        {
+            return reverse ? lessThan(*torrent2, *torrent1) : lessThan(*torrent1, *torrent2);
+        });
+    }
 
     const int size = torrentList.size();
     // normalize offset
@@ -191,7 +256,19 @@ void TorrentsController::infoAction()
     if ((limit > 0) || (offset > 0))
         torrentList = torrentList.mid(offset, limit);
 
-    setResult(QJsonArray::fromVariantList(torrentList));
+    QByteArray json;
+    // Rough estimate of serialized torrent size to avoid reallocations
+    json.reserve(torrentList.size() * 1024);
+    JsonWriter writer(json);
+    writer.beginArray();
+    for (const TorrentSnapshot *torrent : qAsConst(torrentList)) {
+        writer.beginObject();
+        serialize(writer, *torrent);
+        writer.endObject();
+    }
+    writer.endArray();
+
+    setJsonResult(json);
 }
 
 // Returns the properties for a torrent in JSON format.
@@ -372,27 +449,28 @@ void TorrentsController::filesAction()
         throw APIError(APIErrorType::NotFound);
 
     if (torrent->hasMetadata()) {
+        const BitTorrent::FileTree files = torrent->fileTree();
         const QVector<int> priorities = torrent->filePriorities();
         const QVector<qreal> fp = torrent->filesProgress();
         const QVector<qreal> fileAvailability = torrent->availableFileFractions();
-        const BitTorrent::TorrentInfo info = torrent->info();
-        for (int i = 0; i < torrent->filesCount(); ++i) {
+        const bool isSeed = torrent->isSeed();
+        for (int i = 0; i < files.filesCount(); ++i) {
             QVariantMap fileDict;
             fileDict[KEY_FILE_PROGRESS] = fp[i];
             fileDict[KEY_FILE_PRIORITY] = priorities[i];
-            fileDict[KEY_FILE_SIZE] = torrent->fileSize(i);
+            fileDict[KEY_FILE_SIZE] = files.fileSize(i);
             fileDict[KEY_FILE_AVAILABILITY] = fileAvailability[i];
 
-            QString fileName = torrent->filePath(i);
+            QString fileName = files.filePath(i);
             if (fileName.endsWith(QB_EXT, Qt::CaseInsensitive))
                 fileName.chop(QB_EXT.size());
             fileDict[KEY_FILE_NAME] = Utils::Fs::toNativePath(fileName);
 
-            const BitTorrent::TorrentInfo::PieceRange idx = info.filePieces(i);
+            const BitTorrent::TorrentInfo::PieceRange idx = files.filePieces(i);
             fileDict[KEY_FILE_PIECE_RANGE] = QVariantList {idx.first(), idx.last()};
 
             if (i == 0)
-                fileDict[KEY_FILE_IS_SEED] = torrent->isSeed();
+                fileDict[KEY_FILE_IS_SEED] = isSeed;
 
             fileList.append(fileDict);
         }
@@ -436,18 +514,87 @@ void TorrentsController::pieceStatesAction()
     if (!torrent)
         throw APIError(APIErrorType::NotFound);
 
-    const QBitArray states = torrent->pieces();
+    const QByteArray states = collectPieceStates(torrent);
     pieceStates.reserve(states.size());
-    for (int i = 0; i < states.size(); ++i)
-        pieceStates.append(static_cast<int>(states[i]) * 2);
+    for (const char state : states)
+        pieceStates.append(static_cast<int>(state));
 
-    const QBitArray dlstates = torrent->downloadingPieces();
-    for (int i = 0; i < states.size(); ++i) {
-        if (dlstates[i])
-            pieceStates[i] = 1;
+    setResult(QJsonArray::fromVariantList(pieceStates));
+}
+
+// Returns the piece hashes of a torrent as base64 encoded concatenation
+// of raw SHA-1 digests (20 bytes per piece).
+void TorrentsController::pieceHashesPackedAction()
+{
+    checkParams({"hash"});
+
+    const QString hash {params()["hash"]};
+    BitTorrent::TorrentHandle *const torrent = BitTorrent::Session::instance()->findTorrent(hash);
+    if (!torrent)
+        throw APIError(APIErrorType::NotFound);
+
+    const QVector<QByteArray> hashes = torrent->info().pieceHashes();
+    QByteArray rawHashes;
+    rawHashes.reserve(hashes.size() * 20);
+    for (const QByteArray &pieceHash : hashes)
+        rawHashes += pieceHash;
+
+    setResult(QString::fromLatin1(rawHashes.toBase64()));
+}
+
+// Returns the piece states of a torrent packed in 2 bits per piece (4 pieces per byte,
+// the first piece in the most significant bits), see pieceStatesAction() for the values.
+// Optional parameter "version" is the version got from the previous request,
+// then only the pieces changed since that version are returned.
+// The return value is a JSON-formatted dictionary, the keys are:
+//   - "version": Version of the returned piece states
+//   - "count": Number of pieces
+//   - "full": Whether all the piece states are returned
+//   - "states": Base64 encoded states of all the pieces (if "full" is true)
+//   - "changes": Array of changed ranges [first piece, piece count, base64 encoded states] (if "full" is false)
+void TorrentsController::pieceStatesPackedAction()
+{
+    checkParams({"hash"});
+
+    const QString hash {params()["hash"]};
+    BitTorrent::TorrentHandle *const torrent = BitTorrent::Session::instance()->findTorrent(hash);
+    if (!torrent)
+        throw APIError(APIErrorType::NotFound);
+
+    bool hasVersion = false;
+    const quint64 sinceVersion = params()["version"].toULongLong(&hasVersion);
+
+    m_pieceStatesUsage.removeOne(hash);
+    m_pieceStatesUsage.append(hash);
+    if (m_pieceStatesUsage.size() > MAX_TRACKED_PIECE_STATES)
+        m_pieceStates.remove(m_pieceStatesUsage.takeFirst());
+
+    PieceStateJournal &journal = m_pieceStates[hash];
+    if (journal.update(collectPieceStates(torrent), (m_pieceStatesVersion + 1)))
+        ++m_pieceStatesVersion;
+
+    const QByteArray &states = journal.states();
+    QJsonObject result {
+        {KEY_PIECES_VERSION, static_cast<double>(journal.version())},
+        {KEY_PIECES_COUNT, states.size()}
+    };
+
+    if (hasVersion && journal.isTracked(sinceVersion)) {
+        QJsonArray changes;
+        for (const QPair<int, int> &range : journal.changedSince(sinceVersion)) {
+            const QByteArray packed = packPieceStates((states.constData() + range.first), range.second);
+            changes.append(QJsonArray {range.first, range.second, QString::fromLatin1(packed.toBase64())});
+        }
+
+        result[KEY_PIECES_FULL] = false;
+        result[KEY_PIECES_CHANGES] = changes;
+    }
+    else {
+        result[KEY_PIECES_FULL] = true;
+        result[KEY_PIECES_STATES] = QString::fromLatin1(packPieceStates(states.constData(), states.size()).toBase64());
     }
 
-    setResult(QJsonArray::fromVariantList(pieceStates));
+    setResult(result);
 }
 
 void TorrentsController::addAction()
@@ -28,7 +28,13 @@
 
 #pragma once
 
+#include <QHash>
+#include <QStringList>
+
 #include "apicontroller.h"
+#include "piecestatejournal.h"
+
+class TorrentSnapshotCache;
 
 class TorrentsController : public APIController
 {
@@ -36,7 +42,7 @@ class TorrentsController : public APIController
     Q_DISABLE_COPY(TorrentsController)
 
 public:
-    using APIController::APIController;
+    TorrentsController(ISessionManager *sessionManager, TorrentSnapshotCache *torrentSnapshots, QObject *parent = nullptr);
 
 private slots:
     void infoAction();
@@ -46,6 +52,8 @@ private slots:
     void filesAction();
     void pieceHashesAction();
     void pieceStatesAction();
+    void pieceHashesPackedAction();
+    void pieceStatesPackedAction();
     void resumeAction();
     void pauseAction();
     void recheckAction();
@@ -72,4 +80,11 @@ private slots:
     void setForceStartAction();
     void toggleSequentialDownloadAction();
     void toggleFirstLastPiecePrioAction();
+
+private:
+    TorrentSnapshotCache *m_torrentSnapshots;
+    // piece states of the torrents recently requested in packed form, the most recent last
+    QHash<QString, PieceStateJournal> m_pieceStates;
+    QStringList m_pieceStatesUsage;
+    quint64 m_pieceStatesVersion;
 };
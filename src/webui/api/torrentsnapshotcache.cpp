@@ -0,0 +1,230 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#include "torrentsnapshotcache.h"
+
+#include <algorithm>
+
+#include "base/bittorrent/session.h"
+#include "base/bittorrent/torrenthandle.h"
+#include "base/global.h"
+
+namespace
+{
+    // Calculated last activity time can differ from actual value by up to 10 seconds (this is a libtorrent issue).
+    // So we don't need unnecessary updates of last activity time.
+    const int LAST_ACTIVITY_TOLERANCE = 15;
+
+    // Clients which are behind more removals than that will get a full update
+    const int MAX_REMOVED_TORRENTS = 1000;
+}
+
+TorrentSnapshotCache::TorrentSnapshotCache(QObject *parent)
+    : QObject(parent)
+    , m_version(0)
+    , m_oldestVersion(0)
+{
+    using namespace BitTorrent;
+
+    foreach (TorrentHandle *const torrent, Session::instance()->torrents())
+        handleTorrentAdded(torrent);
+
+    connect(Session::instance(), &Session::torrentAdded, this, &TorrentSnapshotCache::handleTorrentAdded);
+    connect(Session::instance(), &Session::torrentAboutToBeRemoved, this, &TorrentSnapshotCache::handleTorrentAboutToBeRemoved);
+    connect(Session::instance(), &Session::torrentsUpdated, this, &TorrentSnapshotCache::handleTorrentsUpdated);
+
+    // Changes that aren't reported by state updates
+    connect(Session::instance(), &Session::torrentFinished, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentMetadataLoaded, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentResumed, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentPaused, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentFinishedChecking, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentSavePathChanged, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentSavingModeChanged, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentCategoryChanged, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentTagAdded, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentTagRemoved, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentShareLimitChanged, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentNameChanged, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentSpeedLimitChanged, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::torrentFirstLastPiecePriorityChanged, this, &TorrentSnapshotCache::handleTorrentChanged);
+    // The magnet URI contains the trackers and URL seeds
+    connect(Session::instance(), &Session::trackersAdded, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::trackersRemoved, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::trackersChanged, this, &TorrentSnapshotCache::handleTorrentChanged);
+    connect(Session::instance(), &Session::urlSeedsChanged, this, &TorrentSnapshotCache::handleTorrentChanged);
+    // Torrents using the global share limits report them as their own
+    connect(Session::instance(), &Session::globalShareLimitChanged, this, &TorrentSnapshotCache::handleAllTorrentsChanged);
+}
+
+void TorrentSnapshotCache::refresh()
+{
+    if (m_outdatedIndexes.isEmpty()) return;
+
+    const quint64 newVersion = m_version + 1;
+    bool changed = false;
+    for (const int i : qAsConst(m_outdatedIndexes)) {
+        TorrentSnapshot snapshot = takeSnapshot(*m_torrents[i]);
+        TorrentSnapshot &currentSnapshot = m_snapshots[i];
+        if (m_states[i] == ItemState::Added) {
+            m_fieldVersions[i].fill(newVersion);
+            changed = true;
+        }
+        else {
+            if ((currentSnapshot.lastActivity > 0) && (snapshot.lastActivity > 0)
+                    && (qAbs(static_cast<int>(snapshot.lastActivity - currentSnapshot.lastActivity)) < LAST_ACTIVITY_TOLERANCE))
+                snapshot.lastActivity = currentSnapshot.lastActivity;
+
+            if (updateFieldVersions(m_fieldVersions[i], snapshot, currentSnapshot, newVersion))
+                changed = true;
+        }
+
+        currentSnapshot = snapshot;
+        m_states[i] = ItemState::UpToDate;
+    }
+
+    m_outdatedIndexes.clear();
+    if (changed)
+        m_version = newVersion;
+}
+
+quint64 TorrentSnapshotCache::version() const
+{
+    return m_version;
+}
+
+bool TorrentSnapshotCache::isTracked(const quint64 version) const
+{
+    return ((version >= m_oldestVersion) && (version <= m_version));
+}
+
+const QVector<TorrentSnapshot> &TorrentSnapshotCache::snapshots() const
+{
+    return m_snapshots;
+}
+
+const TorrentSnapshot *TorrentSnapshotCache::find(const QString &hash) const
+{
+    const auto it = m_indexes.constFind(hash);
+    if (it == m_indexes.constEnd()) return nullptr;
+
+    return &m_snapshots.at(it.value());
+}
+
+const TorrentFieldVersions &TorrentSnapshotCache::fieldVersions(const int index) const
+{
+    return m_fieldVersions.at(index);
+}
+
+QStringList TorrentSnapshotCache::removedSince(const quint64 version) const
+{
+    QStringList hashes;
+    auto it = std::upper_bound(m_removedTorrents.cbegin(), m_removedTorrents.cend(), version
+                               , [](const quint64 value, const QPair<quint64, QString> &item)
+    {
+        return (value < item.first);
+    });
+
+    for (; it != m_removedTorrents.cend(); ++it) {
+        // Torrents re-added since then are reported as new ones
+        if (!m_indexes.contains(it->second))
+            hashes << it->second;
+    }
+
+    return hashes;
+}
+
+void TorrentSnapshotCache::handleTorrentAdded(BitTorrent::TorrentHandle *const torrent)
+{
+    const QString hash = torrent->hash();
+    if (m_indexes.contains(hash)) return;
+
+    m_indexes.insert(hash, m_torrents.size());
+    m_snapshots.append(TorrentSnapshot());
+    m_fieldVersions.append(TorrentFieldVersions());
+    m_torrents.append(torrent);
+    m_states.append(ItemState::Added);
+    m_outdatedIndexes.append(m_torrents.size() - 1);
+}
+
+void TorrentSnapshotCache::handleTorrentAboutToBeRemoved(BitTorrent::TorrentHandle *const torrent)
+{
+    const auto it = m_indexes.find(torrent->hash());
+    if (it == m_indexes.end()) return;
+
+    const int index = it.value();
+    m_indexes.erase(it);
+    if (m_states[index] != ItemState::UpToDate)
+        m_outdatedIndexes.removeOne(index);
+
+    // Fill the gap with the last item to keep the arrays contiguous
+    const int lastIndex = m_torrents.size() - 1;
+    if (index != lastIndex) {
+        if (m_states[lastIndex] != ItemState::UpToDate)
+            m_outdatedIndexes[m_outdatedIndexes.indexOf(lastIndex)] = index;
+
+        m_snapshots[index] = m_snapshots.last();
+        m_fieldVersions[index] = m_fieldVersions.last();
+        m_torrents[index] = m_torrents.last();
+        m_states[index] = m_states.last();
+        m_indexes[m_torrents[index]->hash()] = index;
+    }
+
+    m_snapshots.removeLast();
+    m_fieldVersions.removeLast();
+    m_torrents.removeLast();
+    m_states.removeLast();
+
+    m_removedTorrents.append(qMakePair(++m_version, QString(torrent->hash())));
+    if (m_removedTorrents.size() > MAX_REMOVED_TORRENTS) {
+        const int count = MAX_REMOVED_TORRENTS / 2;
+        m_oldestVersion = m_removedTorrents[count - 1].first;
+        m_removedTorrents.remove(0, count);
+    }
+}
+
+void TorrentSnapshotCache::handleTorrentChanged(BitTorrent::TorrentHandle *const torrent)
+{
+    const int index = m_indexes.value(torrent->hash(), -1);
+    if ((index >= 0) && (m_states[index] == ItemState::UpToDate)) {
+        m_states[index] = ItemState::Outdated;
+        m_outdatedIndexes.append(index);
+    }
+}
+
+void TorrentSnapshotCache::handleAllTorrentsChanged()
+{
+    for (BitTorrent::TorrentHandle *const torrent : qAsConst(m_torrents))
+        handleTorrentChanged(torrent);
+}
+
+void TorrentSnapshotCache::handleTorrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents)
+{
+    for (BitTorrent::TorrentHandle *const torrent : torrents)
+        handleTorrentChanged(torrent);
+}
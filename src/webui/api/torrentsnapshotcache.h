@@ -0,0 +1,95 @@
+/*
+ * Bittorrent Client using Qt and libtorrent.
+ * Copyright (C) 2018
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give permission to
+ * link this program with the OpenSSL project's "OpenSSL" library (or with
+ * modified versions of it that use the same license as the "OpenSSL" library),
+ * and distribute the linked executables. You must obey the GNU General Public
+ * License in all respects for all of the code used other than "OpenSSL".  If you
+ * modify file(s), you may extend this exception to your version of the file(s),
+ * but you are not obligated to do so. If you do not wish to do so, delete this
+ * exception statement from your version.
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+
+#include "serialize/serialize_torrent.h"
+
+namespace BitTorrent
+{
+    class TorrentHandle;
+}
+
+// Keeps snapshots of all torrents in a contiguous array.
+// Snapshots are refreshed lazily, only for the torrents reported changed by the session.
+// Every refresh which finds any changes bumps the version, and each field remembers
+// the version it was last changed in, so changes since any recent version can be found.
+class TorrentSnapshotCache : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(TorrentSnapshotCache)
+
+public:
+    explicit TorrentSnapshotCache(QObject *parent = nullptr);
+
+    void refresh();
+    quint64 version() const;
+    // Returns false if removals since the given version are already forgotten
+    bool isTracked(quint64 version) const;
+
+    const QVector<TorrentSnapshot> &snapshots() const;
+    const TorrentSnapshot *find(const QString &hash) const;
+    const TorrentFieldVersions &fieldVersions(int index) const;
+    QStringList removedSince(quint64 version) const;
+
+private slots:
+    void handleTorrentAdded(BitTorrent::TorrentHandle *const torrent);
+    void handleTorrentAboutToBeRemoved(BitTorrent::TorrentHandle *const torrent);
+    void handleTorrentChanged(BitTorrent::TorrentHandle *const torrent);
+    void handleTorrentsUpdated(const QVector<BitTorrent::TorrentHandle *> &torrents);
+    void handleAllTorrentsChanged();
+
+private:
+    enum class ItemState : char
+    {
+        UpToDate,
+        Outdated,
+        Added
+    };
+
+    // These are parallel arrays
+    QVector<TorrentSnapshot> m_snapshots;
+    QVector<TorrentFieldVersions> m_fieldVersions;
+    QVector<BitTorrent::TorrentHandle *> m_torrents;
+    QVector<ItemState> m_states;
+
+    QHash<QString, int> m_indexes;
+    // Indexes of the items which aren't up to date
+    QVector<int> m_outdatedIndexes;
+
+    quint64 m_version;
+    quint64 m_oldestVersion;
+    // Ordered by version
+    QVector<QPair<quint64, QString>> m_removedTorrents;
+};
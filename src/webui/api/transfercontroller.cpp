@@ -31,6 +31,7 @@
 #include <QJsonObject>
 
 #include "base/bittorrent/session.h"
+#include "base/bittorrent/tracker.h"
 
 const char KEY_TRANSFER_DLSPEED[] = "dl_info_speed";
 const char KEY_TRANSFER_DLDATA[] = "dl_info_data";
@@ -41,6 +42,18 @@ const char KEY_TRANSFER_UPRATELIMIT[] = "up_rate_limit";
 const char KEY_TRANSFER_DHT_NODES[] = "dht_nodes";
 const char KEY_TRANSFER_CONNECTION_STATUS[] = "connection_status";
 
+const char KEY_TRACKER_ENABLED[] = "enabled";
+const char KEY_TRACKER_TORRENTS[] = "torrents";
+const char KEY_TRACKER_PEERS[] = "peers";
+const char KEY_TRACKER_SEEDERS[] = "seeders";
+const char KEY_TRACKER_LEECHERS[] = "leechers";
+const char KEY_TRACKER_DOWNLOADED[] = "downloaded";
+const char KEY_TRACKER_ANNOUNCES[] = "announces";
+const char KEY_TRACKER_SCRAPES[] = "scrapes";
+const char KEY_TRACKER_TORRENT_STATS[] = "torrent_stats";
+const char KEY_TRACKER_COMPLETE[] = "complete";
+const char KEY_TRACKER_INCOMPLETE[] = "incomplete";
+
 // Returns the global transfer information in JSON format.
 // The return value is a JSON-formatted dictionary.
 // The dictionary keys are:
@@ -111,3 +124,46 @@ void TransferController::speedLimitsModeAction()
 {
     setResult(QString::number(BitTorrent::Session::instance()->isAltGlobalSpeedLimitEnabled()));
 }
+
+// Returns the statistics of the embedded tracker in JSON format.
+// The return value is a JSON-formatted dictionary.
+// The dictionary keys are:
+//   - "enabled": Whether the embedded tracker is enabled
+//   - "torrents": Number of torrents with active peers
+//   - "peers": Number of peers
+//   - "seeders": Number of seeding peers
+//   - "leechers": Number of downloading peers
+//   - "downloaded": Number of completed downloads reported
+//   - "announces": Number of announce requests handled
+//   - "scrapes": Number of scrape requests handled
+//   - "torrent_stats": Dictionary of torrent hash => {"complete", "incomplete", "downloaded"}
+void TransferController::trackerStatsAction()
+{
+    const BitTorrent::Tracker *tracker = BitTorrent::Session::instance()->tracker();
+
+    QJsonObject dict;
+    dict[KEY_TRACKER_ENABLED] = (tracker != nullptr);
+    if (tracker) {
+        const BitTorrent::TrackerStats stats = tracker->stats();
+        dict[KEY_TRACKER_TORRENTS] = stats.torrents;
+        dict[KEY_TRACKER_PEERS] = stats.peers;
+        dict[KEY_TRACKER_SEEDERS] = stats.seeders;
+        dict[KEY_TRACKER_LEECHERS] = (stats.peers - stats.seeders);
+        dict[KEY_TRACKER_DOWNLOADED] = stats.downloaded;
+        dict[KEY_TRACKER_ANNOUNCES] = stats.announces;
+        dict[KEY_TRACKER_SCRAPES] = stats.scrapes;
+
+        QJsonObject torrentStats;
+        const QHash<QByteArray, BitTorrent::TrackerTorrentStats> allTorrentStats = tracker->torrentStats();
+        for (auto i = allTorrentStats.cbegin(); i != allTorrentStats.cend(); ++i) {
+            QJsonObject torrentDict;
+            torrentDict[KEY_TRACKER_COMPLETE] = i->complete;
+            torrentDict[KEY_TRACKER_INCOMPLETE] = i->incomplete;
+            torrentDict[KEY_TRACKER_DOWNLOADED] = i->downloaded;
+            torrentStats[QString::fromLatin1(i.key().toHex())] = torrentDict;
+        }
+        dict[KEY_TRACKER_TORRENT_STATS] = torrentStats;
+    }
+
+    setResult(dict);
+}
@@ -35,8 +35,11 @@
 #include <vector>
 
 #include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
+#include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QJsonDocument>
@@ -48,6 +51,7 @@
 
 #include "base/global.h"
 #include "base/http/httperror.h"
+#include "base/http/responsegenerator.h"
 #include "base/iconprovider.h"
 #include "base/logger.h"
 #include "base/preferences.h"
@@ -64,9 +68,11 @@
 #include "api/rsscontroller.h"
 #include "api/synccontroller.h"
 #include "api/torrentscontroller.h"
+#include "api/torrentsnapshotcache.h"
 #include "api/transfercontroller.h"
 
 constexpr int MAX_ALLOWED_FILESIZE = 10 * 1024 * 1024;
+constexpr int CACHING_STEP_DURATION = 20;  // ms
 
 const QString PATH_PREFIX_IMAGES {"/images/"};
 const QString PATH_PREFIX_THEME {"/theme/"};
@@ -135,6 +141,23 @@ namespace
         }
     }
 
+    bool isETagMatched(const QString &ifNoneMatch, const QString &etag)
+    {
+        // [rfc7232] 3.2. If-None-Match, uses the weak comparison
+        const QStringList tags = ifNoneMatch.split(',', QString::SkipEmptyParts);
+        for (QString tag : tags) {
+            tag = tag.trimmed();
+            if (tag == QLatin1String("*"))
+                return true;
+            if (tag.startsWith(QLatin1String("W/")))
+                tag.remove(0, 2);
+            if (tag == etag)
+                return true;
+        }
+
+        return false;
+    }
+
     inline QUrl urlFromHostHeader(const QString &hostHeader)
     {
         if (!hostHeader.contains(QLatin1String("://")))
@@ -146,12 +169,14 @@ namespace
 WebApplication::WebApplication(QObject *parent)
     : QObject(parent)
 {
+    TorrentSnapshotCache *torrentSnapshots = new TorrentSnapshotCache(this);
+
     registerAPIController(QLatin1String("app"), new AppController(this, this));
     registerAPIController(QLatin1String("auth"), new AuthController(this, this));
     registerAPIController(QLatin1String("log"), new LogController(this, this));
     registerAPIController(QLatin1String("rss"), new RSSController(this, this));
-    registerAPIController(QLatin1String("sync"), new SyncController(this, this));
-    registerAPIController(QLatin1String("torrents"), new TorrentsController(this, this));
+    registerAPIController(QLatin1String("sync"), new SyncController(this, torrentSnapshots, this));
+    registerAPIController(QLatin1String("torrents"), new TorrentsController(this, torrentSnapshots, this));
     registerAPIController(QLatin1String("transfer"), new TransferController(this, this));
 
     declarePublicAPI(QLatin1String("auth/login"));
@@ -391,6 +416,9 @@ void WebApplication::doProcessRequest()
             case QMetaType::QJsonDocument:
                 print(result.toJsonDocument().toJson(QJsonDocument::Compact), Http::CONTENT_TYPE_JSON);
                 break;
+            case QMetaType::QByteArray:
+                print(result.toByteArray(), Http::CONTENT_TYPE_JSON);
+                break;
             default:
                 print(result.toString(), Http::CONTENT_TYPE_TXT);
                 break;
@@ -425,9 +453,13 @@ void WebApplication::configure()
 
     const QString rootFolder = Utils::Fs::expandPathAbs(
                 !pref->isAltWebUiEnabled() ? WWW_FOLDER : pref->getWebUiRootFolder());
-    if (rootFolder != m_rootFolder) {
-        m_translatedFiles.clear();
+    const QString locale = pref->getLocale();
+    if ((rootFolder != m_rootFolder) || (locale != m_locale)) {
+        m_cachedFiles.clear();
         m_rootFolder = rootFolder;
+        m_locale = locale;
+        // fill the cache once the event loop is running so it doesn't delay the startup
+        QTimer::singleShot(0, this, &WebApplication::cacheWebUIFiles);
     }
 }
 
@@ -448,13 +480,32 @@ void WebApplication::sendFile(const QString &path)
 {
     const QDateTime lastModified {QFileInfo(path).lastModified()};
 
-    // find translated file in cache
-    auto it = m_translatedFiles.constFind(path);
-    if ((it != m_translatedFiles.constEnd()) && (lastModified <= (*it).lastModified)) {
-        print((*it).data, QMimeDatabase().mimeTypeForFileNameAndData(path, (*it).data).name());
+    // find file in cache
+    auto it = m_cachedFiles.constFind(path);
+    if ((it == m_cachedFiles.constEnd()) || (lastModified > (*it).lastModified))
+        it = m_cachedFiles.insert(path, loadFile(path, lastModified));
+
+    const CachedFile &file = *it;
+    const bool isGzipped = !file.gzippedData.isEmpty()
+            && Http::acceptsGzipEncoding(request().headers.value(Http::HEADER_ACCEPT_ENCODING));
+    const QString &etag = isGzipped ? file.gzippedETag : file.etag;
+
+    header(Http::HEADER_ETAG, etag);
+    if (!file.gzippedData.isEmpty())
+        header(Http::HEADER_VARY, Http::HEADER_ACCEPT_ENCODING);
+
+    if (isETagMatched(request().headers.value(Http::HEADER_IF_NONE_MATCH), etag)) {
+        status(304, QLatin1String("Not Modified"));
         return;
     }
 
+    // the content is already encoded as well as it gets, Connection must not try compressing it again
+    header(Http::HEADER_CONTENT_ENCODING, (isGzipped ? QLatin1String("gzip") : QLatin1String("identity")));
+    print((isGzipped ? file.gzippedData : file.data), file.mimeType);
+}
+
+WebApplication::CachedFile WebApplication::loadFile(const QString &path, const QDateTime &lastModified) const
+{
     QFile file {path};
     if (!file.open(QIODevice::ReadOnly)) {
         qDebug("File %s was not found!", qUtf8Printable(path));
@@ -478,11 +529,70 @@ void WebApplication::sendFile(const QString &path)
         QString dataStr {data};
         translateDocument(dataStr);
         data = dataStr.toUtf8();
+    }
+
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+
+    CachedFile cachedFile;
+    cachedFile.data = data;
+    cachedFile.mimeType = type.name();
+    cachedFile.etag = QString("\"%1\"").arg(hash);
+    cachedFile.lastModified = lastModified;
+
+    // compress it once here instead of on every request
+    Http::Response compressed;
+    compressed.headers[Http::HEADER_CONTENT_TYPE] = cachedFile.mimeType;
+    compressed.headers[Http::HEADER_CONTENT_ENCODING] = QLatin1String("gzip");
+    compressed.content = data;
+    Http::compressContent(compressed);
+    if (compressed.headers.contains(Http::HEADER_CONTENT_ENCODING)) {
+        cachedFile.gzippedData = compressed.content;
+        cachedFile.gzippedETag = QString("\"%1-gzip\"").arg(hash);
+    }
+
+    return cachedFile;
+}
+
+void WebApplication::cacheWebUIFiles()
+{
+    // a pending step continues with the new list
+    const bool isCaching = !m_uncachedFiles.isEmpty();
+    m_uncachedFiles.clear();
+
+    // alternative UI folders can be arbitrary large, their files are cached once requested
+    if (Preferences::instance()->isAltWebUiEnabled())
+        return;
+
+    QDirIterator it {m_rootFolder, QDir::Files, QDirIterator::Subdirectories};
+    while (it.hasNext())
+        m_uncachedFiles << it.next();
 
-        m_translatedFiles[path] = {data, lastModified}; // caching translated file
+    if (!isCaching)
+        cacheNextWebUIFiles();
+}
+
+void WebApplication::cacheNextWebUIFiles()
+{
+    // translating and compressing takes a while, so it's done in small steps
+    // to keep the event loop (and the requests) going
+    QElapsedTimer timer;
+    timer.start();
+
+    while (!m_uncachedFiles.isEmpty() && !timer.hasExpired(CACHING_STEP_DURATION)) {
+        const QString path = m_uncachedFiles.takeLast();
+        if (m_cachedFiles.contains(path))
+            continue;
+
+        try {
+            m_cachedFiles.insert(path, loadFile(path, QFileInfo(path).lastModified()));
+        }
+        catch (const HTTPError &error) {
+            qWarning() << Q_FUNC_INFO << path << error.message();
+        }
     }
 
-    print(data, type.name());
+    if (!m_uncachedFiles.isEmpty())
+        QTimer::singleShot(0, this, &WebApplication::cacheNextWebUIFiles);
 }
 
 Http::Response WebApplication::processRequest(const Http::Request &request, const Http::Environment &env)
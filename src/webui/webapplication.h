@@ -41,7 +41,7 @@
 #include "base/http/types.h"
 #include "base/utils/version.h"
 
-constexpr Utils::Version<int, 3, 2> API_VERSION {2, 0, 0};
+constexpr Utils::Version<int, 3, 2> API_VERSION {2, 1, 0};
 constexpr int COMPAT_API_VERSION = 18;
 constexpr int COMPAT_API_VERSION_MIN = 18;
 
@@ -99,6 +99,16 @@ public:
     const Http::Environment &env() const;
 
 private:
+    struct CachedFile
+    {
+        QByteArray data;
+        QByteArray gzippedData;  // empty if the file doesn't compress well
+        QString mimeType;
+        QString etag;
+        QString gzippedETag;
+        QDateTime lastModified;
+    };
+
     void doProcessRequest();
     void configure();
 
@@ -107,6 +117,9 @@ private:
 
     void sendFile(const QString &path);
     void sendWebUIFile();
+    CachedFile loadFile(const QString &path, const QDateTime &lastModified) const;
+    void cacheWebUIFiles();
+    void cacheNextWebUIFiles();
 
     // Session management
     QString generateSid() const;
@@ -133,12 +146,11 @@ private:
     QSet<QString> m_publicAPIs;
     bool m_isAltUIUsed = false;
     QString m_rootFolder;
+    QString m_locale;
     QStringList m_domainList;
 
-    struct TranslatedFile
-    {
-        QByteArray data;
-        QDateTime lastModified;
-    };
-    QMap<QString, TranslatedFile> m_translatedFiles;
+    // files are cached translated to the current locale
+    QHash<QString, CachedFile> m_cachedFiles;
+    // files still to be cached in the background
+    QStringList m_uncachedFiles;
 };
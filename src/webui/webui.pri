@@ -3,12 +3,16 @@ HEADERS += \
     $$PWD/api/apierror.h \
     $$PWD/api/appcontroller.h \
     $$PWD/api/authcontroller.h \
+    $$PWD/api/changejournal.h \
     $$PWD/api/isessionmanager.h \
     $$PWD/api/logcontroller.h \
+    $$PWD/api/piecestatejournal.h \
     $$PWD/api/rsscontroller.h \
     $$PWD/api/synccontroller.h \
     $$PWD/api/torrentscontroller.h \
+    $$PWD/api/torrentsnapshotcache.h \
     $$PWD/api/transfercontroller.h \
+    $$PWD/api/serialize/jsonwriter.h \
     $$PWD/api/serialize/serialize_torrent.h \
     $$PWD/extra_translations.h \
     $$PWD/webapplication.h \
@@ -19,11 +23,15 @@ SOURCES += \
     $$PWD/api/apierror.cpp \
     $$PWD/api/appcontroller.cpp \
     $$PWD/api/authcontroller.cpp \
+    $$PWD/api/changejournal.cpp \
     $$PWD/api/logcontroller.cpp \
+    $$PWD/api/piecestatejournal.cpp \
     $$PWD/api/rsscontroller.cpp \
     $$PWD/api/synccontroller.cpp \
     $$PWD/api/torrentscontroller.cpp \
+    $$PWD/api/torrentsnapshotcache.cpp \
     $$PWD/api/transfercontroller.cpp \
+    $$PWD/api/serialize/jsonwriter.cpp \
     $$PWD/api/serialize/serialize_torrent.cpp \
     $$PWD/webapplication.cpp \
     $$PWD/webui.cpp